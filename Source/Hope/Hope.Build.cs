@@ -13,7 +13,7 @@ public class Hope : ModuleRules
         "GameplayAbilities", "AIModule", "NavigationSystem", "UMG", "Inventory" });
 
         PrivateDependencyModuleNames.AddRange(new string[] { "GameplayTags", "GameplayTasks", "EnhancedInput",
-            "Niagara", "AnimGraphRuntime", "AnimationLocomotionLibraryRuntime" });
+            "Niagara", "AnimGraphRuntime", "AnimationLocomotionLibraryRuntime", "Json" });
 
         // Uncomment if you are using Slate UI
         // PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
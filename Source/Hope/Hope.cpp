@@ -3,4 +3,7 @@
 #include "Hope.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogHopeBuilding);
+DEFINE_LOG_CATEGORY(LogHopeDebug);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Hope, "Hope" );
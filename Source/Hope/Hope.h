@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogHopeBuilding, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogHopeDebug, Log, All);
+
 // Building collision trace channels
 
 #define ECC_FoundationTrace ECC_GameTraceChannel1;
@@ -0,0 +1,51 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/AnimCurveCache.h"
+#include "Animation/AnimInstance.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeAnim"), STATGROUP_HopeAnim, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Curve Reads"), STAT_HopeAnimCurveReads, STATGROUP_HopeAnim);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim Curve Lookups"), STAT_HopeAnimCurveLookups, STATGROUP_HopeAnim);
+
+namespace HopeAnimation
+{
+	static bool bCacheCurves = true;
+	FAutoConsoleVariableRef CVar_CacheCurves(TEXT("Hope.Anim.CacheCurves"), bCacheCurves,
+		TEXT("Looks every anim curve up once per update. When off every read looks the curve up, for comparing 'stat HopeAnim'."), ECVF_Default);
+}
+
+int32 FAnimCurveCache::Register(FName CurveName)
+{
+	const int32 Existing = Entries.IndexOfByPredicate([CurveName](const FEntry& Entry) { return Entry.Name == CurveName; });
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Name = CurveName;
+	Entry.Hash = GetTypeHash(CurveName);
+	return Entries.Num() - 1;
+}
+
+float FAnimCurveCache::GetValue(const UAnimInstance& AnimInstance, int32 Handle)
+{
+	if (!Entries.IsValidIndex(Handle))
+	{
+		return 0.f;
+	}
+
+	INC_DWORD_STAT(STAT_HopeAnimCurveReads);
+
+	FEntry& Entry = Entries[Handle];
+	if (Entry.Serial != Serial || !HopeAnimation::bCacheCurves)
+	{
+		INC_DWORD_STAT(STAT_HopeAnimCurveLookups);
+
+		const float* Value = AnimInstance.GetAnimationCurveList(EAnimCurveType::AttributeCurve).FindByHash(Entry.Hash, Entry.Name);
+		Entry.Value = Value ? *Value : 0.f;
+		Entry.Serial = Serial;
+	}
+	return Entry.Value;
+}
@@ -5,7 +5,6 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Character/CharacterBase.h"
 #include "Kismet/KismetMathLibrary.h"
-#include "KismetAnimationLibrary.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
 #include "HopeInterfaces/CombatInterface.h"
@@ -18,6 +17,13 @@
 #include "Misc/DataValidation.h"
 #endif
 
+namespace HopeAnimation
+{
+	static bool bServerAnimation = true;
+	FAutoConsoleVariableRef CVar_ServerAnimation(TEXT("Hope.Anim.ServerAnimation"), bServerAnimation,
+		TEXT("Dedicated servers skip cosmetic animation work. Applies to characters spawned afterwards."), ECVF_Default);
+}
+
 void FCharacterAnimInstanceProxy::InitializeObjects(UAnimInstance* InAnimInstance)
 {
 	FAnimInstanceProxy::InitializeObjects(InAnimInstance);
@@ -27,11 +33,88 @@ void FCharacterAnimInstanceProxy::InitializeObjects(UAnimInstance* InAnimInstanc
 
 	Character = Cast<ACharacterBase>(Owner);
 	MovementComponent = Cast<UCharacterMovementComponent>(Owner->GetMovementComponent());
+
+	UWorld* World = Owner->GetWorld();
+	UCharacterLocomotionSubsystem* Subsystem = World ? World->GetSubsystem<UCharacterLocomotionSubsystem>() : nullptr;
+	if (Subsystem && LocomotionSlot == INDEX_NONE)
+	{
+		LocomotionSlot = Subsystem->RegisterCharacter(Owner, MovementComponent, InAnimInstance->GetSkelMeshComponent());
+		LocomotionSubsystem = LocomotionSlot != INDEX_NONE ? Subsystem : nullptr;
+	}
+
+	// Feet are only placed for what is seen, a dedicated server has no use for their traces.
+	const UCharacterAnimInstance* AnimInstance = Cast<UCharacterAnimInstance>(InAnimInstance);
+	UCharacterFootProbeSubsystem* FootProbes = World ? World->GetSubsystem<UCharacterFootProbeSubsystem>() : nullptr;
+	if (AnimInstance && AnimInstance->bUseFootProbes && FootProbes && FootProbeSlot == INDEX_NONE
+		&& !UCharacterAnimInstance::ShouldUseServerAnimation(Owner))
+	{
+		FootProbeSlot = FootProbes->RegisterCharacter(InAnimInstance->GetSkelMeshComponent(), AnimInstance->LeftFootBoneName, AnimInstance->RightFootBoneName);
+		FootProbeSubsystem = FootProbeSlot != INDEX_NONE ? FootProbes : nullptr;
+	}
+}
+
+void FCharacterAnimInstanceProxy::ClearObjects()
+{
+	FAnimInstanceProxy::ClearObjects();
+
+	if (UCharacterLocomotionSubsystem* Subsystem = LocomotionSubsystem.Get())
+	{
+		Subsystem->UnregisterCharacter(LocomotionSlot);
+	}
+	LocomotionSubsystem = nullptr;
+	LocomotionSlot = INDEX_NONE;
+	LocomotionState = FCharacterLocomotionState();
+
+	if (UCharacterFootProbeSubsystem* FootProbes = FootProbeSubsystem.Get())
+	{
+		FootProbes->UnregisterCharacter(FootProbeSlot);
+	}
+	FootProbeSubsystem = nullptr;
+	FootProbeSlot = INDEX_NONE;
 }
 
 void FCharacterAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
 {
 	FAnimInstanceProxy::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	if (!Owner || !MovementComponent) return;
+
+	GameThreadData.ActorLocation = Owner->GetActorLocation();
+	GameThreadData.ActorRotation = Owner->GetActorRotation();
+	GameThreadData.BaseAimRotation = Owner->GetBaseAimRotation();
+	GameThreadData.Velocity = Owner->GetVelocity();
+
+	GameThreadData.CurrentAcceleration = MovementComponent->GetCurrentAcceleration();
+	GameThreadData.LastUpdateVelocity = MovementComponent->GetLastUpdateVelocity();
+	GameThreadData.GravityZ = MovementComponent->GetGravityZ() * MovementComponent->GravityScale;
+	GameThreadData.GroundFriction = MovementComponent->GroundFriction;
+	GameThreadData.BrakingFriction = MovementComponent->BrakingFriction;
+	GameThreadData.BrakingFrictionFactor = MovementComponent->BrakingFrictionFactor;
+	GameThreadData.BrakingDecelerationWalking = MovementComponent->BrakingDecelerationWalking;
+	GameThreadData.bUseSeparateBrakingFriction = MovementComponent->bUseSeparateBrakingFriction;
+	GameThreadData.bIsMovingOnGround = MovementComponent->IsMovingOnGround();
+	GameThreadData.bIsFalling = MovementComponent->MovementMode == EMovementMode::MOVE_Falling;
+	GameThreadData.SignificanceTier = Character ? Character->GetSignificanceTier() : ESignificanceTier::EST_Critical;
+
+	UCharacterLocomotionSubsystem* Subsystem = LocomotionSubsystem.Get();
+	if (!Subsystem || !Subsystem->ConsumeResult(LocomotionSlot, GameThreadData.Locomotion))
+	{
+		UCharacterLocomotionSubsystem::SolveSingle(LocomotionState, GameThreadData.ActorLocation, GameThreadData.ActorRotation.Yaw,
+			GameThreadData.Velocity, GameThreadData.CurrentAcceleration, GameThreadData.Locomotion);
+	}
+
+	GameThreadData.LeftFootProbe = FFootProbeResult();
+	GameThreadData.RightFootProbe = FFootProbeResult();
+	if (UCharacterFootProbeSubsystem* FootProbes = FootProbeSubsystem.Get())
+	{
+		const UCharacterAnimInstance* AnimInstance = CastChecked<UCharacterAnimInstance>(InAnimInstance);
+		const bool bIsEligible = GameThreadData.SignificanceTier <= AnimInstance->MaxFootPlacementTier;
+		FootProbes->SetEligible(FootProbeSlot, bIsEligible);
+		if (bIsEligible)
+		{
+			FootProbes->GetResults(FootProbeSlot, GameThreadData.LeftFootProbe, GameThreadData.RightFootProbe);
+		}
+	}
 }
 
 void FCharacterAnimInstanceProxy::Update(float DeltaSeconds)
@@ -50,10 +133,21 @@ EDataValidationResult UCharacterAnimInstance::IsDataValid(FDataValidationContext
 }
 #endif // WITH_EDITOR
 
+bool UCharacterAnimInstance::ShouldUseServerAnimation(const AActor* Owner)
+{
+	return HopeAnimation::bServerAnimation && Owner && Owner->GetNetMode() == NM_DedicatedServer;
+}
+
 void UCharacterAnimInstance::NativeInitializeAnimation()
 {
 	Super::NativeInitializeAnimation();
 
+	bIsServerAnimation = ShouldUseServerAnimation(GetOwningActor());
+
+	TurnYawWeightCurve = CurveCache.Register(TurnYawWeightCurveName);
+	RemainingTurnYawCurve = CurveCache.Register(RemainingTurnYawCurveName);
+	DisableLegIKCurve = CurveCache.Register(DisableLegIKCurveName);
+
 	if (AActor* OwningActor = GetOwningActor())
 	{
 		if (UAbilitySystemComponent* ASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(OwningActor))
@@ -77,6 +171,7 @@ void UCharacterAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
 void UCharacterAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
 {
 	Super::NativeThreadSafeUpdateAnimation(DeltaSeconds);
+	CurveCache.Invalidate();
 	if (!Proxy.Owner) return;
 
 	UpdateLocationData(DeltaSeconds);
@@ -84,10 +179,18 @@ void UCharacterAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
 	UpdateVelocityData();
 	UpdateAccelerationData();
 	UpdateLocomotionData();
-	UpdateRootYawOffset(DeltaSeconds);
+	// Turn in place, additive weights and the wall heuristic only change how the character looks.
+	if (!bIsServerAnimation)
+	{
+		UpdateRootYawOffset(DeltaSeconds);
+	}
 	UpdateCharacterStates(DeltaSeconds);
-	UpdateBlendWeightData(DeltaSeconds);
-	UpdateWallDetectionHeuristic();
+	if (!bIsServerAnimation)
+	{
+		UpdateBlendWeightData(DeltaSeconds);
+		UpdateWallDetectionHeuristic();
+	}
+	PublishSnapshot();
 	bIsFirstUpdate = false;
 }
 
@@ -110,8 +213,8 @@ void UCharacterAnimInstance::InitializeWithAbilitySystem(UAbilitySystemComponent
 
 void UCharacterAnimInstance::UpdateLocationData(float DeltaSeconds)
 {
-	DisplacementSinceLastUpdate = UKismetMathLibrary::VSizeXY(Proxy.Owner->GetActorLocation() - WorldLocation);
-	WorldLocation = Proxy.Owner->GetActorLocation();
+	DisplacementSinceLastUpdate = Proxy.GameThreadData.Locomotion.DisplacementSinceLastUpdate;
+	WorldLocation = Proxy.GameThreadData.ActorLocation;
 	DisplacementSpeed = UKismetMathLibrary::SafeDivide(DisplacementSinceLastUpdate, DeltaSeconds);
 	if (bIsFirstUpdate)
 	{
@@ -125,7 +228,7 @@ void UCharacterAnimInstance::UpdateRotationData(float DeltaSeconds)
 	LastFrameActorYawRotation = ActorYawRotation;
 
 	// Saving Current Yaw Rotation
-	WorldRotation = Proxy.Owner->GetActorRotation();
+	WorldRotation = Proxy.GameThreadData.ActorRotation;
 	ActorYawRotation = WorldRotation.Yaw;
 	DeltaActorYawRotation = ActorYawRotation - LastFrameActorYawRotation;
 
@@ -150,7 +253,7 @@ void UCharacterAnimInstance::UpdateRotationData(float DeltaSeconds)
 	AdditiveLeanAngle = UKismetMathLibrary::ClampAngle(AngleDegrees, -90.f, 90.f);
 
 	// Calculate AimPitch
-	AimPitch = UKismetMathLibrary::NormalizeAxis(Proxy.Owner->GetBaseAimRotation().Pitch);
+	AimPitch = UKismetMathLibrary::NormalizeAxis(Proxy.GameThreadData.BaseAimRotation.Pitch);
 
 	if (bIsFirstUpdate)
 	{
@@ -161,31 +264,30 @@ void UCharacterAnimInstance::UpdateRotationData(float DeltaSeconds)
 
 void UCharacterAnimInstance::UpdateVelocityData()
 {
-	WorldVelocity = Proxy.Owner->GetVelocity();
+	WorldVelocity = Proxy.GameThreadData.Velocity;
 	WorldVelocity2D = WorldVelocity * FVector(1.f, 1.f, 0.f);
-	LocalVelocity2D = UKismetMathLibrary::LessLess_VectorRotator(WorldVelocity2D, WorldRotation);
-	LocalVelocityDirectionAngle = UKismetAnimationLibrary::CalculateDirection(WorldVelocity2D, WorldRotation);
+	LocalVelocity2D = Proxy.GameThreadData.Locomotion.LocalVelocity2D;
+	LocalVelocityDirectionAngle = Proxy.GameThreadData.Locomotion.VelocityLocomotionAngle;
 	LocalVelocityDirectionAngleWithOffset = LocalVelocityDirectionAngle - RootYawOffset;
 }
 
 void UCharacterAnimInstance::UpdateAccelerationData()
 {
-	Acceleration = Proxy.MovementComponent->GetCurrentAcceleration();
+	Acceleration = Proxy.GameThreadData.CurrentAcceleration;
 	Acceleration2D = Acceleration * FVector(1.f, 1.f, 0.f);
-	LocalAcceleration2D = UKismetMathLibrary::LessLess_VectorRotator(Acceleration2D, WorldRotation);
-	bIsAccelerating = !UKismetMathLibrary::NearlyEqual_FloatFloat(UKismetMathLibrary::VSizeXYSquared(LocalAcceleration2D), 0.0f);
-	PivotDirection2D = UKismetMathLibrary::Normal(UKismetMathLibrary::VLerp(PivotDirection2D,
-		UKismetMathLibrary::Normal(Acceleration2D), 0.5f));
+	LocalAcceleration2D = Proxy.GameThreadData.Locomotion.LocalAcceleration2D;
+	bIsAccelerating = Proxy.GameThreadData.Locomotion.bIsAccelerating;
+	PivotDirection2D = Proxy.GameThreadData.Locomotion.PivotDirection2D;
 }
 
 void UCharacterAnimInstance::UpdateLocomotionData()
 {
-	bWasMovingLastUpdate = !UKismetMathLibrary::Vector_IsZero(LocalVelocity2D);
+	bWasMovingLastUpdate = Proxy.GameThreadData.Locomotion.bIsMoving;
 	LastFrameVelocityLocomotionDirection = VelocityLocomotionDirection;
 
-	VelocityLocomotionAngle = CalculateDirection(WorldVelocity2D, WorldRotation);
+	VelocityLocomotionAngle = Proxy.GameThreadData.Locomotion.VelocityLocomotionAngle;
 	VelocityLocomotionAngleWithOffset = VelocityLocomotionAngle - RootYawOffset;
-	AccelerationLocomotionAngle = CalculateDirection(Acceleration2D, WorldRotation);
+	AccelerationLocomotionAngle = Proxy.GameThreadData.Locomotion.AccelerationLocomotionAngle;
 
 	VelocityLocomotionDirection = CalculateLocomotionDirectionFromAngle(VelocityLocomotionAngleWithOffset, LocomotionDirectionDeadZone,
 		VelocityLocomotionDirection, bWasMovingLastUpdate);
@@ -212,7 +314,7 @@ void UCharacterAnimInstance::UpdateRootYawOffset(float DeltaSeconds)
 void UCharacterAnimInstance::UpdateCharacterStates(float DeltaSeconds)
 {
 	// IsOnGround
-	bIsOnGround = Proxy.MovementComponent->IsMovingOnGround();
+	bIsOnGround = Proxy.GameThreadData.bIsMovingOnGround;
 
 	// Gait
 	LastFrameGait = CurrentGait;
@@ -224,6 +326,13 @@ void UCharacterAnimInstance::UpdateCharacterStates(float DeltaSeconds)
 	bIsCrouching = IncomingGait == EGait::EG_Crouching;
 	bCrouchStateChanged = bIsCrouching != bLastFrameIsCrouching;
 
+	// Significance
+	SignificanceTier = Proxy.GameThreadData.SignificanceTier;
+	bUseReducedGraph = SignificanceTier >= ReducedGraphTier;
+	bUseFootPlacement = SignificanceTier <= MaxFootPlacementTier;
+	LeftFootGround = Proxy.GameThreadData.LeftFootProbe;
+	RightFootGround = Proxy.GameThreadData.RightFootProbe;
+
 	// Fire
 	if (GameplayTag_IsFiring)
 	{
@@ -235,13 +344,13 @@ void UCharacterAnimInstance::UpdateCharacterStates(float DeltaSeconds)
 	}
 
 	// Air
-	bIsInAir = Proxy.MovementComponent->MovementMode == EMovementMode::MOVE_Falling;
+	bIsInAir = Proxy.GameThreadData.bIsFalling;
 	bIsJumping = WorldVelocity.Z > 0.0f;
 	bIsFalling = WorldVelocity.Z < 0.0f;
 
 	if (bIsJumping)
 	{
-		TimeToJumpApex = (0.0f - WorldVelocity.Z) / (Proxy.MovementComponent->GetGravityZ() * Proxy.MovementComponent->GravityScale);
+		TimeToJumpApex = (0.0f - WorldVelocity.Z) / Proxy.GameThreadData.GravityZ;
 	}
 	else
 	{
@@ -260,10 +369,7 @@ void UCharacterAnimInstance::UpdateCharacterStates(float DeltaSeconds)
 
 void UCharacterAnimInstance::UpdateWallDetectionHeuristic()
 {
-	bIsRunningIntoWall = UKismetMathLibrary::VSizeXY(LocalAcceleration2D) > 0.1f
-		&& UKismetMathLibrary::VSizeXY(LocalVelocity2D) < 200.f
-		&& UKismetMathLibrary::InRange_FloatFloat(UKismetMathLibrary::Dot_VectorVector(
-			UKismetMathLibrary::Normal(LocalAcceleration2D), UKismetMathLibrary::Normal(LocalVelocity2D)), -0.6f, 0.6f, true, true);
+	bIsRunningIntoWall = Proxy.GameThreadData.Locomotion.bIsRunningIntoWall;
 }
 
 void UCharacterAnimInstance::UpdateBlendWeightData(float DeltaSeconds)
@@ -272,6 +378,47 @@ void UCharacterAnimInstance::UpdateBlendWeightData(float DeltaSeconds)
 		UKismetMathLibrary::FInterpTo(UpperBodyDynamicAdditiveWeight, 0.0f, DeltaSeconds, 6.0f), IsAnyMontagePlaying() && bIsOnGround);
 }
 
+void UCharacterAnimInstance::PublishSnapshot()
+{
+	FCharacterAnimSnapshot& Snapshot = Proxy.Snapshot;
+	const FCharacterAnimGameThreadData& GameThreadData = Proxy.GameThreadData;
+
+	Snapshot.WorldLocation = WorldLocation;
+	Snapshot.LocalVelocity2D = LocalVelocity2D;
+	Snapshot.LocalAcceleration2D = LocalAcceleration2D;
+
+	Snapshot.CurrentAcceleration = GameThreadData.CurrentAcceleration;
+	Snapshot.LastUpdateVelocity = GameThreadData.LastUpdateVelocity;
+	Snapshot.GroundFriction = GameThreadData.GroundFriction;
+	Snapshot.BrakingFriction = GameThreadData.BrakingFriction;
+	Snapshot.BrakingFrictionFactor = GameThreadData.BrakingFrictionFactor;
+	Snapshot.BrakingDecelerationWalking = GameThreadData.BrakingDecelerationWalking;
+	Snapshot.bUseSeparateBrakingFriction = GameThreadData.bUseSeparateBrakingFriction;
+
+	Snapshot.DisplacementSinceLastUpdate = DisplacementSinceLastUpdate;
+	Snapshot.DisplacementSpeed = DisplacementSpeed;
+	Snapshot.RootYawOffset = RootYawOffset;
+	Snapshot.LastPivotTime = LastPivotTime;
+	Snapshot.TimeSinceFiredWeapon = TimeSinceFiredWeapon;
+	Snapshot.GroundDistance = GroundDistance;
+	Snapshot.DisableLegIKCurveValue = bUseFootPlacement ? CurveCache.GetValue(*this, DisableLegIKCurve) : 0.f;
+
+	Snapshot.CurrentGait = CurrentGait;
+	Snapshot.VelocityLocomotionDirection = VelocityLocomotionDirection;
+	Snapshot.AccelerationLocomotionDirection = AccelerationLocomotionDirection;
+	Snapshot.SignificanceTier = SignificanceTier;
+
+	Snapshot.bIsCrouching = bIsCrouching;
+	Snapshot.bIsOnGround = bIsOnGround;
+	Snapshot.bIsJumping = bIsJumping;
+	Snapshot.bIsFalling = bIsFalling;
+	Snapshot.bIsAccelerating = bIsAccelerating;
+	Snapshot.bIsRunningIntoWall = bIsRunningIntoWall;
+	Snapshot.bUseFootPlacement = bUseFootPlacement;
+	Snapshot.bUseReducedGraph = bUseReducedGraph;
+	Snapshot.bIsServerAnimation = bIsServerAnimation;
+}
+
 void UCharacterAnimInstance::UpdateIdleState(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	EAnimNodeReferenceConversionResult Result;
@@ -281,7 +428,7 @@ void UCharacterAnimInstance::UpdateIdleState(const FAnimUpdateContext& Context,
 	{
 		TurnYawCurveValue = 0.f;
 	}
-	else
+	else if (!bIsServerAnimation)
 	{
 		RootYawOffsetMode = ERootYawOffsetMode::ERYOM_Accumulate;
 		ProcessTurnYawCurve();
@@ -291,6 +438,7 @@ void UCharacterAnimInstance::UpdateIdleState(const FAnimUpdateContext& Context,
 void UCharacterAnimInstance::SetupStartState(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	VelocityLocomotionDirection = LastFrameVelocityLocomotionDirection;
+	Proxy.Snapshot.VelocityLocomotionDirection = VelocityLocomotionDirection;
 }
 
 void UCharacterAnimInstance::UpdateStartState(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
@@ -313,7 +461,7 @@ void UCharacterAnimInstance::UpdatePivotState(const FAnimUpdateContext& Context,
 {
 	if (LastPivotTime > 0.f)
 	{
-		LastPivotTime = LastPivotTime - UAnimExecutionContextLibrary::GetDeltaTime(Context);
+		SetLastPivotTime(LastPivotTime - UAnimExecutionContextLibrary::GetDeltaTime(Context));
 	}
 }
 
@@ -439,20 +587,28 @@ void UCharacterAnimInstance::SetRootYawOffset(float Angle)
 		RootYawOffset = 0.0f;
 		AimYaw = 0.f;
 	}
+	Proxy.Snapshot.RootYawOffset = RootYawOffset;
+}
+
+void UCharacterAnimInstance::SetLastPivotTime(float InLastPivotTime)
+{
+	LastPivotTime = InLastPivotTime;
+	Proxy.Snapshot.LastPivotTime = LastPivotTime;
 }
 
 void UCharacterAnimInstance::ProcessTurnYawCurve()
 {
 	LastFrameTurnYawCurveValue = TurnYawCurveValue;
 
-	if (UKismetMathLibrary::NearlyEqual_FloatFloat(GetCurveValue(TurnYawWeightCurveName), 0.f, 1.e-4))
+	const float TurnYawWeight = CurveCache.GetValue(*this, TurnYawWeightCurve);
+	if (UKismetMathLibrary::NearlyEqual_FloatFloat(TurnYawWeight, 0.f, 1.e-4))
 	{
 		TurnYawCurveValue = 0.f;
 		LastFrameTurnYawCurveValue = 0.f;
 	}
 	else
 	{
-		TurnYawCurveValue = UKismetMathLibrary::SafeDivide(GetCurveValue(RemainingTurnYawCurveName), GetCurveValue(TurnYawWeightCurveName));
+		TurnYawCurveValue = UKismetMathLibrary::SafeDivide(CurveCache.GetValue(*this, RemainingTurnYawCurve), TurnYawWeight);
 		if (LastFrameTurnYawCurveValue != 0.f)
 		{
 			SetRootYawOffset(RootYawOffset - (TurnYawCurveValue - LastFrameTurnYawCurveValue));
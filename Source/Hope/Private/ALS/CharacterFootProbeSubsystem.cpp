@@ -0,0 +1,161 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/CharacterFootProbeSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeFootProbe"), STATGROUP_HopeFootProbe, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Foot Probe Update"), STAT_HopeFootProbeUpdate, STATGROUP_HopeFootProbe);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Foot Traces"), STAT_HopeFootProbeTraces, STATGROUP_HopeFootProbe);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Foot Probes Reused"), STAT_HopeFootProbeReused, STATGROUP_HopeFootProbe);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Probed"), STAT_HopeFootProbeCharacters, STATGROUP_HopeFootProbe);
+
+namespace HopeFootProbe
+{
+	static float ReprobeDistance = 2.f;
+	FAutoConsoleVariableRef CVar_ReprobeDistance(TEXT("Hope.FootProbe.ReprobeDistance"), ReprobeDistance,
+		TEXT("A foot is traced again once it moved this far horizontally from where it was last traced."), ECVF_Default);
+
+	static int32 MaxReuseFrames = 30;
+	FAutoConsoleVariableRef CVar_MaxReuseFrames(TEXT("Hope.FootProbe.MaxReuseFrames"), MaxReuseFrames,
+		TEXT("A foot that didn't move is traced again after this many frames, for ground that moves under it."), ECVF_Default);
+
+	static float TraceStartOffset = 50.f;
+	FAutoConsoleVariableRef CVar_TraceStartOffset(TEXT("Hope.FootProbe.TraceStartOffset"), TraceStartOffset,
+		TEXT("Height above the foot bone the ground trace starts at."), ECVF_Default);
+
+	static float TraceEndOffset = 75.f;
+	FAutoConsoleVariableRef CVar_TraceEndOffset(TEXT("Hope.FootProbe.TraceEndOffset"), TraceEndOffset,
+		TEXT("Depth below the foot bone the ground trace ends at."), ECVF_Default);
+}
+
+void UCharacterFootProbeSubsystem::Deinitialize()
+{
+	Slots.Reset();
+	FreeSlots.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCharacterFootProbeSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_HopeFootProbeUpdate);
+
+	UWorld* World = GetWorld();
+	int32 NumTraces = 0;
+	int32 NumReused = 0;
+	int32 NumCharacters = 0;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(CharacterFootProbe), false);
+	for (FCharacterSlot& CharacterSlot : Slots)
+	{
+		if (!CharacterSlot.bIsUsed)
+		{
+			continue;
+		}
+
+		const USkeletalMeshComponent* Mesh = CharacterSlot.Mesh.Get();
+		if (!Mesh || !CharacterSlot.bIsEligible)
+		{
+			CharacterSlot.Feet[0] = FFootProbe();
+			CharacterSlot.Feet[1] = FFootProbe();
+			continue;
+		}
+		++NumCharacters;
+
+		QueryParams.ClearIgnoredSourceObjects();
+		QueryParams.AddIgnoredActor(Mesh->GetOwner());
+
+		for (int32 Foot = 0; Foot < 2; ++Foot)
+		{
+			FFootProbe& Probe = CharacterSlot.Feet[Foot];
+
+			FTraceDatum TraceDatum;
+			if (World->QueryTraceData(Probe.PendingTrace, TraceDatum))
+			{
+				const FHitResult* Hit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit ? &TraceDatum.OutHits[0] : nullptr;
+				Probe.Result.bHasGround = Hit != nullptr;
+				Probe.Result.GroundLocation = Hit ? FVector(Hit->ImpactPoint) : FVector::ZeroVector;
+				Probe.Result.GroundNormal = Hit ? FVector(Hit->ImpactNormal) : FVector::UpVector;
+			}
+			Probe.PendingTrace = FTraceHandle();
+
+			// A foot that stayed over the same spot still stands on the same ground.
+			const FVector FootLocation = Mesh->GetSocketLocation(CharacterSlot.FootBoneNames[Foot]);
+			if (Probe.bHasProbed && GFrameCounter - Probe.ProbedFrame < static_cast<uint64>(FMath::Max(HopeFootProbe::MaxReuseFrames, 0))
+				&& FVector::DistSquared2D(FootLocation, Probe.ProbedLocation) < FMath::Square(HopeFootProbe::ReprobeDistance))
+			{
+				++NumReused;
+				continue;
+			}
+
+			const FVector TraceStart(FootLocation.X, FootLocation.Y, FootLocation.Z + HopeFootProbe::TraceStartOffset);
+			const FVector TraceEnd(FootLocation.X, FootLocation.Y, FootLocation.Z - HopeFootProbe::TraceEndOffset);
+			Probe.PendingTrace = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, ECC_Visibility, QueryParams);
+			Probe.ProbedLocation = FootLocation;
+			Probe.ProbedFrame = GFrameCounter;
+			Probe.bHasProbed = true;
+			++NumTraces;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_HopeFootProbeTraces, NumTraces);
+	SET_DWORD_STAT(STAT_HopeFootProbeReused, NumReused);
+	SET_DWORD_STAT(STAT_HopeFootProbeCharacters, NumCharacters);
+}
+
+TStatId UCharacterFootProbeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterFootProbeSubsystem, STATGROUP_Tickables);
+}
+
+int32 UCharacterFootProbeSubsystem::RegisterCharacter(USkeletalMeshComponent* Mesh, FName LeftFootBoneName, FName RightFootBoneName)
+{
+	if (!Mesh)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 Slot = FreeSlots.Num() > 0 ? FreeSlots.Pop(EAllowShrinking::No) : Slots.AddDefaulted();
+	FCharacterSlot& CharacterSlot = Slots[Slot];
+	CharacterSlot = FCharacterSlot();
+	CharacterSlot.Mesh = Mesh;
+	CharacterSlot.FootBoneNames[0] = LeftFootBoneName;
+	CharacterSlot.FootBoneNames[1] = RightFootBoneName;
+	CharacterSlot.bIsUsed = true;
+	return Slot;
+}
+
+void UCharacterFootProbeSubsystem::UnregisterCharacter(int32 Slot)
+{
+	if (!Slots.IsValidIndex(Slot) || !Slots[Slot].bIsUsed)
+	{
+		return;
+	}
+
+	Slots[Slot] = FCharacterSlot();
+	FreeSlots.Add(Slot);
+}
+
+void UCharacterFootProbeSubsystem::SetEligible(int32 Slot, bool bIsEligible)
+{
+	if (Slots.IsValidIndex(Slot) && Slots[Slot].bIsUsed)
+	{
+		Slots[Slot].bIsEligible = bIsEligible;
+	}
+}
+
+bool UCharacterFootProbeSubsystem::GetResults(int32 Slot, FFootProbeResult& OutLeftFoot, FFootProbeResult& OutRightFoot) const
+{
+	if (!Slots.IsValidIndex(Slot) || !Slots[Slot].bIsUsed)
+	{
+		return false;
+	}
+
+	OutLeftFoot = Slots[Slot].Feet[0].Result;
+	OutRightFoot = Slots[Slot].Feet[1].Result;
+	return true;
+}
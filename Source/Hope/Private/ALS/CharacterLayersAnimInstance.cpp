@@ -3,6 +3,7 @@
 
 #include "ALS/CharacterLayersAnimInstance.h"
 #include "ALS/CharacterAnimInstance.h"
+#include "ALS/DistanceMatchingCache.h"
 #include "SequencePlayerLibrary.h"
 #include "SequenceEvaluatorLibrary.h"
 #include "GameFramework/CharacterMovementComponent.h"
@@ -12,34 +13,119 @@
 #include "AnimExecutionContextLibrary.h"
 #include "AnimationStateMachineLibrary.h"
 
+void UCharacterLayersAnimInstance::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITORONLY_DATA
+	// Only the blueprint defaults were ever edited, instances pick the generated data up from them.
+	if (!HasAnyFlags(RF_ClassDefaultObject) || DefaultLocomotionAnimData)
+	{
+		return;
+	}
+
+	// Every property of the data asset has a deprecated twin of the same name here.
+	ULocomotionAnimData* MigratedData = nullptr;
+	for (TFieldIterator<FProperty> It(ULocomotionAnimData::StaticClass()); It; ++It)
+	{
+		const FProperty* OldProperty = GetClass()->FindPropertyByName(*(It->GetName() + TEXT("_DEPRECATED")));
+		if (!OldProperty || !OldProperty->SameType(*It))
+		{
+			continue;
+		}
+
+		// Compared with the native defaults, where every deprecated property is empty.
+		if (OldProperty->Identical_InContainer(this, GetDefault<UCharacterLayersAnimInstance>()))
+		{
+			continue;
+		}
+		if (!MigratedData)
+		{
+			MigratedData = NewObject<ULocomotionAnimData>(this, MakeUniqueObjectName(this, ULocomotionAnimData::StaticClass(), TEXT("LocomotionAnimData")));
+		}
+		void* OldValue = OldProperty->ContainerPtrToValuePtr<void>(this);
+		It->CopyCompleteValue(It->ContainerPtrToValuePtr<void>(MigratedData), OldValue);
+		OldProperty->ClearValue(OldValue);
+	}
+
+	if (MigratedData)
+	{
+		MigratedData->BuildTables();
+		DefaultLocomotionAnimData = MigratedData;
+		MarkPackageDirty();
+		UE_LOG(LogAnimation, Warning, TEXT("%s: moved its locomotion animations into %s, resave it to keep them."), *GetClass()->GetName(), *MigratedData->GetName());
+	}
+#endif // WITH_EDITORONLY_DATA
+}
+
+void UCharacterLayersAnimInstance::NativeInitializeAnimation()
+{
+	Super::NativeInitializeAnimation();
+
+	MainAnimInstance = Cast<UCharacterAnimInstance>(GetOwningComponent()->GetAnimInstance());
+
+	ApplyHipfireOverridePoseCurve = CurveCache.Register(ApplyHipfireOverridePoseCurveName);
+	DisableRHandIKCurve = CurveCache.Register(DisableRHandIKCurveName);
+	DisableLHandIKCurve = CurveCache.Register(DisableLHandIKCurveName);
+	DisableLeftHandPoseOverrideCurve = CurveCache.Register(DisableLeftHandPoseOverrideCurveName);
+
+	LocomotionAnimData = DefaultLocomotionAnimData;
+}
+
+void UCharacterLayersAnimInstance::NativeUpdateAnimation(float DeltaSeconds)
+{
+	Super::NativeUpdateAnimation(DeltaSeconds);
+
+	// Layers can be initialized before the main anim instance is set on the mesh, resolved here on the game thread then.
+	if (!MainAnimInstance)
+	{
+		MainAnimInstance = Cast<UCharacterAnimInstance>(GetOwningComponent()->GetAnimInstance());
+	}
+
+	// Switching overlay state swaps the whole locomotion set.
+	const TObjectPtr<ULocomotionAnimData>* OverlayData = MainAnimInstance ? OverlayLocomotionAnimData.Find(MainAnimInstance->OverlayState) : nullptr;
+	LocomotionAnimData = OverlayData && *OverlayData ? *OverlayData : DefaultLocomotionAnimData;
+}
+
 void UCharacterLayersAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaSeconds)
 {
 	Super::NativeThreadSafeUpdateAnimation(DeltaSeconds);
-	if (GetCharacterAnimInstance())
+	CurveCache.Invalidate();
+	if (MainAnimInstance)
 	{
+		bIsServerAnimation = GetMainSnapshot().bIsServerAnimation;
 		UpdateJumpFallData(DeltaSeconds);
-		UpdateSkeletalControlData();
+		if (!bIsServerAnimation)
+		{
+			UpdateSkeletalControlData();
+		}
 	}
 }
 
 UCharacterAnimInstance* UCharacterLayersAnimInstance::GetCharacterAnimInstance()
 {
-	UCharacterAnimInstance* CAI = Cast<UCharacterAnimInstance>(GetOwningComponent()->GetAnimInstance());
-	if (CAI) return CAI;
-	else return nullptr;
+	return MainAnimInstance;
+}
+
+const FCharacterAnimSnapshot& UCharacterLayersAnimInstance::GetMainSnapshot() const
+{
+	static const FCharacterAnimSnapshot DefaultSnapshot;
+	return MainAnimInstance ? MainAnimInstance->GetAnimSnapshot() : DefaultSnapshot;
 }
 
 void UCharacterLayersAnimInstance::UpdateBlendWeightData(float DeltaSeconds)
 {
-	if (!bRaiseWeaponAfterFiringWhenCrouched && GetCharacterAnimInstance()->bIsCrouching ||
-		GetCharacterAnimInstance()->bIsCrouching && GetCharacterAnimInstance()->bIsOnGround)
+	if (bIsServerAnimation) return;
+
+	if (!bRaiseWeaponAfterFiringWhenCrouched && GetMainSnapshot().bIsCrouching ||
+		GetMainSnapshot().bIsCrouching && GetMainSnapshot().bIsOnGround)
 	{
 		HipFireUpperBodyOverrideWeight = 0.0f;
 		AimOffsetBlendWeight = 1.0f;
 	}
-	else if (GetCharacterAnimInstance()->TimeSinceFiredWeapon < RaiseWeaponAfterFiringDuration ||
-		(GetCharacterAnimInstance()->bIsCrouching || !GetCharacterAnimInstance()->bIsOnGround) ||
-		GetCurveValue(ApplyHipfireOverridePoseCurveName) > 0.0f)
+	else if (GetMainSnapshot().TimeSinceFiredWeapon < RaiseWeaponAfterFiringDuration ||
+		(GetMainSnapshot().bIsCrouching || !GetMainSnapshot().bIsOnGround) ||
+		CurveCache.GetValue(*this, ApplyHipfireOverridePoseCurve) > 0.0f)
 	{
 		HipFireUpperBodyOverrideWeight = 1.0f;
 		AimOffsetBlendWeight = 1.0f;
@@ -48,7 +134,7 @@ void UCharacterLayersAnimInstance::UpdateBlendWeightData(float DeltaSeconds)
 	{
 		HipFireUpperBodyOverrideWeight = UKismetMathLibrary::FInterpTo(HipFireUpperBodyOverrideWeight, 0.0f, DeltaSeconds, 1.0f);
 		// Use aiming aim offset when we are idle or we have root yaw offset. Use relaxed aim offset during regular motion.
-		bool PickA = UKismetMathLibrary::Abs(GetCharacterAnimInstance()->RootYawOffset) < 10.0f && GetCharacterAnimInstance()->bIsAccelerating;
+		bool PickA = UKismetMathLibrary::Abs(GetMainSnapshot().RootYawOffset) < 10.0f && GetMainSnapshot().bIsAccelerating;
 		AimOffsetBlendWeight = UKismetMathLibrary::FInterpTo(AimOffsetBlendWeight,
 			UKismetMathLibrary::SelectFloat(HipFireUpperBodyOverrideWeight, 1.0f, PickA), DeltaSeconds, 10.0f);
 	}
@@ -56,23 +142,26 @@ void UCharacterLayersAnimInstance::UpdateBlendWeightData(float DeltaSeconds)
 
 void UCharacterLayersAnimInstance::UpdateSkeletalControlData()
 {
+	bUseReducedGraph = GetMainSnapshot().bUseReducedGraph;
+
+	const bool bIsHandIKDisabled = DisableHandIK || GetMainSnapshot().SignificanceTier > MaxHandIKTier;
 	HandIK_RightAlpha = UKismetMathLibrary::FClamp(UKismetMathLibrary::SelectFloat(
-		0.0f, 1.0f, DisableHandIK) - GetCurveValue(DisableRHandIKCurveName), 0.0f, 1.0f);
+		0.0f, 1.0f, bIsHandIKDisabled) - CurveCache.GetValue(*this, DisableRHandIKCurve), 0.0f, 1.0f);
 	HandIK_LeftAlpha = UKismetMathLibrary::FClamp(UKismetMathLibrary::SelectFloat(
-		0.0f, 1.0f, DisableHandIK) - GetCurveValue(DisableLHandIKCurveName), 0.0f, 1.0f);
+		0.0f, 1.0f, bIsHandIKDisabled) - CurveCache.GetValue(*this, DisableLHandIKCurve), 0.0f, 1.0f);
 }
 
 void UCharacterLayersAnimInstance::SetLeftHandPoseOverrideWeight(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	LeftHandPoseOverrideWeight = UKismetMathLibrary::FClamp((UKismetMathLibrary::SelectFloat(1.0f, 0.0f,
-		bEnableLeftHandPoseOverride) - GetCurveValue(DisableLeftHandPoseOverrideCurveName)), 0.0f, 1.0f);
+		bEnableLeftHandPoseOverride) - CurveCache.GetValue(*this, DisableLeftHandPoseOverrideCurve)), 0.0f, 1.0f);
 }
 
 bool UCharacterLayersAnimInstance::ShouldEnableFootPlacement()
 {
-	if (UCharacterAnimInstance* CAI = GetCharacterAnimInstance())
+	if (MainAnimInstance)
 	{
-		return CAI->GetCurveValue(CAI->DisableLegIKCurveName) <= 0.0f && GetCharacterAnimInstance()->bUseFootPlacement;
+		return GetMainSnapshot().DisableLegIKCurveValue <= 0.0f && GetMainSnapshot().bUseFootPlacement;
 	}
 	else
 	{
@@ -84,7 +173,7 @@ void UCharacterLayersAnimInstance::UpdateHipFireRaiseWeaponPose(const FAnimUpdat
 {
 	EAnimNodeReferenceConversionResult Result;
 	UAnimSequence* SelectedAnimSequence = nullptr;
-	if (GetCharacterAnimInstance()->bIsCrouching)
+	if (GetMainSnapshot().bIsCrouching)
 	{
 		SelectedAnimSequence = AimHipFirePoseCrouchAnim;
 	}
@@ -98,7 +187,7 @@ void UCharacterLayersAnimInstance::UpdateHipFireRaiseWeaponPose(const FAnimUpdat
 void UCharacterLayersAnimInstance::ChooseIdleBreakDelayTime()
 {
 	IdleBreakDelayTime = 6 + UKismetMathLibrary::Percent_IntInt(UKismetMathLibrary::FTrunc(
-		UKismetMathLibrary::Abs(GetCharacterAnimInstance()->WorldLocation.X + GetCharacterAnimInstance()->WorldLocation.Y)), 10);
+		UKismetMathLibrary::Abs(GetMainSnapshot().WorldLocation.X + GetMainSnapshot().WorldLocation.Y)), 10);
 }
 
 void UCharacterLayersAnimInstance::ResetIdleBreakTransitionLogic()
@@ -120,7 +209,7 @@ void UCharacterLayersAnimInstance::ProcessIdleBreakTransitionLogic(float DeltaTi
 
 bool UCharacterLayersAnimInstance::CanPlayIdleBreak()
 {
-	return IdleBreaksAnims.Num() > 0 && !(GetCharacterAnimInstance()->bIsCrouching || GetCharacterAnimInstance()->bIsJumping);
+	return !bIsServerAnimation && LocomotionAnimData && LocomotionAnimData->IdleBreaksAnims.Num() > 0 && !(GetMainSnapshot().bIsCrouching || GetMainSnapshot().bIsJumping);
 }
 
 void UCharacterLayersAnimInstance::SetupIdleState(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
@@ -144,8 +233,10 @@ void UCharacterLayersAnimInstance::UpdateIdleAnim(const FAnimUpdateContext& Cont
 {
 	EAnimNodeReferenceConversionResult Result;
 	UAnimSequence* SelectedAnimSequence = nullptr;
-	if (GetCharacterAnimInstance()->bIsCrouching) SelectedAnimSequence = CrouchedIdleAnim;
-	else SelectedAnimSequence = IdleAnim;
+	if (LocomotionAnimData)
+	{
+		SelectedAnimSequence = GetMainSnapshot().bIsCrouching ? LocomotionAnimData->CrouchedIdleAnim : LocomotionAnimData->IdleAnim;
+	}
 
 	USequencePlayerLibrary::SetSequenceWithInertialBlending(Context, USequencePlayerLibrary::ConvertToSequencePlayer(Node, Result), SelectedAnimSequence);
 }
@@ -154,8 +245,10 @@ void UCharacterLayersAnimInstance::SetupIdleTransition(const FAnimUpdateContext&
 {
 	EAnimNodeReferenceConversionResult Result;
 	UAnimSequence* SelectedAnimSequence = nullptr;
-	if (GetCharacterAnimInstance()->bIsCrouching) SelectedAnimSequence = CrouchEnterAnim;
-	else SelectedAnimSequence = CrouchExitAnim;
+	if (LocomotionAnimData)
+	{
+		SelectedAnimSequence = GetMainSnapshot().bIsCrouching ? LocomotionAnimData->CrouchEnterAnim : LocomotionAnimData->CrouchExitAnim;
+	}
 
 	USequencePlayerLibrary::SetSequence(USequencePlayerLibrary::ConvertToSequencePlayer(Node, Result), SelectedAnimSequence);
 }
@@ -165,6 +258,18 @@ void UCharacterLayersAnimInstance::SetupIdleBreakAnim(const FAnimUpdateContext&
 	EAnimNodeReferenceConversionResult Result;
 	FSequencePlayerReference SequencePlayer = USequencePlayerLibrary::ConvertToSequencePlayer(Node, Result);
 
+	if (!LocomotionAnimData || LocomotionAnimData->IdleBreaksAnims.Num() == 0)
+	{
+		return;
+	}
+
+	// The overlay state may have swapped to data with fewer idle breaks since the last one.
+	const TArray<UAnimSequence*>& IdleBreaksAnims = LocomotionAnimData->IdleBreaksAnims;
+	if (CurrentIdleBreakIndex >= IdleBreaksAnims.Num())
+	{
+		CurrentIdleBreakIndex = 0;
+	}
+
 	USequencePlayerLibrary::SetSequence(SequencePlayer, IdleBreaksAnims[CurrentIdleBreakIndex]);
 	CurrentIdleBreakIndex++;
 	if (CurrentIdleBreakIndex >= IdleBreaksAnims.Num())
@@ -176,63 +281,9 @@ void UCharacterLayersAnimInstance::SetupIdleBreakAnim(const FAnimUpdateContext&
 void UCharacterLayersAnimInstance::SetupStartAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	EAnimNodeReferenceConversionResult Result;
-	UAnimSequence* SelectedAnimSequence = nullptr;
 	FSequenceEvaluatorReference SequenceEvaluator = USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result);
 
-	switch (GetCharacterAnimInstance()->CurrentGait)
-	{
-	case EGait::EG_Walking:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = WalkStartAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = WalkStartAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = WalkStartAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = WalkStartAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Jogging:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = JogStartAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = JogStartAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = JogStartAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = JogStartAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Crouching:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = CrouchStartAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = CrouchStartAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = CrouchStartAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = CrouchStartAnimations.Right;
-			break;
-		}
-		break;
-	}
+	UAnimSequence* SelectedAnimSequence = LocomotionAnimData ? LocomotionAnimData->SelectLocomotionAnim(ELocomotionAnimSet::ELAS_Start, GetMainSnapshot().CurrentGait, GetMainSnapshot().VelocityLocomotionDirection) : nullptr;
 
 	USequenceEvaluatorLibrary::SetSequence(SequenceEvaluator, SelectedAnimSequence);
 	USequenceEvaluatorLibrary::SetExplicitTime(SequenceEvaluator, 0.f);
@@ -248,9 +299,9 @@ void UCharacterLayersAnimInstance::UpdateStartAnim(const FAnimUpdateContext& Con
 	StrideWarpingStartAlpha = UKismetMathLibrary::MapRangeClamped(ExplicitTime - StrideWarpingBlendInStartOffset, 0.f,
 		StrideWarpingBlendInDurationScaled, 0.f, 1.f);
 
-	UAnimDistanceMatchingLibrary::AdvanceTimeByDistanceMatching(Context,
+	FDistanceMatchingCache::AdvanceTimeByDistanceMatching(Context,
 		SequenceEvaluator,
-		GetCharacterAnimInstance()->DisplacementSinceLastUpdate,
+		GetMainSnapshot().DisplacementSinceLastUpdate,
 		LocomotionDistanceCurveName,
 		FVector2D(UKismetMathLibrary::Lerp(StrideWarpingBlendInDurationScaled, PlayRateClampStartsPivots.X, StrideWarpingStartAlpha),
 		PlayRateClampStartsPivots.Y));
@@ -259,154 +310,49 @@ void UCharacterLayersAnimInstance::UpdateStartAnim(const FAnimUpdateContext& Con
 void UCharacterLayersAnimInstance::UpdateCycleAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	EAnimNodeReferenceConversionResult Result;
-	UAnimSequence* SelectedAnimSequence = nullptr;
 	FSequencePlayerReference SequencePlayer = USequencePlayerLibrary::ConvertToSequencePlayer(Node, Result);
 
-	switch (GetCharacterAnimInstance()->CurrentGait)
-	{
-	case EGait::EG_Walking:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = WalkCycleAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = WalkCycleAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = WalkCycleAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = WalkCycleAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Jogging:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = JogCycleAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = JogCycleAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = JogCycleAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = JogCycleAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Crouching:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = CrouchCycleAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = CrouchCycleAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = CrouchCycleAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = CrouchCycleAnimations.Right;
-			break;
-		}
-		break;
-	}
+	UAnimSequence* SelectedAnimSequence = LocomotionAnimData ? LocomotionAnimData->SelectLocomotionAnim(ELocomotionAnimSet::ELAS_Cycle, GetMainSnapshot().CurrentGait, GetMainSnapshot().VelocityLocomotionDirection) : nullptr;
 
 	USequencePlayerLibrary::SetSequenceWithInertialBlending(Context, SequencePlayer, SelectedAnimSequence);
-	UAnimDistanceMatchingLibrary::SetPlayrateToMatchSpeed(SequencePlayer, GetCharacterAnimInstance()->DisplacementSpeed, PlayRateClampCycle);
+	UAnimDistanceMatchingLibrary::SetPlayrateToMatchSpeed(SequencePlayer, GetMainSnapshot().DisplacementSpeed, PlayRateClampCycle);
 	
+	if (bIsServerAnimation) return;
+
 	StrideWarpingCycleAlpha = UKismetMathLibrary::FInterpTo(StrideWarpingCycleAlpha,
-		UKismetMathLibrary::SelectFloat(0.5f, 1.f, GetCharacterAnimInstance()->bIsRunningIntoWall),
+		UKismetMathLibrary::SelectFloat(0.5f, 1.f, GetMainSnapshot().bIsRunningIntoWall),
 		UAnimExecutionContextLibrary::GetDeltaTime(Context), 10.f);
 }
 
 bool UCharacterLayersAnimInstance::ShouldDistanceMatchStop()
 {
-	return !UKismetMathLibrary::NearlyEqual_FloatFloat(UKismetMathLibrary::VSizeXYSquared(GetCharacterAnimInstance()->LocalVelocity2D), 0.f)
-		&& !GetCharacterAnimInstance()->bIsAccelerating;
+	return !UKismetMathLibrary::NearlyEqual_FloatFloat(UKismetMathLibrary::VSizeXYSquared(GetMainSnapshot().LocalVelocity2D), 0.f)
+		&& !GetMainSnapshot().bIsAccelerating;
 }
 
 float UCharacterLayersAnimInstance::GetPredictedStopDistance()
 {
+	const FCharacterAnimSnapshot& MainSnapshot = GetMainSnapshot();
 	return UKismetMathLibrary::VSizeXY(UAnimCharacterMovementLibrary::PredictGroundMovementStopLocation(
-		GetCharacterAnimInstance()->GetCharacterMovement()->GetLastUpdateVelocity(),
-		GetCharacterAnimInstance()->GetCharacterMovement()->bUseSeparateBrakingFriction,
-		GetCharacterAnimInstance()->GetCharacterMovement()->BrakingFriction,
-		GetCharacterAnimInstance()->GetCharacterMovement()->GroundFriction,
-		GetCharacterAnimInstance()->GetCharacterMovement()->BrakingFrictionFactor,
-		GetCharacterAnimInstance()->GetCharacterMovement()->BrakingDecelerationWalking));
+		MainSnapshot.LastUpdateVelocity,
+		MainSnapshot.bUseSeparateBrakingFriction,
+		MainSnapshot.BrakingFriction,
+		MainSnapshot.GroundFriction,
+		MainSnapshot.BrakingFrictionFactor,
+		MainSnapshot.BrakingDecelerationWalking));
 }
 
 void UCharacterLayersAnimInstance::SetupStopAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	EAnimNodeReferenceConversionResult Result;
 	FSequenceEvaluatorReference SequenceEvaluator = USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result);
-	UAnimSequence* SelectedAnimSequence = nullptr;
 
-	switch (GetCharacterAnimInstance()->CurrentGait)
-	{
-	case EGait::EG_Walking:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = WalkStopAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = WalkStopAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = WalkStopAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = WalkStopAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Jogging:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = JogStopAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = JogStopAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = JogStopAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = JogStopAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Crouching:
-		switch ((GetCharacterAnimInstance()->VelocityLocomotionDirection))
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = CrouchStopAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = CrouchStopAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = CrouchStopAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = CrouchStopAnimations.Right;
-			break;
-		}
-		break;
-	}
+	UAnimSequence* SelectedAnimSequence = LocomotionAnimData ? LocomotionAnimData->SelectLocomotionAnim(ELocomotionAnimSet::ELAS_Stop, GetMainSnapshot().CurrentGait, GetMainSnapshot().VelocityLocomotionDirection) : nullptr;
 
 	USequenceEvaluatorLibrary::SetSequence(SequenceEvaluator, SelectedAnimSequence);
 	if (ShouldDistanceMatchStop() == false) // If we got here, and we can't distance match a stop on start, match to 0 distance
 	{
-		UAnimDistanceMatchingLibrary::DistanceMatchToTarget(SequenceEvaluator, 0.f, LocomotionDistanceCurveName);
+		FDistanceMatchingCache::DistanceMatchToTarget(SequenceEvaluator, 0.f, LocomotionDistanceCurveName);
 	}
 }
 
@@ -419,7 +365,7 @@ void UCharacterLayersAnimInstance::UpdateStopAnim(const FAnimUpdateContext& Cont
 		float DistanceToMatch = GetPredictedStopDistance();
 		if (DistanceToMatch > 0.f) // Distance Match to the stop point
 		{
-			UAnimDistanceMatchingLibrary::DistanceMatchToTarget(SequenceEvaluator, DistanceToMatch, LocomotionDistanceCurveName);
+			FDistanceMatchingCache::DistanceMatchToTarget(SequenceEvaluator, DistanceToMatch, LocomotionDistanceCurveName);
 		}
 		else
 		{
@@ -438,13 +384,16 @@ void UCharacterLayersAnimInstance::SetupPivotAnim(const FAnimUpdateContext& Cont
 {
 	EAnimNodeReferenceConversionResult Result;
 	FSequenceEvaluatorReference SequenceEvaluator = USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result);
-	PivotStartingAcceleration = GetCharacterAnimInstance()->LocalAcceleration2D;
+	PivotStartingAcceleration = GetMainSnapshot().LocalAcceleration2D;
 
-	USequenceEvaluatorLibrary::SetSequence(SequenceEvaluator, SelectPivotSequence((GetCharacterAnimInstance()->AccelerationLocomotionDirection)));
+	USequenceEvaluatorLibrary::SetSequence(SequenceEvaluator, SelectPivotSequence((GetMainSnapshot().AccelerationLocomotionDirection)));
 	USequenceEvaluatorLibrary::SetExplicitTime(SequenceEvaluator, 0.f);
 	StrideWarpingPivotAlpha = 0.f;
 	TimeAtPivotStop = 0.f;
-	GetCharacterAnimInstance()->LastPivotTime = 0.2f;
+	if (MainAnimInstance)
+	{
+		MainAnimInstance->SetLastPivotTime(0.2f);
+	}
 }
 
 void UCharacterLayersAnimInstance::UpdatePivotAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
@@ -453,26 +402,26 @@ void UCharacterLayersAnimInstance::UpdatePivotAnim(const FAnimUpdateContext& Con
 	FSequenceEvaluatorReference SequenceEvaluator = USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result);
 	float ExplicitTime = USequenceEvaluatorLibrary::GetAccumulatedTime(SequenceEvaluator);
 
-	if (GetCharacterAnimInstance()->LastPivotTime > 0.0f) // Allow switching the selected pivot for a short duration at the beginning.
+	if (GetMainSnapshot().LastPivotTime > 0.0f) // Allow switching the selected pivot for a short duration at the beginning.
 	{
-		UAnimSequence* NewDesiredSequence = SelectPivotSequence(GetCharacterAnimInstance()->AccelerationLocomotionDirection);
+		UAnimSequence* NewDesiredSequence = SelectPivotSequence(GetMainSnapshot().AccelerationLocomotionDirection);
 		if (NewDesiredSequence != USequenceEvaluatorLibrary::GetSequence(SequenceEvaluator))
 		{
 			USequenceEvaluatorLibrary::SetSequenceWithInertialBlending(Context, SequenceEvaluator, NewDesiredSequence);
-			PivotStartingAcceleration = GetCharacterAnimInstance()->LocalAcceleration2D;
+			PivotStartingAcceleration = GetMainSnapshot().LocalAcceleration2D;
 		}
 	}
 
-	if (UKismetMathLibrary::Dot_VectorVector(GetCharacterAnimInstance()->LocalVelocity2D,
-		GetCharacterAnimInstance()->LocalAcceleration2D) < 0.f) // Does acceleration oppose velocity?
+	if (UKismetMathLibrary::Dot_VectorVector(GetMainSnapshot().LocalVelocity2D,
+		GetMainSnapshot().LocalAcceleration2D) < 0.f) // Does acceleration oppose velocity?
 	{
 		// While acceleration opposes velocity, the character is still approaching the pivot point,
 		// so we distance match to that point.
 		float DistanceToMatch = UKismetMathLibrary::VSizeXY(UAnimCharacterMovementLibrary::PredictGroundMovementPivotLocation(
-			GetCharacterAnimInstance()->GetCharacterMovement()->GetCurrentAcceleration(),
-			GetCharacterAnimInstance()->GetCharacterMovement()->GetLastUpdateVelocity(),
-			GetCharacterAnimInstance()->GetCharacterMovement()->GroundFriction));
-		UAnimDistanceMatchingLibrary::DistanceMatchToTarget(SequenceEvaluator, DistanceToMatch, LocomotionDistanceCurveName);
+			GetMainSnapshot().CurrentAcceleration,
+			GetMainSnapshot().LastUpdateVelocity,
+			GetMainSnapshot().GroundFriction));
+		FDistanceMatchingCache::DistanceMatchToTarget(SequenceEvaluator, DistanceToMatch, LocomotionDistanceCurveName);
 		TimeAtPivotStop = ExplicitTime;
 	}
 	else 
@@ -484,9 +433,9 @@ void UCharacterLayersAnimInstance::UpdatePivotAnim(const FAnimUpdateContext& Con
 
 		// Once acceleration and velocity are aligned, the character is accelerating away from the pivot point,
 		// so we just advance time by distance traveled for the rest of the animation.
-		UAnimDistanceMatchingLibrary::AdvanceTimeByDistanceMatching(Context,
+		FDistanceMatchingCache::AdvanceTimeByDistanceMatching(Context,
 			SequenceEvaluator,
-			GetCharacterAnimInstance()->DisplacementSinceLastUpdate,
+			GetMainSnapshot().DisplacementSinceLastUpdate,
 			LocomotionDistanceCurveName,
 			FVector2D(UKismetMathLibrary::Lerp(0.2f, PlayRateClampStartsPivots.X, StrideWarpingPivotAlpha), PlayRateClampStartsPivots.Y)); // Smoothly increase the minimum playrate speed, as we blend in stride warping
 	}
@@ -494,69 +443,12 @@ void UCharacterLayersAnimInstance::UpdatePivotAnim(const FAnimUpdateContext& Con
 
 UAnimSequence* UCharacterLayersAnimInstance::SelectPivotSequence(ELocomotionDirections InDirection)
 {
-	UAnimSequence* SelectedAnimSequence = nullptr;
-
-	switch (GetCharacterAnimInstance()->CurrentGait)
-	{
-	case EGait::EG_Walking:
-		switch (InDirection)
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = WalkPivotAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = WalkPivotAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = WalkPivotAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = WalkPivotAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Jogging:
-		switch (InDirection)
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = JogPivotAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = JogPivotAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = JogPivotAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = JogPivotAnimations.Right;
-			break;
-		}
-		break;
-	case EGait::EG_Crouching:
-		switch (InDirection)
-		{
-		case ELocomotionDirections::ELD_Backward:
-			SelectedAnimSequence = CrouchPivotAnimations.Backward;
-			break;
-		case ELocomotionDirections::ELD_Forward:
-			SelectedAnimSequence = CrouchPivotAnimations.Forward;
-			break;
-		case ELocomotionDirections::ELD_Left:
-			SelectedAnimSequence = CrouchPivotAnimations.Left;
-			break;
-		case ELocomotionDirections::ELD_Right:
-			SelectedAnimSequence = CrouchPivotAnimations.Right;
-			break;
-		}
-		break;
-	}
-
-	return SelectedAnimSequence;
+	return LocomotionAnimData ? LocomotionAnimData->SelectLocomotionAnim(ELocomotionAnimSet::ELAS_Pivot, GetMainSnapshot().CurrentGait, InDirection) : nullptr;
 }
 
 void UCharacterLayersAnimInstance::SetupTurnInPlaceEntry(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
-	TurnInPlaceRotationAngle = UKismetMathLibrary::SignOfFloat(GetCharacterAnimInstance()->RootYawOffset) * (-1);
+	TurnInPlaceRotationAngle = UKismetMathLibrary::SignOfFloat(GetMainSnapshot().RootYawOffset) * (-1);
 }
 
 void UCharacterLayersAnimInstance::SetupTurnInPlaceAnims(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
@@ -581,28 +473,7 @@ void UCharacterLayersAnimInstance::UpdateTurnInPlaceAnims(const FAnimUpdateConte
 
 UAnimSequence* UCharacterLayersAnimInstance::SelectTurnInPlaceAnim(float InAngle)
 {
-	if (InAngle > 0.f)
-	{
-		if (GetCharacterAnimInstance()->bIsCrouching)
-		{
-			return CrouchTurnRight90Anim;
-		}
-		else
-		{
-			return TurnRight90Anim;
-		}
-	}
-	else
-	{
-		if (GetCharacterAnimInstance()->bIsCrouching)
-		{
-			return CrouchTurnLeft90Anim;
-		}
-		else
-		{
-			return TurnLeft90Anim;
-		}
-	}
+	return LocomotionAnimData ? LocomotionAnimData->SelectTurnInPlaceAnim(GetMainSnapshot().bIsCrouching, InAngle > 0.f) : nullptr;
 
 	/*bool bIsWideRange = UKismetMathLibrary::InRange_FloatFloat(UKismetMathLibrary::Abs(UKismetMathLibrary::NormalizeAxis(
 		GetCharacterAnimInstance()->RootYawOffset)), 90.f, 180.f);
@@ -650,7 +521,7 @@ void UCharacterLayersAnimInstance::UpdateTurnInPlaceRecoveryAnim(const FAnimUpda
 void UCharacterLayersAnimInstance::LandRecoveryStart(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	const float ClampedTime = UKismetMathLibrary::MapRangeClamped(TimeFalling, 0.0f, 0.4f, 0.1f, 1.0f);
-	LandRecoveryAlpha = UKismetMathLibrary::SelectFloat(ClampedTime * 0.5f, ClampedTime, GetCharacterAnimInstance()->bIsCrouching);
+	LandRecoveryAlpha = UKismetMathLibrary::SelectFloat(ClampedTime * 0.5f, ClampedTime, GetMainSnapshot().bIsCrouching);
 }
 
 void UCharacterLayersAnimInstance::SetupFallLandAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
@@ -662,17 +533,17 @@ void UCharacterLayersAnimInstance::SetupFallLandAnim(const FAnimUpdateContext& C
 void UCharacterLayersAnimInstance::UpdateFallLandAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node)
 {
 	EAnimNodeReferenceConversionResult Result;
-	UAnimDistanceMatchingLibrary::DistanceMatchToTarget(USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result),
-		GetCharacterAnimInstance()->GroundDistance, JumpDistanceCurveName);
+	FDistanceMatchingCache::DistanceMatchToTarget(USequenceEvaluatorLibrary::ConvertToSequenceEvaluator(Node, Result),
+		GetMainSnapshot().GroundDistance, JumpDistanceCurveName);
 }
 
 void UCharacterLayersAnimInstance::UpdateJumpFallData(float DeltaSeconds)
 {
-	if (GetCharacterAnimInstance()->bIsFalling)
+	if (GetMainSnapshot().bIsFalling)
 	{
 		TimeFalling = TimeFalling + DeltaSeconds;
 	}
-	else if (GetCharacterAnimInstance()->bIsJumping)
+	else if (GetMainSnapshot().bIsJumping)
 	{
 		TimeFalling = 0.0f;
 	}
@@ -0,0 +1,392 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/CharacterLocomotionSubsystem.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/Pawn.h"
+#include "Math/VectorRegister.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeLocomotion"), STATGROUP_HopeLocomotion, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Locomotion Solve"), STAT_HopeLocomotionSolve, STATGROUP_HopeLocomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Locomotion Batched Characters"), STAT_HopeLocomotionBatched, STATGROUP_HopeLocomotion);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Locomotion Single Solves"), STAT_HopeLocomotionSingle, STATGROUP_HopeLocomotion);
+
+namespace HopeLocomotion
+{
+	static bool bBatchSolve = true;
+	FAutoConsoleVariableRef CVar_BatchSolve(TEXT("Hope.Locomotion.BatchSolve"), bBatchSolve,
+		TEXT("Computes the locomotion values of all characters in one vectorized pass. When off every character is solved on its own."), ECVF_Default);
+
+	// Tolerances of the "UKismetMathLibrary" and "UKismetAnimationLibrary" functions this replaces.
+	static constexpr float NormalTolerance = 1.e-4f;
+	static constexpr float AcceleratingTolerance = 1.e-6f;
+	static constexpr float DirectionTolerance = UE_KINDA_SMALL_NUMBER;
+
+	// Running into a wall: accelerating, slow and the acceleration roughly sideways to the velocity.
+	static constexpr float WallMinAcceleration = 0.1f;
+	static constexpr float WallMaxSpeed = 200.f;
+	static constexpr float WallMaxDot = 0.6f;
+
+	static FVector SafeNormal2D(const FVector& Vector)
+	{
+		return FVector(Vector.X, Vector.Y, 0.f).GetSafeNormal(NormalTolerance);
+	}
+
+	// Same as "UKismetAnimationLibrary::CalculateDirection" for a yaw only rotation.
+	static float DirectionAngle(const FVector& World2D, const FVector& Local2D)
+	{
+		if (FMath::Abs(World2D.X) <= DirectionTolerance && FMath::Abs(World2D.Y) <= DirectionTolerance)
+		{
+			return 0.f;
+		}
+		return FMath::RadiansToDegrees(FMath::Atan2(Local2D.Y, Local2D.X));
+	}
+
+	static FORCEINLINE void VectorSafeNormal2D(const VectorRegister4Float& X, const VectorRegister4Float& Y,
+		VectorRegister4Float& OutX, VectorRegister4Float& OutY)
+	{
+		const VectorRegister4Float Tolerance = VectorSetFloat1(NormalTolerance);
+		const VectorRegister4Float SizeSquared = VectorMultiplyAdd(X, X, VectorMultiply(Y, Y));
+		const VectorRegister4Float InvSize = VectorReciprocalSqrt(VectorMax(SizeSquared, Tolerance));
+		const VectorRegister4Float IsValid = VectorCompareGE(SizeSquared, Tolerance);
+		OutX = VectorSelect(IsValid, VectorMultiply(X, InvSize), VectorZeroFloat());
+		OutY = VectorSelect(IsValid, VectorMultiply(Y, InvSize), VectorZeroFloat());
+	}
+
+	static FORCEINLINE VectorRegister4Float VectorDirectionAngle(const VectorRegister4Float& WorldX, const VectorRegister4Float& WorldY,
+		const VectorRegister4Float& LocalX, const VectorRegister4Float& LocalY)
+	{
+		const VectorRegister4Float Tolerance = VectorSetFloat1(DirectionTolerance);
+		const VectorRegister4Float IsMoving = VectorBitwiseOr(VectorCompareGT(VectorAbs(WorldX), Tolerance), VectorCompareGT(VectorAbs(WorldY), Tolerance));
+		const VectorRegister4Float Angle = VectorMultiply(VectorATan2(LocalY, LocalX), VectorSetFloat1(UE_INV_PI * 180.f));
+		return VectorSelect(IsMoving, Angle, VectorZeroFloat());
+	}
+}
+
+void FCharacterLocomotionTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+	{
+		Subsystem->SolveAll();
+	}
+}
+
+FString FCharacterLocomotionTickFunction::DiagnosticMessage()
+{
+	return TEXT("FCharacterLocomotionTickFunction");
+}
+
+void UCharacterLocomotionSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	TickFunction.Subsystem = this;
+	TickFunction.TickGroup = TG_PrePhysics;
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = true;
+	TickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	// Characters placed in the level registered before the tick function existed.
+	for (FCharacterSlot& CharacterSlot : Slots)
+	{
+		if (CharacterSlot.bIsUsed)
+		{
+			AddPrerequisites(CharacterSlot);
+		}
+	}
+}
+
+void UCharacterLocomotionSubsystem::Deinitialize()
+{
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	TickFunction.Subsystem = nullptr;
+	Slots.Reset();
+	FreeSlots.Reset();
+	LaneSlots.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 UCharacterLocomotionSubsystem::RegisterCharacter(APawn* Owner, UCharacterMovementComponent* MovementComponent, USkeletalMeshComponent* Mesh)
+{
+	if (!Owner || !MovementComponent || !Mesh)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 Slot = FreeSlots.Num() > 0 ? FreeSlots.Pop(EAllowShrinking::No) : Slots.AddDefaulted();
+	FCharacterSlot& CharacterSlot = Slots[Slot];
+	CharacterSlot = FCharacterSlot();
+	CharacterSlot.Owner = Owner;
+	CharacterSlot.MovementComponent = MovementComponent;
+	CharacterSlot.Mesh = Mesh;
+	CharacterSlot.bIsUsed = true;
+
+	AddPrerequisites(CharacterSlot);
+	return Slot;
+}
+
+void UCharacterLocomotionSubsystem::UnregisterCharacter(int32 Slot)
+{
+	if (!Slots.IsValidIndex(Slot) || !Slots[Slot].bIsUsed)
+	{
+		return;
+	}
+
+	RemovePrerequisites(Slots[Slot]);
+	Slots[Slot] = FCharacterSlot();
+	FreeSlots.Add(Slot);
+}
+
+void UCharacterLocomotionSubsystem::AddPrerequisites(FCharacterSlot& CharacterSlot)
+{
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		return;
+	}
+
+	if (UCharacterMovementComponent* MovementComponent = CharacterSlot.MovementComponent.Get())
+	{
+		TickFunction.AddPrerequisite(MovementComponent, MovementComponent->PrimaryComponentTick);
+	}
+	if (USkeletalMeshComponent* Mesh = CharacterSlot.Mesh.Get())
+	{
+		Mesh->PrimaryComponentTick.AddPrerequisite(this, TickFunction);
+	}
+}
+
+void UCharacterLocomotionSubsystem::RemovePrerequisites(FCharacterSlot& CharacterSlot)
+{
+	if (!TickFunction.IsTickFunctionRegistered())
+	{
+		return;
+	}
+
+	if (UCharacterMovementComponent* MovementComponent = CharacterSlot.MovementComponent.Get())
+	{
+		TickFunction.RemovePrerequisite(MovementComponent, MovementComponent->PrimaryComponentTick);
+	}
+	if (USkeletalMeshComponent* Mesh = CharacterSlot.Mesh.Get())
+	{
+		Mesh->PrimaryComponentTick.RemovePrerequisite(this, TickFunction);
+	}
+}
+
+void UCharacterLocomotionSubsystem::SolveAll()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HopeLocomotionSolve);
+
+	LaneSlots.Reset();
+	if (!HopeLocomotion::bBatchSolve)
+	{
+		return;
+	}
+
+	for (int32 Slot = 0; Slot < Slots.Num(); ++Slot)
+	{
+		const FCharacterSlot& CharacterSlot = Slots[Slot];
+		if (CharacterSlot.bIsUsed && CharacterSlot.Owner.IsValid() && CharacterSlot.MovementComponent.IsValid())
+		{
+			LaneSlots.Add(Slot);
+		}
+	}
+
+	const int32 NumLanes = LaneSlots.Num();
+	INC_DWORD_STAT_BY(STAT_HopeLocomotionBatched, NumLanes);
+	if (NumLanes == 0)
+	{
+		return;
+	}
+
+	const int32 NumPaddedLanes = Align(NumLanes, 4);
+	for (TArray<float>* Buffer : { &DisplacementX, &DisplacementY, &Yaw, &VelocityX, &VelocityY, &AccelerationX, &AccelerationY, &PivotX, &PivotY,
+		&OutDisplacement, &OutLocalVelocityX, &OutLocalVelocityY, &OutLocalAccelerationX, &OutLocalAccelerationY, &OutVelocityAngle,
+		&OutAccelerationAngle, &OutPivotX, &OutPivotY, &OutIsMoving, &OutIsAccelerating, &OutIsRunningIntoWall })
+	{
+		Buffer->SetNumZeroed(NumPaddedLanes, EAllowShrinking::No);
+	}
+
+	for (int32 Lane = 0; Lane < NumPaddedLanes; ++Lane)
+	{
+		if (Lane >= NumLanes)
+		{
+			// Padding lanes of an earlier, larger batch still hold its inputs. Their outputs are never read.
+			DisplacementX[Lane] = DisplacementY[Lane] = Yaw[Lane] = 0.f;
+			VelocityX[Lane] = VelocityY[Lane] = AccelerationX[Lane] = AccelerationY[Lane] = PivotX[Lane] = PivotY[Lane] = 0.f;
+			continue;
+		}
+
+		FCharacterSlot& CharacterSlot = Slots[LaneSlots[Lane]];
+		const APawn* Owner = CharacterSlot.Owner.Get();
+		const FVector Location = Owner->GetActorLocation();
+		const FVector Displacement = CharacterSlot.State.bHasLastLocation ? Location - CharacterSlot.State.LastLocation : FVector::ZeroVector;
+		const FVector Velocity = Owner->GetVelocity();
+		const FVector Acceleration = CharacterSlot.MovementComponent->GetCurrentAcceleration();
+
+		DisplacementX[Lane] = Displacement.X;
+		DisplacementY[Lane] = Displacement.Y;
+		Yaw[Lane] = Owner->GetActorRotation().Yaw;
+		VelocityX[Lane] = Velocity.X;
+		VelocityY[Lane] = Velocity.Y;
+		AccelerationX[Lane] = Acceleration.X;
+		AccelerationY[Lane] = Acceleration.Y;
+		PivotX[Lane] = CharacterSlot.State.PivotDirection2D.X;
+		PivotY[Lane] = CharacterSlot.State.PivotDirection2D.Y;
+
+		CharacterSlot.GatheredLocation = Location;
+		CharacterSlot.Lane = Lane;
+		CharacterSlot.SolvedFrame = GFrameCounter;
+	}
+
+	RunKernel(NumPaddedLanes);
+}
+
+void UCharacterLocomotionSubsystem::RunKernel(int32 NumLanes)
+{
+	using namespace HopeLocomotion;
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float Half = VectorSetFloat1(0.5f);
+	const VectorRegister4Float DegreesToRadians = VectorSetFloat1(UE_PI / 180.f);
+	const VectorRegister4Float AcceleratingToleranceV = VectorSetFloat1(AcceleratingTolerance);
+	const VectorRegister4Float WallMinAccelerationSquared = VectorSetFloat1(WallMinAcceleration * WallMinAcceleration);
+	const VectorRegister4Float WallMaxSpeedSquared = VectorSetFloat1(WallMaxSpeed * WallMaxSpeed);
+	const VectorRegister4Float WallMaxDotV = VectorSetFloat1(WallMaxDot);
+
+	for (int32 Lane = 0; Lane < NumLanes; Lane += 4)
+	{
+		// Location
+		const VectorRegister4Float DX = VectorLoad(DisplacementX.GetData() + Lane);
+		const VectorRegister4Float DY = VectorLoad(DisplacementY.GetData() + Lane);
+		VectorStore(VectorSqrt(VectorMultiplyAdd(DX, DX, VectorMultiply(DY, DY))), OutDisplacement.GetData() + Lane);
+
+		// Velocity and acceleration into actor space.
+		VectorRegister4Float Sin, Cos;
+		const VectorRegister4Float YawRadians = VectorMultiply(VectorLoad(Yaw.GetData() + Lane), DegreesToRadians);
+		VectorSinCos(&Sin, &Cos, &YawRadians);
+
+		const VectorRegister4Float VX = VectorLoad(VelocityX.GetData() + Lane);
+		const VectorRegister4Float VY = VectorLoad(VelocityY.GetData() + Lane);
+		const VectorRegister4Float LVX = VectorMultiplyAdd(Cos, VX, VectorMultiply(Sin, VY));
+		const VectorRegister4Float LVY = VectorSubtract(VectorMultiply(Cos, VY), VectorMultiply(Sin, VX));
+		VectorStore(LVX, OutLocalVelocityX.GetData() + Lane);
+		VectorStore(LVY, OutLocalVelocityY.GetData() + Lane);
+
+		const VectorRegister4Float AX = VectorLoad(AccelerationX.GetData() + Lane);
+		const VectorRegister4Float AY = VectorLoad(AccelerationY.GetData() + Lane);
+		const VectorRegister4Float LAX = VectorMultiplyAdd(Cos, AX, VectorMultiply(Sin, AY));
+		const VectorRegister4Float LAY = VectorSubtract(VectorMultiply(Cos, AY), VectorMultiply(Sin, AX));
+		VectorStore(LAX, OutLocalAccelerationX.GetData() + Lane);
+		VectorStore(LAY, OutLocalAccelerationY.GetData() + Lane);
+
+		// Locomotion
+		VectorStore(VectorDirectionAngle(VX, VY, LVX, LVY), OutVelocityAngle.GetData() + Lane);
+		VectorStore(VectorDirectionAngle(AX, AY, LAX, LAY), OutAccelerationAngle.GetData() + Lane);
+
+		const VectorRegister4Float IsMoving = VectorBitwiseOr(VectorCompareNE(LVX, Zero), VectorCompareNE(LVY, Zero));
+		VectorStore(VectorSelect(IsMoving, One, Zero), OutIsMoving.GetData() + Lane);
+
+		const VectorRegister4Float LocalAccelerationSquared = VectorMultiplyAdd(LAX, LAX, VectorMultiply(LAY, LAY));
+		VectorStore(VectorSelect(VectorCompareGT(LocalAccelerationSquared, AcceleratingToleranceV), One, Zero), OutIsAccelerating.GetData() + Lane);
+
+		// Pivot direction eases halfway towards the acceleration direction every update.
+		VectorRegister4Float NAX, NAY;
+		VectorSafeNormal2D(AX, AY, NAX, NAY);
+		const VectorRegister4Float PX = VectorLoad(PivotX.GetData() + Lane);
+		const VectorRegister4Float PY = VectorLoad(PivotY.GetData() + Lane);
+		VectorRegister4Float NewPX, NewPY;
+		VectorSafeNormal2D(VectorMultiplyAdd(VectorSubtract(NAX, PX), Half, PX), VectorMultiplyAdd(VectorSubtract(NAY, PY), Half, PY), NewPX, NewPY);
+		VectorStore(NewPX, OutPivotX.GetData() + Lane);
+		VectorStore(NewPY, OutPivotY.GetData() + Lane);
+
+		// Wall detection
+		VectorRegister4Float NLAX, NLAY, NLVX, NLVY;
+		VectorSafeNormal2D(LAX, LAY, NLAX, NLAY);
+		VectorSafeNormal2D(LVX, LVY, NLVX, NLVY);
+		const VectorRegister4Float AbsDot = VectorAbs(VectorMultiplyAdd(NLAX, NLVX, VectorMultiply(NLAY, NLVY)));
+		const VectorRegister4Float LocalVelocitySquared = VectorMultiplyAdd(LVX, LVX, VectorMultiply(LVY, LVY));
+		const VectorRegister4Float IsRunningIntoWall = VectorBitwiseAnd(VectorBitwiseAnd(
+			VectorCompareGT(LocalAccelerationSquared, WallMinAccelerationSquared),
+			VectorCompareLT(LocalVelocitySquared, WallMaxSpeedSquared)),
+			VectorCompareLE(AbsDot, WallMaxDotV));
+		VectorStore(VectorSelect(IsRunningIntoWall, One, Zero), OutIsRunningIntoWall.GetData() + Lane);
+	}
+}
+
+bool UCharacterLocomotionSubsystem::ConsumeResult(int32 Slot, FCharacterLocomotionResult& OutResult)
+{
+	if (!Slots.IsValidIndex(Slot) || !Slots[Slot].bIsUsed)
+	{
+		return false;
+	}
+
+	FCharacterSlot& CharacterSlot = Slots[Slot];
+	if (CharacterSlot.Lane == INDEX_NONE || CharacterSlot.SolvedFrame != GFrameCounter)
+	{
+		// Registered after this frame's batch, already consumed this frame or batching is off.
+		const APawn* Owner = CharacterSlot.Owner.Get();
+		const UCharacterMovementComponent* MovementComponent = CharacterSlot.MovementComponent.Get();
+		if (!Owner || !MovementComponent)
+		{
+			return false;
+		}
+
+		INC_DWORD_STAT(STAT_HopeLocomotionSingle);
+		SolveSingle(CharacterSlot.State, Owner->GetActorLocation(), Owner->GetActorRotation().Yaw, Owner->GetVelocity(),
+			MovementComponent->GetCurrentAcceleration(), OutResult);
+		return true;
+	}
+
+	const int32 Lane = CharacterSlot.Lane;
+	OutResult.LocalVelocity2D = FVector(OutLocalVelocityX[Lane], OutLocalVelocityY[Lane], 0.f);
+	OutResult.LocalAcceleration2D = FVector(OutLocalAccelerationX[Lane], OutLocalAccelerationY[Lane], 0.f);
+	OutResult.PivotDirection2D = FVector(OutPivotX[Lane], OutPivotY[Lane], 0.f);
+	OutResult.DisplacementSinceLastUpdate = OutDisplacement[Lane];
+	OutResult.VelocityLocomotionAngle = OutVelocityAngle[Lane];
+	OutResult.AccelerationLocomotionAngle = OutAccelerationAngle[Lane];
+	OutResult.bIsMoving = OutIsMoving[Lane] != 0.f;
+	OutResult.bIsAccelerating = OutIsAccelerating[Lane] != 0.f;
+	OutResult.bIsRunningIntoWall = OutIsRunningIntoWall[Lane] != 0.f;
+
+	// Anim updates skipped by update rate optimizations do not consume, so their next displacement covers the skipped frames.
+	CharacterSlot.State.LastLocation = CharacterSlot.GatheredLocation;
+	CharacterSlot.State.PivotDirection2D = OutResult.PivotDirection2D;
+	CharacterSlot.State.bHasLastLocation = true;
+	CharacterSlot.Lane = INDEX_NONE;
+	return true;
+}
+
+void UCharacterLocomotionSubsystem::SolveSingle(FCharacterLocomotionState& State, const FVector& Location, float Yaw, const FVector& Velocity,
+	const FVector& Acceleration, FCharacterLocomotionResult& OutResult)
+{
+	using namespace HopeLocomotion;
+
+	const FVector Displacement = State.bHasLastLocation ? Location - State.LastLocation : FVector::ZeroVector;
+	OutResult.DisplacementSinceLastUpdate = Displacement.Size2D();
+
+	float Sin, Cos;
+	FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(Yaw));
+	const FVector Velocity2D(Velocity.X, Velocity.Y, 0.f);
+	const FVector Acceleration2D(Acceleration.X, Acceleration.Y, 0.f);
+	OutResult.LocalVelocity2D = FVector(Cos * Velocity2D.X + Sin * Velocity2D.Y, Cos * Velocity2D.Y - Sin * Velocity2D.X, 0.f);
+	OutResult.LocalAcceleration2D = FVector(Cos * Acceleration2D.X + Sin * Acceleration2D.Y, Cos * Acceleration2D.Y - Sin * Acceleration2D.X, 0.f);
+
+	OutResult.VelocityLocomotionAngle = DirectionAngle(Velocity2D, OutResult.LocalVelocity2D);
+	OutResult.AccelerationLocomotionAngle = DirectionAngle(Acceleration2D, OutResult.LocalAcceleration2D);
+	OutResult.bIsMoving = !OutResult.LocalVelocity2D.IsZero();
+	OutResult.bIsAccelerating = OutResult.LocalAcceleration2D.SizeSquared2D() > AcceleratingTolerance;
+	OutResult.PivotDirection2D = SafeNormal2D(FMath::Lerp(State.PivotDirection2D, SafeNormal2D(Acceleration2D), 0.5f));
+
+	OutResult.bIsRunningIntoWall = OutResult.LocalAcceleration2D.SizeSquared2D() > FMath::Square(WallMinAcceleration)
+		&& OutResult.LocalVelocity2D.SizeSquared2D() < FMath::Square(WallMaxSpeed)
+		&& FMath::Abs(SafeNormal2D(OutResult.LocalAcceleration2D) | SafeNormal2D(OutResult.LocalVelocity2D)) <= WallMaxDot;
+
+	State.LastLocation = Location;
+	State.PivotDirection2D = OutResult.PivotDirection2D;
+	State.bHasLastLocation = true;
+}
@@ -0,0 +1,194 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/CharacterSignificanceSubsystem.h"
+#include "Character/CharacterBase.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeSignificance"), STATGROUP_HopeSignificance, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_HopeSignificanceUpdate, STATGROUP_HopeSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Critical"), STAT_HopeSignificanceCritical, STATGROUP_HopeSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters High"), STAT_HopeSignificanceHigh, STATGROUP_HopeSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Medium"), STAT_HopeSignificanceMedium, STATGROUP_HopeSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Characters Low"), STAT_HopeSignificanceLow, STATGROUP_HopeSignificance);
+
+namespace HopeSignificance
+{
+	static float UpdateInterval = 0.2f;
+	FAutoConsoleVariableRef CVar_UpdateInterval(TEXT("Hope.Significance.UpdateInterval"), UpdateInterval,
+		TEXT("Seconds between two significance updates of all characters."), ECVF_Default);
+
+	static float HighDistance = 2000.f;
+	FAutoConsoleVariableRef CVar_HighDistance(TEXT("Hope.Significance.HighDistance"), HighDistance,
+		TEXT("Characters closer than this to a local viewer are High."), ECVF_Default);
+
+	static float MediumDistance = 5000.f;
+	FAutoConsoleVariableRef CVar_MediumDistance(TEXT("Hope.Significance.MediumDistance"), MediumDistance,
+		TEXT("Characters closer than this to a local viewer are Medium, further ones Low."), ECVF_Default);
+
+	static int32 MediumTickRate = 2;
+	FAutoConsoleVariableRef CVar_MediumTickRate(TEXT("Hope.Significance.MediumTickRate"), MediumTickRate,
+		TEXT("Animation of Medium characters updates every this many frames."), ECVF_Default);
+
+	static int32 LowTickRate = 4;
+	FAutoConsoleVariableRef CVar_LowTickRate(TEXT("Hope.Significance.LowTickRate"), LowTickRate,
+		TEXT("Animation of Low characters updates every this many frames."), ECVF_Default);
+
+	// Characters not rendered for this long count as hidden.
+	static constexpr float RenderedTolerance = 0.5f;
+}
+
+void UCharacterSignificanceSubsystem::Deinitialize()
+{
+	Characters.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCharacterSignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < HopeSignificance::UpdateInterval)
+	{
+		return;
+	}
+	TimeSinceUpdate = 0.f;
+
+	UpdateSignificance();
+}
+
+TStatId UCharacterSignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UCharacterSignificanceSubsystem::RegisterCharacter(ACharacterBase* Character)
+{
+	if (!Character)
+	{
+		return;
+	}
+
+	Characters.AddUnique(Character);
+
+	// Scored with the others on the next update, full fidelity until then.
+	ApplyTier(Character, ESignificanceTier::EST_Critical);
+}
+
+void UCharacterSignificanceSubsystem::UnregisterCharacter(ACharacterBase* Character)
+{
+	Characters.RemoveSingleSwap(Character, EAllowShrinking::No);
+}
+
+void UCharacterSignificanceSubsystem::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_HopeSignificanceUpdate);
+
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	int32 TierCounts[4] = { 0, 0, 0, 0 };
+	for (int32 Index = Characters.Num() - 1; Index >= 0; --Index)
+	{
+		ACharacterBase* Character = Characters[Index].Get();
+		if (!Character)
+		{
+			Characters.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+			continue;
+		}
+
+		const ESignificanceTier Tier = CalculateTier(Character, ViewLocations);
+		ApplyTier(Character, Tier);
+		++TierCounts[static_cast<int32>(Tier)];
+	}
+
+	SET_DWORD_STAT(STAT_HopeSignificanceCritical, TierCounts[0]);
+	SET_DWORD_STAT(STAT_HopeSignificanceHigh, TierCounts[1]);
+	SET_DWORD_STAT(STAT_HopeSignificanceMedium, TierCounts[2]);
+	SET_DWORD_STAT(STAT_HopeSignificanceLow, TierCounts[3]);
+}
+
+ESignificanceTier UCharacterSignificanceSubsystem::CalculateTier(const ACharacterBase* Character, TConstArrayView<FVector> InViewLocations) const
+{
+	if (InViewLocations.Num() == 0 || Character->IsLocallyControlled())
+	{
+		return ESignificanceTier::EST_Critical;
+	}
+
+	// Hidden characters are only animated for their gameplay, which needs no fidelity.
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (!Mesh || !Mesh->WasRecentlyRendered(HopeSignificance::RenderedTolerance))
+	{
+		return ESignificanceTier::EST_Low;
+	}
+
+	const FVector Location = Character->GetActorLocation();
+	double DistanceSquared = TNumericLimits<double>::Max();
+	for (const FVector& ViewLocation : InViewLocations)
+	{
+		DistanceSquared = FMath::Min(DistanceSquared, FVector::DistSquared(Location, ViewLocation));
+	}
+
+	ESignificanceTier Tier = ESignificanceTier::EST_Low;
+	if (DistanceSquared < FMath::Square(HopeSignificance::HighDistance))
+	{
+		Tier = ESignificanceTier::EST_High;
+	}
+	else if (DistanceSquared < FMath::Square(HopeSignificance::MediumDistance))
+	{
+		Tier = ESignificanceTier::EST_Medium;
+	}
+
+	// Aiming characters are a threat to the viewer, their upper body has to read well further out.
+	if (Character->bIsAiming && Tier > ESignificanceTier::EST_High)
+	{
+		Tier = static_cast<ESignificanceTier>(static_cast<uint8>(Tier) - 1);
+	}
+	return Tier;
+}
+
+void UCharacterSignificanceSubsystem::ApplyTier(ACharacterBase* Character, ESignificanceTier Tier)
+{
+	Character->SetSignificanceTier(Tier);
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	if (!Mesh)
+	{
+		return;
+	}
+
+	int32 TickRate = 1;
+	if (Tier == ESignificanceTier::EST_Medium)
+	{
+		TickRate = HopeSignificance::MediumTickRate;
+	}
+	else if (Tier == ESignificanceTier::EST_Low)
+	{
+		TickRate = HopeSignificance::LowTickRate;
+	}
+	TickRate = FMath::Clamp(TickRate, 1, 255);
+
+	// On a listen server host the mesh of every character is the authoritative one. Its montage notifies and root motion drive
+	// gameplay for all players, so only the cosmetic work scales with the tier, the pose keeps updating every frame.
+	if (Character->HasAuthority() && Character->GetNetMode() == NM_ListenServer)
+	{
+		TickRate = 1;
+	}
+
+	Mesh->EnableExternalTickRateControl(true);
+	Mesh->SetExternalTickRate(static_cast<uint8>(TickRate));
+	Mesh->EnableExternalInterpolation(TickRate > 1 && Mesh->WasRecentlyRendered(HopeSignificance::RenderedTolerance));
+}
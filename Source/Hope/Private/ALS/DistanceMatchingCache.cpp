@@ -0,0 +1,225 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/DistanceMatchingCache.h"
+#include "AnimDistanceMatchingLibrary.h"
+#include "AnimNodes/AnimNode_SequenceEvaluator.h"
+#include "Animation/AnimExecutionContext.h"
+#include "Animation/AnimSequenceBase.h"
+#include "AnimationRuntime.h"
+#include "SequenceEvaluatorLibrary.h"
+#include "UObject/ObjectKey.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeDistanceMatching"), STATGROUP_HopeDistanceMatching, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Distance Matching Table Reads"), STAT_HopeDistanceMatchingTableReads, STATGROUP_HopeDistanceMatching);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Distance Matching Curve Searches"), STAT_HopeDistanceMatchingCurveSearches, STATGROUP_HopeDistanceMatching);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Distance Matching Tables"), STAT_HopeDistanceMatchingTables, STATGROUP_HopeDistanceMatching);
+
+namespace HopeDistanceMatching
+{
+	static bool bCacheDistanceMatching = true;
+	FAutoConsoleVariableRef CVar_CacheDistanceMatching(TEXT("Hope.Anim.CacheDistanceMatching"), bCacheDistanceMatching,
+		TEXT("Distance matches through the shared inverted curve tables. When off every match searches the curve, for comparing 'stat HopeDistanceMatching'."), ECVF_Default);
+
+	FAutoConsoleCommand Command_ResetDistanceMatching(TEXT("Hope.Anim.ResetDistanceMatching"),
+		TEXT("Drops every inverted distance curve, they are rebuilt on their next use."),
+		FConsoleCommandDelegate::CreateStatic(&FDistanceMatchingCache::Reset));
+
+	// Distance curves are sampled this many times per second of animation.
+	static constexpr float SampleRate = 60.f;
+
+	// Allowed decrease between two samples of a curve still considered increasing.
+	static constexpr float DecreaseTolerance = 0.01f;
+
+	using FTablePtr = TSharedPtr<const FDistanceMatchingTable, ESPMode::ThreadSafe>;
+
+	static FRWLock TablesLock;
+	static TMap<TPair<FObjectKey, FName>, FTablePtr> Tables;
+
+	static FTablePtr BuildTable(const UAnimSequenceBase& Sequence, FName DistanceCurveName)
+	{
+		const float PlayLength = Sequence.GetPlayLength();
+		if (PlayLength <= 0.f || !Sequence.HasCurveData(DistanceCurveName))
+		{
+			return nullptr;
+		}
+
+		TSharedRef<FDistanceMatchingTable, ESPMode::ThreadSafe> Table = MakeShared<FDistanceMatchingTable, ESPMode::ThreadSafe>();
+		const int32 NumSamples = FMath::Max(FMath::CeilToInt32(PlayLength * SampleRate), 1) + 1;
+		Table->PlayLength = PlayLength;
+		Table->TimeStep = PlayLength / (NumSamples - 1);
+		Table->Distances.SetNumUninitialized(NumSamples);
+
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			float Distance = Sequence.EvaluateCurveData(DistanceCurveName, FAnimExtractContext(static_cast<double>(Sample * Table->TimeStep)));
+			if (Sample > 0)
+			{
+				const float PreviousDistance = Table->Distances[Sample - 1];
+				if (Distance < PreviousDistance - DecreaseTolerance)
+				{
+					return nullptr;
+				}
+				Distance = FMath::Max(Distance, PreviousDistance);
+			}
+			Table->Distances[Sample] = Distance;
+		}
+
+		Table->MinDistance = Table->Distances[0];
+		Table->MaxDistance = Table->Distances.Last();
+		if (FMath::IsNearlyZero(Table->MaxDistance - Table->MinDistance))
+		{
+			return nullptr;
+		}
+
+		// Twice as many distance samples as time samples, so steep parts of the curve keep their resolution.
+		const int32 NumDistanceSamples = NumSamples * 2;
+		Table->DistanceStep = (Table->MaxDistance - Table->MinDistance) / (NumDistanceSamples - 1);
+		Table->Times.SetNumUninitialized(NumDistanceSamples);
+
+		// Earliest time each distance is reached at, walking both curves forward together.
+		int32 Sample = 0;
+		for (int32 DistanceSample = 0; DistanceSample < NumDistanceSamples; ++DistanceSample)
+		{
+			const float Distance = DistanceSample == NumDistanceSamples - 1 ? Table->MaxDistance : Table->MinDistance + DistanceSample * Table->DistanceStep;
+			while (Sample < NumSamples - 2 && Table->Distances[Sample + 1] < Distance)
+			{
+				++Sample;
+			}
+
+			const float SampleDistance = Table->Distances[Sample];
+			const float NextSampleDistance = Table->Distances[Sample + 1];
+			const float Alpha = NextSampleDistance > SampleDistance ? FMath::Clamp((Distance - SampleDistance) / (NextSampleDistance - SampleDistance), 0.f, 1.f) : 0.f;
+			Table->Times[DistanceSample] = (Sample + Alpha) * Table->TimeStep;
+		}
+
+		return Table;
+	}
+}
+
+float FDistanceMatchingTable::GetDistance(float Time) const
+{
+	const float Position = FMath::Clamp(Time / TimeStep, 0.f, static_cast<float>(Distances.Num() - 1));
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Position), Distances.Num() - 2);
+	return FMath::Lerp(Distances[Index], Distances[Index + 1], Position - Index);
+}
+
+float FDistanceMatchingTable::GetTime(float Distance) const
+{
+	const float Position = FMath::Clamp((Distance - MinDistance) / DistanceStep, 0.f, static_cast<float>(Times.Num() - 1));
+	const int32 Index = FMath::Min(FMath::FloorToInt32(Position), Times.Num() - 2);
+	return FMath::Lerp(Times[Index], Times[Index + 1], Position - Index);
+}
+
+TSharedPtr<const FDistanceMatchingTable, ESPMode::ThreadSafe> FDistanceMatchingCache::FindOrBuildTable(const UAnimSequenceBase* Sequence, FName DistanceCurveName)
+{
+	using namespace HopeDistanceMatching;
+
+	if (!Sequence || !bCacheDistanceMatching)
+	{
+		return nullptr;
+	}
+
+	const TPair<FObjectKey, FName> Key(FObjectKey(Sequence), DistanceCurveName);
+	{
+		FReadScopeLock ReadLock(TablesLock);
+		if (const FTablePtr* Table = Tables.Find(Key))
+		{
+			return *Table;
+		}
+	}
+
+	// Built outside the lock, another thread building the same table at the same time only wastes its work.
+	FTablePtr NewTable = BuildTable(*Sequence, DistanceCurveName);
+
+	FWriteScopeLock WriteLock(TablesLock);
+	if (const FTablePtr* Table = Tables.Find(Key))
+	{
+		return *Table;
+	}
+	Tables.Add(Key, NewTable);
+	INC_DWORD_STAT(STAT_HopeDistanceMatchingTables);
+	return NewTable;
+}
+
+void FDistanceMatchingCache::Reset()
+{
+	using namespace HopeDistanceMatching;
+
+	FWriteScopeLock WriteLock(TablesLock);
+	Tables.Reset();
+	SET_DWORD_STAT(STAT_HopeDistanceMatchingTables, 0);
+}
+
+void FDistanceMatchingCache::DistanceMatchToTarget(const FSequenceEvaluatorReference& SequenceEvaluator, float DistanceToTarget, FName DistanceCurveName)
+{
+	const HopeDistanceMatching::FTablePtr Table = FindOrBuildTable(USequenceEvaluatorLibrary::GetSequence(SequenceEvaluator), DistanceCurveName);
+	if (!Table)
+	{
+		INC_DWORD_STAT(STAT_HopeDistanceMatchingCurveSearches);
+		UAnimDistanceMatchingLibrary::DistanceMatchToTarget(SequenceEvaluator, DistanceToTarget, DistanceCurveName);
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_HopeDistanceMatchingTableReads);
+
+	// By convention, distance curves store the distance to a target as a negative value.
+	USequenceEvaluatorLibrary::SetExplicitTime(SequenceEvaluator, Table->GetTime(-DistanceToTarget));
+}
+
+void FDistanceMatchingCache::AdvanceTimeByDistanceMatching(const FAnimUpdateContext& UpdateContext, const FSequenceEvaluatorReference& SequenceEvaluator,
+	float DistanceTraveled, FName DistanceCurveName, FVector2D PlayRateClamp)
+{
+	const HopeDistanceMatching::FTablePtr Table = FindOrBuildTable(USequenceEvaluatorLibrary::GetSequence(SequenceEvaluator), DistanceCurveName);
+	if (!Table)
+	{
+		INC_DWORD_STAT(STAT_HopeDistanceMatchingCurveSearches);
+		UAnimDistanceMatchingLibrary::AdvanceTimeByDistanceMatching(UpdateContext, SequenceEvaluator, DistanceTraveled, DistanceCurveName, PlayRateClamp);
+		return;
+	}
+
+	const FAnimationUpdateContext* AnimationUpdateContext = UpdateContext.GetContext();
+	if (!AnimationUpdateContext)
+	{
+		return;
+	}
+
+	const float DeltaTime = AnimationUpdateContext->GetDeltaTime();
+	if (DeltaTime <= 0.f || DistanceTraveled <= 0.f)
+	{
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_HopeDistanceMatchingTableReads);
+
+	SequenceEvaluator.CallAnimNodeFunction<FAnimNode_SequenceEvaluator>(TEXT("AdvanceTimeByDistanceMatching"),
+		[&Table, DeltaTime, DistanceTraveled, PlayRateClamp](FAnimNode_SequenceEvaluator& InSequenceEvaluator)
+		{
+			const float CurrentTime = InSequenceEvaluator.GetExplicitTime();
+			const float CurrentAssetLength = InSequenceEvaluator.GetCurrentAssetLength();
+			const bool bAllowLooping = InSequenceEvaluator.GetShouldLoop();
+
+			// Time the distance is reached at, unwrapped past the end of the sequence when it loops.
+			const float TargetDistance = Table->GetDistance(CurrentTime) + DistanceTraveled;
+			float TimeAfterDistanceTraveled = 0.f;
+			if (bAllowLooping && TargetDistance > Table->MaxDistance)
+			{
+				const float DistanceRange = Table->MaxDistance - Table->MinDistance;
+				TimeAfterDistanceTraveled = CurrentAssetLength + Table->GetTime(Table->MinDistance + FMath::Fmod(TargetDistance - Table->MaxDistance, DistanceRange));
+			}
+			else
+			{
+				TimeAfterDistanceTraveled = FMath::Max(Table->GetTime(TargetDistance), CurrentTime);
+			}
+
+			float EffectivePlayRate = (TimeAfterDistanceTraveled - CurrentTime) / DeltaTime;
+			if (PlayRateClamp.X >= 0.f && PlayRateClamp.X < PlayRateClamp.Y)
+			{
+				EffectivePlayRate = FMath::Clamp(EffectivePlayRate, PlayRateClamp.X, PlayRateClamp.Y);
+			}
+
+			float NewTime = CurrentTime;
+			FAnimationRuntime::AdvanceTime(bAllowLooping, EffectivePlayRate * DeltaTime, NewTime, CurrentAssetLength);
+			InSequenceEvaluator.SetExplicitTime(NewTime);
+		});
+}
@@ -7,12 +7,21 @@
 #include "AbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
 #include "HopeGameplayTags.h"
+#include "Debug/HopeDebugDraw.h"
 
 namespace HopeCharacter
 {
 	static float GroundTraceDistance = 100000.0f;
 	FAutoConsoleVariableRef CVar_GroundTraceDistance(TEXT("HopeCharacter.GroundTraceDistance"), GroundTraceDistance,
 		TEXT("Distance to trace down when generating ground information."), ECVF_Cheat);
+
+	static bool bAsyncGroundTrace = true;
+	FAutoConsoleVariableRef CVar_AsyncGroundTrace(TEXT("HopeCharacter.AsyncGroundTrace"), bAsyncGroundTrace,
+		TEXT("Traces the ground under characters that aren't walking asynchronously, reading the result a frame later."), ECVF_Default);
+
+	static float GroundExtrapolationTime = 0.25f;
+	FAutoConsoleVariableRef CVar_GroundExtrapolationTime(TEXT("HopeCharacter.GroundExtrapolationTime"), GroundExtrapolationTime,
+		TEXT("How long the last ground distance is extrapolated from the vertical velocity before the ground is traced again."), ECVF_Default);
 }
 
 UHopeCharacterMovementComponent::UHopeCharacterMovementComponent(const FObjectInitializer& ObjectInitializer)
@@ -48,10 +57,17 @@ const FHopeCharacterGroundInfo& UHopeCharacterMovementComponent::GetGroundInfo()
 		return CachedGroundInfo;
 	}
 
+	// Characters whose animation skips frames won't be back in time to read an async trace.
+	const bool bUpdatesEveryFrame = CachedGroundInfo.LastUpdateFrame + 1 == GFrameCounter;
+
 	if (MovementMode == MOVE_Walking)
 	{
 		CachedGroundInfo.GroundHitResult = CurrentFloor.HitResult;
 		CachedGroundInfo.GroundDistance = 0.0f;
+
+		GroundTraceHandle = FTraceHandle();
+		GroundTraceFrame = 0;
+		GroundResultTime = -1.0;
 	}
 	else
 	{
@@ -67,18 +83,68 @@ const FHopeCharacterGroundInfo& UHopeCharacterMovementComponent::GetGroundInfo()
 		FCollisionResponseParams ResponseParam;
 		InitCollisionParams(QueryParams, ResponseParam);
 
-		FHitResult HitResult;
-		GetWorld()->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, CollisionChannel, QueryParams);
-		CachedGroundInfo.GroundHitResult = HitResult;
-		CachedGroundInfo.GroundDistance = HopeCharacter::GroundTraceDistance;
+		UWorld* World = GetWorld();
+		const double Now = World->GetTimeSeconds();
+		bool bHasResult = false;
+		double ResultTime = Now;
+		FVector ResultStart = TraceStart;
+		if (HopeCharacter::bAsyncGroundTrace)
+		{
+			// The engine runs the async traces of every character together once the frame ends. Only a trace issued
+			// last frame can be read back, one from further back is gone.
+			FTraceDatum TraceDatum;
+			if (GroundTraceFrame + 1 == GFrameCounter && World->QueryTraceData(GroundTraceHandle, TraceDatum))
+			{
+				CachedGroundInfo.GroundHitResult = TraceDatum.OutHits.Num() > 0 ? TraceDatum.OutHits[0] : FHitResult(TraceDatum.Start, TraceDatum.End);
+				HOPE_DEBUG_LINE(GroundInfo, this, TraceDatum.Start, TraceDatum.End, &CachedGroundInfo.GroundHitResult);
+				bHasResult = true;
+				ResultTime = Now - World->GetDeltaSeconds();
+				ResultStart = TraceDatum.Start;
+			}
+
+			GroundTraceHandle = FTraceHandle();
+			GroundTraceFrame = 0;
+			if (bUpdatesEveryFrame)
+			{
+				GroundTraceHandle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, CollisionChannel, QueryParams);
+				GroundTraceFrame = GFrameCounter;
+			}
+		}
+
+		// Between results the last distance is carried forward with the vertical velocity. The ground is only traced right
+		// away on the first update off the ground, or once the last result is too old to trust, e.g. after walking off a ledge.
+		const bool bCanExtrapolate = HopeCharacter::bAsyncGroundTrace && GroundResultTime >= 0.0
+			&& Now - GroundResultTime <= HopeCharacter::GroundExtrapolationTime;
+		if (!bHasResult && !bCanExtrapolate)
+		{
+			FHitResult HitResult;
+			World->LineTraceSingleByChannel(HitResult, TraceStart, TraceEnd, CollisionChannel, QueryParams);
+			HOPE_DEBUG_LINE(GroundInfo, this, TraceStart, TraceEnd, &HitResult);
+			CachedGroundInfo.GroundHitResult = HitResult;
+			bHasResult = true;
+		}
+
+		if (bHasResult)
+		{
+			const FHitResult& HitResult = CachedGroundInfo.GroundHitResult;
+			GroundResultDistance = HitResult.bBlockingHit
+				? FMath::Max(static_cast<float>(ResultStart.Z - HitResult.Location.Z) - CapsuleHalfHeight, 0.0f)
+				: HopeCharacter::GroundTraceDistance;
+			GroundResultTime = ResultTime;
+		}
 
 		if (MovementMode == MOVE_NavWalking)
 		{
 			CachedGroundInfo.GroundDistance = 0.0f;
 		}
-		else if (HitResult.bBlockingHit)
+		else if (CachedGroundInfo.GroundHitResult.bBlockingHit)
+		{
+			const float ElapsedTime = static_cast<float>(Now - GroundResultTime);
+			CachedGroundInfo.GroundDistance = FMath::Max(GroundResultDistance + static_cast<float>(Velocity.Z) * ElapsedTime, 0.0f);
+		}
+		else
 		{
-			CachedGroundInfo.GroundDistance = FMath::Max((HitResult.Distance - CapsuleHalfHeight), 0.0f);
+			CachedGroundInfo.GroundDistance = HopeCharacter::GroundTraceDistance;
 		}
 	}
 
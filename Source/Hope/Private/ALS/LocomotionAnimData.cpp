@@ -0,0 +1,59 @@
+// Copyright Sertim all rights reserved
+
+
+#include "ALS/LocomotionAnimData.h"
+
+void ULocomotionAnimData::PostLoad()
+{
+	Super::PostLoad();
+
+	BuildTables();
+}
+
+#if WITH_EDITOR
+void ULocomotionAnimData::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BuildTables();
+}
+#endif // WITH_EDITOR
+
+void ULocomotionAnimData::BuildTables()
+{
+	static_assert(static_cast<int32>(EGait::EG_Sprinting) + 1 == NumLocomotionGaits, "Locomotion anim table doesn't cover every gait.");
+	static_assert(static_cast<int32>(ELocomotionDirections::ELD_Right) + 1 == NumLocomotionDirections, "Locomotion anim table doesn't cover every direction.");
+
+	// Rows follow "ELocomotionAnimSet", columns "EGait".
+	const FDirectionalAnimations* AnimationSets[static_cast<int32>(ELocomotionAnimSet::ELAS_MAX)][NumLocomotionGaits] =
+	{
+		{ &WalkStartAnimations, &JogStartAnimations, &CrouchStartAnimations, &SprintStartAnimations },
+		{ &WalkCycleAnimations, &JogCycleAnimations, &CrouchCycleAnimations, &SprintCycleAnimations },
+		{ &WalkStopAnimations, &JogStopAnimations, &CrouchStopAnimations, &SprintStopAnimations },
+		{ &WalkPivotAnimations, &JogPivotAnimations, &CrouchPivotAnimations, &SprintPivotAnimations }
+	};
+
+	int32 Index = 0;
+	for (int32 Set = 0; Set < static_cast<int32>(ELocomotionAnimSet::ELAS_MAX); ++Set)
+	{
+		const FDirectionalAnimations& JogAnimations = *AnimationSets[Set][static_cast<int32>(EGait::EG_Jogging)];
+		for (int32 Gait = 0; Gait < NumLocomotionGaits; ++Gait)
+		{
+			const FDirectionalAnimations& Animations = *AnimationSets[Set][Gait];
+			const bool bFallBackToJog = Gait == static_cast<int32>(EGait::EG_Sprinting);
+
+			// Same order as "ELocomotionDirections".
+			UAnimSequence* const Directional[NumLocomotionDirections] = { Animations.Backward, Animations.Forward, Animations.Left, Animations.Right };
+			UAnimSequence* const JogDirectional[NumLocomotionDirections] = { JogAnimations.Backward, JogAnimations.Forward, JogAnimations.Left, JogAnimations.Right };
+			for (int32 Direction = 0; Direction < NumLocomotionDirections; ++Direction)
+			{
+				LocomotionAnimTable[Index++] = Directional[Direction] || !bFallBackToJog ? Directional[Direction] : JogDirectional[Direction];
+			}
+		}
+	}
+
+	TurnInPlaceAnimTable[0][0] = TurnLeft90Anim;
+	TurnInPlaceAnimTable[0][1] = TurnRight90Anim;
+	TurnInPlaceAnimTable[1][0] = CrouchTurnLeft90Anim;
+	TurnInPlaceAnimTable[1][1] = CrouchTurnRight90Anim;
+}
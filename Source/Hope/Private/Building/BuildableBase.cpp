@@ -2,6 +2,11 @@
 
 
 #include "Building/BuildableBase.h"
+#include "Building/BuildingSubsystem.h"
+#include "Game/HopeWorldSaveSubsystem.h"
+#include "Net/UnrealNetwork.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/DamageEvents.h"
 
 ABuildableBase::ABuildableBase()
 {
@@ -11,11 +16,257 @@ ABuildableBase::ABuildableBase()
 	SetRootComponent(BaseMeshComponent);
 	bReplicates = true;
 	SetReplicateMovement(true);
+
+	// Reaches as far as the furthest distance tier, a class can still cull closer than its tier allows.
+	NetCullDistanceSquared = FMath::Square(UBuildingSubsystem::GetFarDistance());
 }
 
 void ABuildableBase::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	ApplyTier();
+	UpdateStilts();
+
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		if (HasAuthority())
+		{
+			BuildingSubsystem->RegisterBuildable(this);
+		}
+		BuildingSubsystem->AddToCompound(this);
+	}
+}
+
+void ABuildableBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->RemoveFromCompound(this);
+		if (HasAuthority())
+		{
+			BuildingSubsystem->UnregisterBuildable(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool ABuildableBase::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (const UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		if (!BuildingSubsystem->IsCellReleasedFor(RealViewer, StreamingCell))
+		{
+			return false;
+		}
+
+		// The distance tiers only narrow relevancy, the other rules of "AActor" still apply on top of them.
+		if (!bAlwaysRelevant && !IsOwnedBy(ViewTarget) && !IsOwnedBy(RealViewer)
+			&& UBuildingSubsystem::GetRelevancyTier(SrcLocation, GetActorLocation()) > UBuildingSubsystem::GetFurthestTier(BuildingType))
+		{
+			return false;
+		}
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+float ABuildableBase::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	const float ActualDamage = Super::TakeDamage(DamageAmount, DamageEvent, EventInstigator, DamageCauser);
+	if (!HasAuthority() || ActualDamage <= 0.f || IsActorBeingDestroyed())
+	{
+		return ActualDamage;
+	}
+
+	Damage = FMath::Min(Damage + ActualDamage, MaxHealth);
+
+	FVector ImpactLocation = GetActorLocation();
+	if (DamageEvent.IsOfType(FPointDamageEvent::ClassID))
+	{
+		ImpactLocation = static_cast<const FPointDamageEvent&>(DamageEvent).HitInfo.ImpactPoint;
+	}
+	else if (DamageEvent.IsOfType(FRadialDamageEvent::ClassID))
+	{
+		ImpactLocation = static_cast<const FRadialDamageEvent&>(DamageEvent).Origin;
+	}
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->AddPieceImpact(this, ActualDamage, ImpactLocation,
+			Damage >= MaxHealth ? EBuildingImpactFlags::Destroyed : EBuildingImpactFlags::None);
+	}
+
+	if (UHopeWorldSaveSubsystem* WorldSaveSubsystem = GetWorld()->GetSubsystem<UHopeWorldSaveSubsystem>())
+	{
+		WorldSaveSubsystem->RecordPieceMutation(this, EHopeJournalOp::Damage);
+	}
+
+	if (Damage >= MaxHealth)
+	{
+		Destroy();
+	}
+	return ActualDamage;
+}
+
+void ABuildableBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABuildableBase, bIsOpen);
+	DOREPLIFETIME(ABuildableBase, StiltHeight);
+	DOREPLIFETIME(ABuildableBase, Tier);
+}
+
+void ABuildableBase::SetIsOpen(bool bNewIsOpen)
+{
+	if (bIsOpen == bNewIsOpen)
+	{
+		return;
+	}
+
+	bIsOpen = bNewIsOpen;
+	OnOpenStateChanged();
+
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->AddPieceImpact(this, 0.f, GetActorLocation(), EBuildingImpactFlags::OpenStateChanged);
+
+		// An opened piece leaves the compound and gets its own body back, a closed one may fold again.
+		BuildingSubsystem->MarkCompoundDirty(this);
+	}
+
+	if (UHopeWorldSaveSubsystem* WorldSaveSubsystem = GetWorld()->GetSubsystem<UHopeWorldSaveSubsystem>())
+	{
+		WorldSaveSubsystem->RecordPieceMutation(this, EHopeJournalOp::DoorState);
+	}
 }
 
+bool ABuildableBase::CanUpgradeTo(EBuildingTier NewTier) const
+{
+	return NewTier > Tier && Tiers.Contains(NewTier);
+}
+
+void ABuildableBase::SetTier(EBuildingTier NewTier)
+{
+	if (Tier == NewTier)
+	{
+		return;
+	}
+
+	Tier = NewTier;
+	OnRep_Tier();
+
+	if (UHopeWorldSaveSubsystem* WorldSaveSubsystem = GetWorld()->GetSubsystem<UHopeWorldSaveSubsystem>())
+	{
+		WorldSaveSubsystem->RecordPieceMutation(this, EHopeJournalOp::Upgrade);
+	}
+}
+
+void ABuildableBase::ReceiveImpact(const FBuildingPieceImpact& Impact)
+{
+	if (!HasAuthority())
+	{
+		Damage = (1.f - Impact.GetHealthFraction()) * MaxHealth;
+	}
+
+	if (Impact.NumHits > 0)
+	{
+		OnImpacted(Impact.GetDamageTakenFraction(), Impact.NumHits, Impact.ImpactLocation);
+	}
+}
+
+void ABuildableBase::OnRep_IsOpen()
+{
+	OnOpenStateChanged();
+
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->MarkCompoundDirty(this);
+	}
+}
+
+void ABuildableBase::OnRep_StiltHeight()
+{
+	UpdateStilts();
+}
+
+void ABuildableBase::OnRep_Tier()
+{
+	// Clients only know the damage as a fraction anyway, so it is kept as one across the change of "MaxHealth".
+	const float DamageFraction = Damage / FMath::Max(MaxHealth, 1.f);
+	ApplyTier();
+	Damage = DamageFraction * MaxHealth;
+
+	UpdateStilts();
+	OnTierChanged();
+
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->MarkCompoundDirty(this);
+	}
+}
+
+void ABuildableBase::ApplyTier()
+{
+	const FBuildingTierData* TierData = Tiers.Find(Tier);
+	if (!TierData)
+	{
+		return;
+	}
+
+	MaxHealth = FMath::Max(TierData->MaxHealth, 1.f);
+	if (TierData->Mesh)
+	{
+		BaseMeshComponent->SetStaticMesh(TierData->Mesh);
+	}
+
+	// Nobody sees the materials on a dedicated server.
+	if (GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+	BaseMeshComponent->EmptyOverrideMaterials();
+	for (int32 Index = 0; Index < TierData->Materials.Num(); Index++)
+	{
+		BaseMeshComponent->SetMaterial(Index, TierData->Materials[Index]);
+	}
+}
+
+void ABuildableBase::UpdateStilts()
+{
+	const UStaticMesh* BaseMesh = BaseMeshComponent->GetStaticMesh();
+	if (StiltHeight <= 0.f || !StiltMesh || !BaseMesh || GetNetMode() == NM_DedicatedServer)
+	{
+		if (StiltComponent)
+		{
+			StiltComponent->ClearInstances();
+		}
+		return;
+	}
+
+	if (!StiltComponent)
+	{
+		StiltComponent = NewObject<UInstancedStaticMeshComponent>(this, TEXT("StiltComponent"));
+		StiltComponent->SetStaticMesh(StiltMesh);
+		StiltComponent->SetupAttachment(BaseMeshComponent);
+		StiltComponent->RegisterComponent();
+	}
+	StiltComponent->ClearInstances();
+
+	const FBox StiltBox = StiltMesh->GetBoundingBox();
+	const FBox BaseBox = BaseMesh->GetBoundingBox();
+	const FVector2D Inset(StiltBox.GetExtent());
+	const float StiltScaleZ = StiltHeight / FMath::Max(StiltBox.GetSize().Z, 1.f);
+	const FVector2D Corners[] =
+	{
+		FVector2D(BaseBox.Min.X + Inset.X, BaseBox.Min.Y + Inset.Y),
+		FVector2D(BaseBox.Max.X - Inset.X, BaseBox.Min.Y + Inset.Y),
+		FVector2D(BaseBox.Min.X + Inset.X, BaseBox.Max.Y - Inset.Y),
+		FVector2D(BaseBox.Max.X - Inset.X, BaseBox.Max.Y - Inset.Y)
+	};
+	for (const FVector2D& Corner : Corners)
+	{
+		StiltComponent->AddInstance(FTransform(FQuat::Identity, FVector(Corner, -StiltHeight), FVector(1.f, 1.f, StiltScaleZ)));
+	}
+}
@@ -0,0 +1,452 @@
+// Copyright Sertim all rights reserved
+
+/**
+ * Headless stress benchmark of the building system. Spawns bases of placed pieces, drives the ghost of the local
+ * player's "UBuildingComponent" along scripted camera paths and writes stage latency percentiles and spawn throughput
+ * to Saved/Benchmarks as JSON. Runs without a GPU:
+ *
+ *	<Editor>-Cmd <Project> <Map> -game -nullrhi -ExecCmds="Hope.Building.Benchmark Pieces=100000 Quit"
+ *
+ * Arguments: Pieces=<N> Updates=<N> BaseSize=<Foundations per side> UpdatesPerFrame=<N> Seed=<N> Quit
+ */
+
+#include "Building/BuildingComponent.h"
+#include "Building/BuildableBase.h"
+#include "Game/HopeWorldSaveSubsystem.h"
+#include "HopeInterfaces/PlayerInterface.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "Hope.h"
+
+#if !UE_BUILD_SHIPPING
+
+class FBuildingBenchmark
+{
+public:
+
+	struct FSettings
+	{
+		int32 NumPieces = 10000;
+		int32 NumUpdates = 2000;
+		int32 BaseSize = 4;
+		int32 UpdatesPerFrame = 2;
+		int32 Seed = 1;
+		bool bQuit = false;
+	};
+
+	static void Start(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	// Latency samples of one stage, in microseconds.
+	struct FStageSamples
+	{
+		TArray<double> Samples;
+
+		void Add(double Seconds) { Samples.Add(Seconds * 1000000.0); }
+		TSharedRef<FJsonObject> ToJson();
+	};
+
+	FBuildingBenchmark(UWorld* InWorld, UBuildingComponent* InBuildingComponent, const FSettings& InSettings);
+
+	bool Tick(float DeltaTime);
+
+	// Spawns "NumPieces" pieces as square bases with walls, pillars and a roof, laid out on a grid.
+	void SpawnLayout();
+	void SpawnPiece(const FBuildables* Buildable, const FTransform& Transform);
+	const FBuildables* FindBuildable(EBuildingType BuildingType) const;
+
+	// Moves the camera along the current path and runs one ghost update.
+	void RunGhostUpdate();
+
+	void Finish();
+
+	// Destroys the spawned pieces and lets the world save record changes again.
+	void RemoveSpawnedPieces();
+	void WriteResults();
+
+	static TUniquePtr<FBuildingBenchmark> Instance;
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<UBuildingComponent> BuildingComponent;
+	FSettings Settings;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	TArray<TWeakObjectPtr<ABuildableBase>> SpawnedPieces;
+	TArray<FVector> BaseCenters;
+	FVector Origin = FVector::ZeroVector;
+	float BaseExtent = 0.f;
+
+	FTransform CameraRelativeTransform;
+	bool bStartedBuildMode = false;
+	bool bHasSpawned = false;
+	int32 NumUpdatesRun = 0;
+
+	double SpawnSeconds = 0.0;
+	FStageSamples TraceSamples;
+	FStageSamples SnapSamples;
+	FStageSamples OverlapSamples;
+	FStageSamples SupportSamples;
+	FStageSamples UpdateSamples;
+};
+
+TUniquePtr<FBuildingBenchmark> FBuildingBenchmark::Instance;
+
+static FAutoConsoleCommandWithWorldAndArgs BuildingBenchmarkCommand(TEXT("Hope.Building.Benchmark"),
+	TEXT("Spawns placed pieces, drives the local player's build ghost along scripted camera paths and writes the timings to Saved/Benchmarks. ")
+	TEXT("Pieces=<N> Updates=<N> BaseSize=<N> UpdatesPerFrame=<N> Seed=<N> Quit"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FBuildingBenchmark::Start));
+
+void FBuildingBenchmark::Start(const TArray<FString>& Args, UWorld* World)
+{
+	if (Instance && Instance->TickerHandle.IsValid())
+	{
+		UE_LOG(LogHopeBuilding, Warning, TEXT("Building benchmark is already running"));
+		return;
+	}
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+	FSettings Settings;
+	FParse::Value(*Command, TEXT("Pieces="), Settings.NumPieces);
+	FParse::Value(*Command, TEXT("Updates="), Settings.NumUpdates);
+	FParse::Value(*Command, TEXT("BaseSize="), Settings.BaseSize);
+	FParse::Value(*Command, TEXT("UpdatesPerFrame="), Settings.UpdatesPerFrame);
+	FParse::Value(*Command, TEXT("Seed="), Settings.Seed);
+	Settings.bQuit = FParse::Param(*Command, TEXT("Quit")) || Args.Contains(TEXT("Quit"));
+	Settings.BaseSize = FMath::Max(Settings.BaseSize, 1);
+	Settings.UpdatesPerFrame = FMath::Max(Settings.UpdatesPerFrame, 1);
+
+	APawn* Pawn = World ? UGameplayStatics::GetPlayerPawn(World, 0) : nullptr;
+	UBuildingComponent* BuildingComponent = Pawn && Pawn->Implements<UPlayerInterface>() ? IPlayerInterface::Execute_GetPlayerBuildingComponent(Pawn) : nullptr;
+	if (!BuildingComponent || !BuildingComponent->Camera || BuildingComponent->Buildables.Num() == 0)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Building benchmark needs a local player pawn with a building component and buildables"));
+		return;
+	}
+
+	Instance.Reset(new FBuildingBenchmark(World, BuildingComponent, Settings));
+}
+
+FBuildingBenchmark::FBuildingBenchmark(UWorld* InWorld, UBuildingComponent* InBuildingComponent, const FSettings& InSettings)
+	: World(InWorld)
+	, BuildingComponent(InBuildingComponent)
+	, Settings(InSettings)
+{
+	// Spawning starts on the next frame so the console command returns first.
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FBuildingBenchmark::Tick));
+}
+
+bool FBuildingBenchmark::Tick(float DeltaTime)
+{
+	UBuildingComponent* Component = BuildingComponent.Get();
+	if (!World.IsValid() || !Component)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Building benchmark aborted, its world or building component went away"));
+		RemoveSpawnedPieces();
+		TickerHandle.Reset();
+		return false;
+	}
+
+	if (!bHasSpawned)
+	{
+		// Synthetic pieces must not reach the save, and saving them would count towards the placement timings.
+		if (UHopeWorldSaveSubsystem* WorldSaveSubsystem = World->GetSubsystem<UHopeWorldSaveSubsystem>())
+		{
+			WorldSaveSubsystem->SetSuspended(true);
+		}
+		SpawnLayout();
+		bHasSpawned = true;
+
+		CameraRelativeTransform = Component->Camera->GetRelativeTransform();
+		if (!Component->bIsBuildModeOn)
+		{
+			Component->StartBuildMode();
+			bStartedBuildMode = true;
+		}
+		// The benchmark runs the updates itself.
+		World->GetTimerManager().ClearTimer(Component->BuildTimerHandle);
+		return true;
+	}
+
+	// Several updates per frame, like the build timer does at high frame times, so async results arrive late as they would in game.
+	for (int32 Index = 0; Index < Settings.UpdatesPerFrame && NumUpdatesRun < Settings.NumUpdates; Index++)
+	{
+		RunGhostUpdate();
+	}
+
+	if (NumUpdatesRun >= Settings.NumUpdates)
+	{
+		Finish();
+		TickerHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+const FBuildables* FBuildingBenchmark::FindBuildable(EBuildingType BuildingType) const
+{
+	for (const FBuildables* Buildable : BuildingComponent->Buildables)
+	{
+		if (Buildable && Buildable->BuildingType == BuildingType && Buildable->BuildingClass && Buildable->Mesh)
+		{
+			return Buildable;
+		}
+	}
+	return nullptr;
+}
+
+void FBuildingBenchmark::SpawnLayout()
+{
+	const FBuildables* Foundation = FindBuildable(EBuildingType::EBT_Foundation);
+	const FBuildables* Pillar = FindBuildable(EBuildingType::EBT_Pillar);
+	const FBuildables* Wall = FindBuildable(EBuildingType::EBT_Wall);
+	const FBuildables* Ceiling = FindBuildable(EBuildingType::EBT_Ceiling);
+	if (!Foundation)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Building benchmark needs a foundation in the buildables table"));
+		return;
+	}
+
+	const FVector FoundationSize = Foundation->Mesh->GetBoundingBox().GetSize();
+	const float CellSize = FMath::Max(FoundationSize.X, FoundationSize.Y);
+	const float WallHeight = Wall ? Wall->Mesh->GetBoundingBox().GetSize().Z : 300.f;
+	const int32 BaseSize = Settings.BaseSize;
+	const int32 PiecesPerBase = 2 * BaseSize * BaseSize + 8 * BaseSize;
+	const int32 NumBases = FMath::DivideAndRoundUp(Settings.NumPieces, PiecesPerBase);
+	const int32 BasesPerRow = FMath::CeilToInt(FMath::Sqrt(float(NumBases)));
+	const float BaseSpacing = (BaseSize + 3) * CellSize;
+	BaseExtent = BaseSize * CellSize * 0.5f;
+
+	// Bases start in front of the player, on the ground below it.
+	const APawn* Pawn = BuildingComponent->GetOwner<APawn>();
+	Origin = Pawn->GetActorLocation() + Pawn->GetActorForwardVector() * BaseSpacing;
+	FHitResult GroundHit;
+	if (World->LineTraceSingleByChannel(GroundHit, Origin + FVector(0.f, 0.f, 1000.f), Origin - FVector(0.f, 0.f, 10000.f), ECC_Visibility))
+	{
+		Origin.Z = GroundHit.ImpactPoint.Z;
+	}
+
+	SpawnedPieces.Reserve(Settings.NumPieces);
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 BaseIndex = 0; BaseIndex < NumBases && SpawnedPieces.Num() < Settings.NumPieces; BaseIndex++)
+	{
+		const FVector BaseCorner = Origin + FVector((BaseIndex % BasesPerRow) * BaseSpacing, (BaseIndex / BasesPerRow) * BaseSpacing, 0.f);
+		BaseCenters.Add(BaseCorner + FVector(BaseExtent, BaseExtent, 0.f));
+
+		auto CellCenter = [&BaseCorner, CellSize](float X, float Y, float Z)
+			{
+				return BaseCorner + FVector((X + 0.5f) * CellSize, (Y + 0.5f) * CellSize, Z);
+			};
+
+		for (int32 Y = 0; Y < BaseSize; Y++)
+		{
+			for (int32 X = 0; X < BaseSize; X++)
+			{
+				SpawnPiece(Foundation, FTransform(CellCenter(X, Y, 0.f)));
+				SpawnPiece(Ceiling, FTransform(CellCenter(X, Y, WallHeight)));
+			}
+		}
+
+		// Walls and pillars around the perimeter, walking each side once.
+		for (int32 Side = 0; Side < 4; Side++)
+		{
+			const FRotator Rotation(0.f, Side * 90.f, 0.f);
+			for (int32 Step = 0; Step < BaseSize; Step++)
+			{
+				const FVector2D Edge = Side == 0 ? FVector2D(Step, -0.5f) : Side == 1 ? FVector2D(BaseSize - 0.5f, Step)
+					: Side == 2 ? FVector2D(BaseSize - 1 - Step, BaseSize - 0.5f) : FVector2D(-0.5f, BaseSize - 1 - Step);
+				const FVector2D Corner = Side == 0 ? FVector2D(Step - 0.5f, -0.5f) : Side == 1 ? FVector2D(BaseSize - 0.5f, Step - 0.5f)
+					: Side == 2 ? FVector2D(BaseSize - 0.5f - Step, BaseSize - 0.5f) : FVector2D(-0.5f, BaseSize - 0.5f - Step);
+
+				SpawnPiece(Wall, FTransform(Rotation, CellCenter(Edge.X, Edge.Y, 0.f)));
+				SpawnPiece(Pillar, FTransform(Rotation, CellCenter(Corner.X, Corner.Y, 0.f)));
+			}
+		}
+	}
+	SpawnSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogHopeBuilding, Display, TEXT("Building benchmark spawned %d pieces in %d bases in %.3f s (%.0f pieces/s)"),
+		SpawnedPieces.Num(), BaseCenters.Num(), SpawnSeconds, SpawnedPieces.Num() / FMath::Max(SpawnSeconds, UE_DOUBLE_SMALL_NUMBER));
+}
+
+void FBuildingBenchmark::SpawnPiece(const FBuildables* Buildable, const FTransform& Transform)
+{
+	if (!Buildable || SpawnedPieces.Num() >= Settings.NumPieces)
+	{
+		return;
+	}
+
+	ABuildableBase* SpawnedBuilding = World->SpawnActorDeferred<ABuildableBase>(Buildable->BuildingClass, Transform);
+	if (SpawnedBuilding)
+	{
+		UGameplayStatics::FinishSpawningActor(SpawnedBuilding, Transform);
+		SpawnedPieces.Add(SpawnedBuilding);
+	}
+}
+
+void FBuildingBenchmark::RunGhostUpdate()
+{
+	UBuildingComponent* Component = BuildingComponent.Get();
+	if (BaseCenters.Num() == 0)
+	{
+		NumUpdatesRun = Settings.NumUpdates;
+		return;
+	}
+
+	// Each path covers 100 updates around one base: orbiting it while looking at its center, or walking across it.
+	constexpr int32 UpdatesPerPath = 100;
+	const int32 PathIndex = NumUpdatesRun / UpdatesPerPath;
+	const float PathAlpha = float(NumUpdatesRun % UpdatesPerPath) / UpdatesPerPath;
+	const FVector BaseCenter = BaseCenters[FRandomStream(Settings.Seed + PathIndex).RandHelper(BaseCenters.Num())];
+	const FVector EyeOffset(0.f, 0.f, 170.f);
+
+	FVector CameraLocation;
+	FVector LookAt;
+	if (PathIndex % 2 == 0)
+	{
+		const float Angle = PathAlpha * UE_TWO_PI;
+		const float Radius = BaseExtent * 1.5f;
+		CameraLocation = BaseCenter + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f) + EyeOffset;
+		LookAt = BaseCenter + FVector(0.f, 0.f, 50.f);
+	}
+	else
+	{
+		const FVector Start = BaseCenter + FVector(-BaseExtent, -BaseExtent * 0.5f, 0.f);
+		const FVector End = BaseCenter + FVector(BaseExtent, BaseExtent * 0.5f, 0.f);
+		CameraLocation = FMath::Lerp(Start, End, PathAlpha) + EyeOffset;
+		LookAt = CameraLocation + (End - Start).GetSafeNormal() * 400.f - EyeOffset;
+	}
+	Component->Camera->SetWorldLocationAndRotation(CameraLocation, (LookAt - CameraLocation).Rotation());
+
+	// Cycle through every buildable so snapping, pillars and foundations are all covered.
+	if (NumUpdatesRun % 50 == 0)
+	{
+		Component->BuildID = (NumUpdatesRun / 50) % Component->Buildables.Num();
+		Component->ChangeBuildGhostMesh();
+	}
+
+	FBuildingGhostTimings Timings;
+	Component->GhostTimings = &Timings;
+	const double StartTime = FPlatformTime::Seconds();
+	Component->SetBuildGhostComponentTransformAndColor();
+	UpdateSamples.Add(FPlatformTime::Seconds() - StartTime);
+	Component->GhostTimings = nullptr;
+
+	TraceSamples.Add(Timings.TraceSeconds);
+	SnapSamples.Add(Timings.SnapSeconds);
+	OverlapSamples.Add(Timings.OverlapSeconds);
+	SupportSamples.Add(Timings.SupportSeconds);
+	NumUpdatesRun++;
+}
+
+void FBuildingBenchmark::Finish()
+{
+	WriteResults();
+
+	UBuildingComponent* Component = BuildingComponent.Get();
+	Component->Camera->SetRelativeTransform(CameraRelativeTransform);
+	if (bStartedBuildMode)
+	{
+		Component->StopBuildMode();
+	}
+	else
+	{
+		Component->UpdateBuildGhostComponentTransformAndColor();
+	}
+
+	RemoveSpawnedPieces();
+
+	if (Settings.bQuit)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void FBuildingBenchmark::RemoveSpawnedPieces()
+{
+	for (const TWeakObjectPtr<ABuildableBase>& Piece : SpawnedPieces)
+	{
+		if (ABuildableBase* Buildable = Piece.Get())
+		{
+			Buildable->Destroy();
+		}
+	}
+	SpawnedPieces.Reset();
+
+	// Resumed only once the pieces are gone, so their removal isn't journaled either.
+	UHopeWorldSaveSubsystem* WorldSaveSubsystem = World.IsValid() ? World->GetSubsystem<UHopeWorldSaveSubsystem>() : nullptr;
+	if (WorldSaveSubsystem)
+	{
+		WorldSaveSubsystem->SetSuspended(false);
+	}
+}
+
+TSharedRef<FJsonObject> FBuildingBenchmark::FStageSamples::ToJson()
+{
+	Samples.Sort();
+	auto Percentile = [this](double P)
+		{
+			return Samples.Num() > 0 ? Samples[FMath::Clamp(FMath::CeilToInt(P * Samples.Num()) - 1, 0, Samples.Num() - 1)] : 0.0;
+		};
+
+	double Sum = 0.0;
+	for (const double Sample : Samples)
+	{
+		Sum += Sample;
+	}
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("mean_us"), Samples.Num() > 0 ? Sum / Samples.Num() : 0.0);
+	Json->SetNumberField(TEXT("p50_us"), Percentile(0.5));
+	Json->SetNumberField(TEXT("p90_us"), Percentile(0.9));
+	Json->SetNumberField(TEXT("p99_us"), Percentile(0.99));
+	Json->SetNumberField(TEXT("max_us"), Samples.Num() > 0 ? Samples.Last() : 0.0);
+	return Json;
+}
+
+void FBuildingBenchmark::WriteResults()
+{
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("benchmark"), TEXT("building"));
+	Json->SetStringField(TEXT("build_version"), FApp::GetBuildVersion());
+	Json->SetStringField(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	Json->SetNumberField(TEXT("pieces"), SpawnedPieces.Num());
+	Json->SetNumberField(TEXT("bases"), BaseCenters.Num());
+	Json->SetNumberField(TEXT("updates"), NumUpdatesRun);
+	Json->SetNumberField(TEXT("spawn_seconds"), SpawnSeconds);
+	Json->SetNumberField(TEXT("spawn_pieces_per_second"), SpawnedPieces.Num() / FMath::Max(SpawnSeconds, UE_DOUBLE_SMALL_NUMBER));
+
+	TSharedRef<FJsonObject> Stages = MakeShared<FJsonObject>();
+	Stages->SetObjectField(TEXT("trace"), TraceSamples.ToJson());
+	Stages->SetObjectField(TEXT("snap"), SnapSamples.ToJson());
+	Stages->SetObjectField(TEXT("overlap"), OverlapSamples.ToJson());
+	Stages->SetObjectField(TEXT("support"), SupportSamples.ToJson());
+	Stages->SetObjectField(TEXT("update"), UpdateSamples.ToJson());
+	Json->SetObjectField(TEXT("stages"), Stages);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	const FString FilePath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") /
+		FString::Printf(TEXT("Building-%d-%s.json"), SpawnedPieces.Num(), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	if (FFileHelper::SaveStringToFile(Output, *FilePath))
+	{
+		UE_LOG(LogHopeBuilding, Display, TEXT("Building benchmark results written to %s"), *FilePath);
+	}
+	else
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Failed to write building benchmark results to %s"), *FilePath);
+	}
+}
+
+#endif // !UE_BUILD_SHIPPING
@@ -11,6 +11,35 @@
 #include "HopeInterfaces/BuildInterface.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Building/BuildableBase.h"
+#include "Building/BuildingCompound.h"
+#include "Building/BuildingSubsystem.h"
+#include "Building/BuildingTrace.h"
+#include "Debug/HopeDebugDraw.h"
+#include "InputControl/HopeViewQuerySubsystem.h"
+
+namespace HopeBuilding
+{
+	// Adds the time spent in its scope to "Target", if there is one.
+	struct FGhostStageTimer
+	{
+		explicit FGhostStageTimer(double* InTarget)
+			: Target(InTarget)
+			, StartTime(InTarget ? FPlatformTime::Seconds() : 0.0)
+		{
+		}
+
+		~FGhostStageTimer()
+		{
+			if (Target)
+			{
+				*Target += FPlatformTime::Seconds() - StartTime;
+			}
+		}
+
+		double* Target;
+		double StartTime;
+	};
+}
 
 UBuildingComponent::UBuildingComponent()
 {
@@ -41,6 +70,8 @@ void UBuildingComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 
 void UBuildingComponent::SpawnBuildGhostComponent()
 {
+	HOPE_BUILDING_SCOPE(GhostMesh);
+
 	BuildGhostComponent = NewObject<UStaticMeshComponent>(GetOwner(), UStaticMeshComponent::StaticClass());
 	BuildGhostComponent->RegisterComponent();
 
@@ -53,7 +84,10 @@ void UBuildingComponent::SpawnBuildGhostComponent()
 
 void UBuildingComponent::GiveBuildColor(bool bIsBuildingAllowed)
 {
+	HOPE_BUILDING_SCOPE(GhostMaterial);
+
 	bCanBuild = bIsBuildingAllowed;
+	HOPE_BUILDING_COUNT(MaterialSwaps, BuildGhostComponent->GetNumMaterials());
 	for (int32 i = 0; i < BuildGhostComponent->GetNumMaterials(); i++)
 	{
 		if (bIsBuildingAllowed) BuildGhostComponent->SetMaterial(i, BuildingIsAllowedColor);
@@ -64,22 +98,41 @@ void UBuildingComponent::GiveBuildColor(bool bIsBuildingAllowed)
 
 void UBuildingComponent::SetBuildGhostComponentTransformAndColor()
 {
+	HOPE_BUILDING_SCOPE(GhostUpdate);
+
 	FVector Start = Camera->GetComponentLocation() + Camera->GetForwardVector() * 10.f;
 	FVector End = Camera->GetComponentLocation() + Camera->GetForwardVector() * LineTraceForBuilding;
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(GetOwner());
 	FHitResult HitResult;
 
-	bool bHit = UKismetSystemLibrary::LineTraceSingle(Camera,
-		Start,
-		End,
-		Buildables[BuildID]->TraceChannel,
-		false,
-		ActorsToIgnore,
-		EDrawDebugTrace::ForOneFrame,
-		HitResult,
-		true,
-		FLinearColor::Black);
+	bool bHit = false;
+	{
+		HopeBuilding::FGhostStageTimer StageTimer(GhostTimings ? &GhostTimings->TraceSeconds : nullptr);
+		HOPE_BUILDING_SCOPE(CameraTrace);
+		// The local player reads the shared view ray, the trace is only a fallback.
+		if (UHopeViewQuerySubsystem* ViewQuery = UHopeViewQuerySubsystem::Get(GetOwner()))
+		{
+			bHit = ViewQuery->GetViewHit(UEngineTypes::ConvertToCollisionChannel(Buildables[BuildID]->TraceChannel), 10.f, LineTraceForBuilding, HitResult);
+		}
+		else
+		{
+			TArray<AActor*> ActorsToIgnore;
+			ActorsToIgnore.Add(GetOwner());
+			HOPE_BUILDING_COUNT(Traces, 1);
+			bHit = UKismetSystemLibrary::LineTraceSingle(Camera,
+				Start,
+				End,
+				Buildables[BuildID]->TraceChannel,
+				false,
+				ActorsToIgnore,
+				EDrawDebugTrace::None,
+				HitResult,
+				true,
+				FLinearColor::Black);
+		}
+	}
+	// Settled pieces are hit through their cell's compound body.
+	UBuildingCompoundComponent::ResolveHit(HitResult);
+	HOPE_DEBUG_LINE(CameraTrace, this, Start, End, bHit ? &HitResult : nullptr);
 
 	if (bHit)
 	{
@@ -101,13 +154,20 @@ void UBuildingComponent::DefineConditionsForBuilding(FHitResult& HitResult, EBui
 
 	if (BuildGhostComponent)
 	{
-		bool bIsSnapBoxDetected = DetectBuildBoxes();
-		bool bIsGhostMeshColliding = IsBuildingColliding();
+		bool bIsSnapBoxDetected = false;
+		{
+			HopeBuilding::FGhostStageTimer StageTimer(GhostTimings ? &GhostTimings->SnapSeconds : nullptr);
+			bIsSnapBoxDetected = DetectBuildBoxes();
+		}
+		bool bIsGhostMeshColliding = false;
+		{
+			HopeBuilding::FGhostStageTimer StageTimer(GhostTimings ? &GhostTimings->OverlapSeconds : nullptr);
+			bIsGhostMeshColliding = IsBuildingColliding();
+		}
 		bool bShoudBeSupportedWithBuilding = false;
 		switch (InBuildingType)
 		{
 		case EBuildingType::EBT_Foundation:
-			BuildingSupportHeight = 150.f;
 			bShoudBeSupportedWithBuilding = false;
 			break;
 		case EBuildingType::EBT_Pillar:
@@ -136,7 +196,14 @@ void UBuildingComponent::DefineConditionsForBuilding(FHitResult& HitResult, EBui
 			bShoudBeSupportedWithBuilding = true;
 			break;
 		}
-		bool bIsGhostMeshSupported = IsBuildingSupported(bShoudBeSupportedWithBuilding);
+		// Foundations sample the ground under their whole footprint instead of tracing below their origin.
+		BuildStiltHeight = 0.f;
+		bool bIsGhostMeshSupported = false;
+		{
+			HopeBuilding::FGhostStageTimer StageTimer(GhostTimings ? &GhostTimings->SupportSeconds : nullptr);
+			bIsGhostMeshSupported = InBuildingType == EBuildingType::EBT_Foundation ? IsFoundationSupported(bIsSnapBoxDetected)
+				: IsBuildingSupported(bShoudBeSupportedWithBuilding);
+		}
 		if (bIsSnapBoxDetected) // Snap Box detected. Attach "GhostMeshComponent" to its Transform.
 		{
 			if (!bIsGhostMeshColliding) // "GhostMeshComponent" is not colliding with other Objects.
@@ -221,8 +288,54 @@ void UBuildingComponent::InteractWithBuilding_Client_Implementation(AActor* InBu
 	IBuildInterface::Execute_InteractWithBuilding(InBuilding);
 }
 
+void UBuildingComponent::UpgradeBuilding_Server_Implementation(EBuildingTier NewTier, bool bWholeBase)
+{
+	FHitResult ServerHitResult = IPlayerInterface::Execute_LineTraceFromCamera(GetOwner(), 1.f, 350.f);
+	ABuildableBase* HitBuilding = Cast<ABuildableBase>(ServerHitResult.GetActor());
+	if (!HitBuilding)
+	{
+		return;
+	}
+
+	TArray<ABuildableBase*> Buildings;
+	const UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>();
+	if (bWholeBase && BuildingSubsystem)
+	{
+		BuildingSubsystem->GetConnectedPieces(HitBuilding, Buildings);
+	}
+	else
+	{
+		Buildings.Add(HitBuilding);
+	}
+
+	// Pieces already at the tier, or placed by someone else, are left as they are.
+	Buildings.RemoveAllSwap([this, NewTier](const ABuildableBase* Building) { return !CanUpgradeBuilding(Building, NewTier); });
+	if (Buildings.IsEmpty() || !PayForUpgrade(Buildings, NewTier))
+	{
+		return;
+	}
+
+	// Every piece only changes one replicated byte, and each compound it touches is rebuilt once on the next tick.
+	for (ABuildableBase* Building : Buildings)
+	{
+		Building->SetTier(NewTier);
+	}
+}
+
+bool UBuildingComponent::CanUpgradeBuilding_Implementation(const ABuildableBase* Building, EBuildingTier NewTier) const
+{
+	return Building && Building->CanUpgradeTo(NewTier) && (!Building->GetOwner() || Building->IsOwnedBy(GetOwner()));
+}
+
+bool UBuildingComponent::PayForUpgrade_Implementation(const TArray<ABuildableBase*>& Buildings, EBuildingTier NewTier)
+{
+	return true;
+}
+
 bool UBuildingComponent::DetectBuildBoxes()
 {
+	HOPE_BUILDING_SCOPE(DetectBuildBoxes);
+
 	bool bFound = false;
 	
 	if (HitActor && HitActor->Implements<UBuildInterface>())
@@ -230,6 +343,7 @@ bool UBuildingComponent::DetectBuildBoxes()
 		TArray<UBoxComponent*> BoxesArray = IBuildInterface::Execute_ReturnBoxes(HitActor);
 		for (UBoxComponent* CurrentBox : BoxesArray)
 		{
+			HOPE_BUILDING_COUNT(SnapCandidates, 1);
 			if (HitComponent == CurrentBox)
 			{
 				bFound = true;
@@ -244,11 +358,24 @@ bool UBuildingComponent::DetectBuildBoxes()
 
 bool UBuildingComponent::IsBuildingSupported(bool bSupportedByBuilding)
 {
+	HOPE_BUILDING_SCOPE(Support);
+
 	if (bSupportedByBuilding)
 	{
 		TArray<AActor*> OverlappingActors;
 		TSubclassOf<ABuildableBase> BBClass;
 		BuildGhostComponent->GetOverlappingActors(OverlappingActors, BBClass);
+
+		// Settled pieces overlap as their cell's compound body, they are looked up by bounds instead.
+		for (int32 Index = OverlappingActors.Num() - 1; Index >= 0; Index--)
+		{
+			if (const ABuildingCompoundActor* CompoundActor = Cast<ABuildingCompoundActor>(OverlappingActors[Index]))
+			{
+				OverlappingActors.RemoveAtSwap(Index);
+				CompoundActor->GetCompoundComponent()->FindPiecesOverlapping(BuildGhostComponent->Bounds.GetBox(), OverlappingActors);
+			}
+		}
+		HOPE_BUILDING_COUNT(Overlaps, OverlappingActors.Num());
 		TArray<AActor*> RequiredActors;
 		int32 NumPillars;
 		switch (Buildables[BuildID]->BuildingType)
@@ -315,29 +442,28 @@ bool UBuildingComponent::IsBuildingSupported(bool bSupportedByBuilding)
 	else
 	{
 		FVector Start = BuildTransform.GetLocation();
-		if (Buildables[BuildID]->BuildingType == EBuildingType::EBT_Foundation)
-		{
-			Start = Start + FVector(0.f, 0.f, 80.f);
-		}
 		FVector End = BuildTransform.GetLocation() - FVector(0.f, 0.f, BuildingSupportHeight);
 		TArray<AActor*> ActorsToIgnore;
 		ActorsToIgnore.Add(GetOwner());
 		FHitResult HitResult;
 
+		HOPE_BUILDING_COUNT(Traces, 1);
 		bool bHit = UKismetSystemLibrary::LineTraceSingle(BuildGhostComponent,
 			Start,
 			End,
 			ETraceTypeQuery::TraceTypeQuery1,
 			false,
 			ActorsToIgnore,
-			EDrawDebugTrace::ForOneFrame,
+			EDrawDebugTrace::None,
 			HitResult,
 			true,
 			FLinearColor::Yellow);
+		HOPE_DEBUG_LINE(Building, this, Start, End, bHit ? &HitResult : nullptr);
 
 		if (bHit)
 		{
-			if (HitResult.GetActor()->IsA(Buildables[BuildID]->BuildingClass))
+			const AActor* SupportActor = UBuildingCompoundComponent::GetHitActor(HitResult);
+			if (SupportActor && SupportActor->IsA(Buildables[BuildID]->BuildingClass))
 			{
 				return false;
 			}
@@ -349,6 +475,8 @@ bool UBuildingComponent::IsBuildingSupported(bool bSupportedByBuilding)
 
 bool UBuildingComponent::IsBuildingColliding()
 {
+	HOPE_BUILDING_SCOPE(Collision);
+
 	FVector Origin;
 	FVector BoxExtent;
 	float SphereRadius;
@@ -399,10 +527,13 @@ bool UBuildingComponent::IsBuildingColliding()
 		ETraceTypeQuery::TraceTypeQuery1,
 		false,
 		ActorsToIgnore,
-		EDrawDebugTrace::ForOneFrame,
+		EDrawDebugTrace::None,
 		HitResult,
 		true,
 		FLinearColor::Blue);
+	HOPE_DEBUG_BOX(Building, this, Origin, Origin, BoxExtent, FQuat::Identity, bHit ? &HitResult : nullptr);
+	HOPE_BUILDING_COUNT(Traces, 1);
+	HOPE_BUILDING_COUNT(Overlaps, bHit ? 1 : 0);
 
 	return bHit;
 }
@@ -418,18 +549,155 @@ void UBuildingComponent::RotateBuildGhostMesh(float YawRotation)
 
 void UBuildingComponent::ChangeBuildGhostMesh()
 {
+	HOPE_BUILDING_SCOPE(GhostMesh);
+
 	if (BuildGhostComponent) BuildGhostComponent->SetStaticMesh(Buildables[BuildID]->Mesh);
 }
 
-void UBuildingComponent::SpawnBuilding_Server_Implementation(TSubclassOf<ABuildableBase> BuildingClass, const FTransform& Transform, AActor* Owner, APawn* Instigator)
+void UBuildingComponent::SpawnBuilding_Server_Implementation(TSubclassOf<ABuildableBase> BuildingClass, const FTransform& Transform, float StiltHeight)
 {
+	HOPE_BUILDING_SCOPE(Spawn);
+	HOPE_BUILDING_COUNT(Spawns, 1);
+
+	// The owner decides who may upgrade the piece later, so it is taken from the server and not from the client.
 	ABuildableBase* SpawnedBuilding = GetWorld()->SpawnActorDeferred<ABuildableBase>(
 		BuildingClass,
 		Transform,
-		Owner,
-		Instigator);
+		GetOwner(),
+		GetOwner<APawn>());
 
+	if (SpawnedBuilding)
+	{
+		SpawnedBuilding->StiltHeight = FMath::Clamp(StiltHeight, 0.f, FoundationMaxStiltHeight);
+	}
 	UGameplayStatics::FinishSpawningActor(SpawnedBuilding, Transform);
 }
 
+/*
+*		***********************	Foundation Ground ***********************
+*/
+
+bool UBuildingComponent::IsFoundationSupported(bool bIsSnapped)
+{
+	HOPE_BUILDING_SCOPE(Support);
+
+	ResolveFoundationGroundSamples();
+
+	const FTransform SampleTransform = BuildTransform;
+	if (FoundationTraceHandles.Num() == 0)
+	{
+		RequestFoundationGroundSamples(bIsSnapped);
+	}
+
+	// The samples lag one update behind the ghost, they are used as long as it did not move too far since.
+	if (!FoundationGround.bIsValid || !FoundationGround.bIsSupported || FoundationGround.bIsSnapped != bIsSnapped
+		|| FVector::Dist(FoundationGround.Transform.GetLocation(), SampleTransform.GetLocation()) > FoundationSampleTolerance
+		|| !FoundationGround.Transform.GetRotation().Equals(SampleTransform.GetRotation(), KINDA_SMALL_NUMBER))
+	{
+		return false;
+	}
+
+	if (!bIsSnapped)
+	{
+		FVector LeveledLocation = BuildTransform.GetLocation();
+		LeveledLocation.Z = FoundationGround.TopZ;
+		BuildTransform.SetLocation(LeveledLocation);
+	}
+	BuildStiltHeight = FMath::Max(BuildTransform.GetLocation().Z - (FoundationGround.TopZ - FoundationGround.StiltHeight), 0.f);
+	return BuildStiltHeight <= FoundationMaxStiltHeight;
+}
+
+void UBuildingComponent::RequestFoundationGroundSamples(bool bIsSnapped)
+{
+	HOPE_BUILDING_SCOPE(FoundationGround);
+
+	const UStaticMesh* Mesh = Buildables[BuildID]->Mesh;
+	if (!Mesh)
+	{
+		return;
+	}
+
+	// Samples are spread over the footprint, inset a little so they do not land on the edge of a neighbouring foundation.
+	const FBox LocalBox = Mesh->GetBoundingBox();
+	const FVector2D Min = FVector2D(LocalBox.Min) * 0.9f;
+	const FVector2D Max = FVector2D(LocalBox.Max) * 0.9f;
+	const int32 SamplesPerSide = FMath::Clamp(FoundationSamplesPerSide, 2, 8);
+	const float TraceHalfLength = FoundationMaxStiltHeight + FoundationSampleMargin;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FoundationGround), false, GetOwner());
+	FoundationTraceTransform = BuildTransform;
+	bFoundationTraceSnapped = bIsSnapped;
+	FoundationTraceHandles.Reset(SamplesPerSide * SamplesPerSide);
+	HOPE_BUILDING_COUNT(Traces, SamplesPerSide * SamplesPerSide);
+
+	// All traces go into the async batch of this frame and are read together on a later update.
+	for (int32 Y = 0; Y < SamplesPerSide; Y++)
+	{
+		for (int32 X = 0; X < SamplesPerSide; X++)
+		{
+			const FVector2D Alpha(float(X) / (SamplesPerSide - 1), float(Y) / (SamplesPerSide - 1));
+			const FVector2D LocalPoint = FMath::Lerp(Min, Max, Alpha);
+			const FVector SamplePoint = BuildTransform.TransformPosition(FVector(LocalPoint, 0.f));
+
+			FoundationTraceHandles.Add(GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single,
+				SamplePoint + FVector(0.f, 0.f, TraceHalfLength),
+				SamplePoint - FVector(0.f, 0.f, TraceHalfLength),
+				ECC_Visibility,
+				QueryParams));
+		}
+	}
+}
+
+void UBuildingComponent::ResolveFoundationGroundSamples()
+{
+	if (FoundationTraceHandles.Num() == 0)
+	{
+		return;
+	}
+
+	HOPE_BUILDING_SCOPE(FoundationGround);
+
+	float MinZ = TNumericLimits<float>::Max();
+	float MaxZ = TNumericLimits<float>::Lowest();
+	bool bIsSupported = true;
+	for (const FTraceHandle& TraceHandle : FoundationTraceHandles)
+	{
+		FTraceDatum TraceDatum;
+		if (!GetWorld()->QueryTraceData(TraceHandle, TraceDatum))
+		{
+			// Handles expire after a frame, a batch that was never read is sent again.
+			if (!GetWorld()->IsTraceHandleValid(TraceHandle, false))
+			{
+				FoundationTraceHandles.Reset();
+			}
+			return;
+		}
+
+		// A missing sample means the footprint hangs over an edge, hitting a foundation means it would stack on one.
+		const FHitResult* Hit = TraceDatum.OutHits.FindByPredicate([](const FHitResult& HitResult) { return HitResult.bBlockingHit; });
+		HOPE_DEBUG_LINE(Building, this, TraceDatum.Start, TraceDatum.End, Hit);
+		const AActor* GroundActor = Hit ? UBuildingCompoundComponent::GetHitActor(*Hit) : nullptr;
+		if (!Hit || (GroundActor && GroundActor->IsA(Buildables[BuildID]->BuildingClass)))
+		{
+			bIsSupported = false;
+			continue;
+		}
+		MinZ = FMath::Min(MinZ, Hit->ImpactPoint.Z);
+		MaxZ = FMath::Max(MaxZ, Hit->ImpactPoint.Z);
+	}
+	FoundationTraceHandles.Reset();
+
+	// Free foundations rest on the highest sample and stand on stilts everywhere else. Snapped ones keep their height.
+	FoundationGround.Transform = FoundationTraceTransform;
+	FoundationGround.bIsSnapped = bFoundationTraceSnapped;
+	FoundationGround.bIsValid = true;
+	FoundationGround.bIsSupported = bIsSupported;
+	FoundationGround.TopZ = bFoundationTraceSnapped ? FoundationTraceTransform.GetLocation().Z : MaxZ;
+	FoundationGround.StiltHeight = bIsSupported ? FMath::Max(FoundationGround.TopZ - MinZ, 0.f) : 0.f;
+}
+
+/*
+*		***********************	Foundation Ground ***********************
+*/
+
 
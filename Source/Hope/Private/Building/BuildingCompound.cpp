@@ -0,0 +1,270 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Building/BuildingCompound.h"
+#include "Building/BuildableBase.h"
+#include "Building/BuildingTrace.h"
+#include "Engine/DamageEvents.h"
+#include "PhysicsEngine/BodySetup.h"
+
+UBuildingCompoundComponent::UBuildingCompoundComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	Mobility = EComponentMobility::Static;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetCanEverAffectNavigation(false);
+	bHiddenInGame = true;
+}
+
+bool UBuildingCompoundComponent::CanFold(const ABuildableBase* Piece) const
+{
+	// Pieces that open move their collision, which the compound can't follow.
+	if (Piece->CanOpen())
+	{
+		return false;
+	}
+
+	const UStaticMeshComponent* Mesh = Piece->BaseMeshComponent;
+	const UBodySetup* PieceBodySetup = Mesh ? Mesh->GetBodySetup() : nullptr;
+
+	// Pieces that only have complex collision would lose it.
+	if (!PieceBodySetup || PieceBodySetup->AggGeom.GetElementCount() == 0 || PieceBodySetup->CollisionTraceFlag == CTF_UseComplexAsSimple)
+	{
+		return false;
+	}
+	if (!bHasCollisionSettings)
+	{
+		return true;
+	}
+	return Mesh->GetCollisionObjectType() == GetCollisionObjectType() && Mesh->GetCollisionResponseToChannels() == GetCollisionResponseToChannels();
+}
+
+void UBuildingCompoundComponent::Rebuild(const TArray<ABuildableBase*>& Pieces)
+{
+	HOPE_BUILDING_SCOPE(CompoundRebuild);
+
+	TArray<FBuildingCompoundShape> OldShapes = MoveTemp(Shapes);
+	Shapes.Reset(Pieces.Num());
+	LocalBounds.Init();
+	bHasCollisionSettings = false;
+
+	UBodySetup* NewBodySetup = NewObject<UBodySetup>(this, NAME_None, RF_Transient);
+	NewBodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	NewBodySetup->bNeverNeedsCookedCollisionData = true;
+	FKAggregateGeom& AggGeom = NewBodySetup->AggGeom;
+
+	const FTransform WorldToComponent = GetComponentTransform().Inverse();
+	for (ABuildableBase* Piece : Pieces)
+	{
+		if (!IsValid(Piece) || Piece->IsActorBeingDestroyed())
+		{
+			continue;
+		}
+
+		UStaticMeshComponent* Mesh = Piece->BaseMeshComponent;
+		const int32 OldShapeIndex = OldShapes.IndexOfByPredicate([Piece](const FBuildingCompoundShape& Shape) { return Shape.Piece == Piece; });
+		const ECollisionEnabled::Type PieceCollisionEnabled = OldShapeIndex != INDEX_NONE ? OldShapes[OldShapeIndex].PieceCollisionEnabled.GetValue()
+			: Mesh->GetCollisionEnabled();
+		const EHasCustomNavigableGeometry::Type PieceNavigableGeometry = OldShapeIndex != INDEX_NONE
+			? OldShapes[OldShapeIndex].PieceNavigableGeometry.GetValue() : Mesh->HasCustomNavigableGeometry();
+		if (PieceCollisionEnabled == ECollisionEnabled::NoCollision || !CanFold(Piece))
+		{
+			continue;
+		}
+		if (OldShapeIndex != INDEX_NONE)
+		{
+			OldShapes.RemoveAtSwap(OldShapeIndex);
+		}
+
+		if (!bHasCollisionSettings)
+		{
+			SetCollisionObjectType(Mesh->GetCollisionObjectType());
+			SetCollisionResponseToChannels(Mesh->GetCollisionResponseToChannels());
+			SetGenerateOverlapEvents(Mesh->GetGenerateOverlapEvents());
+			SetCollisionEnabled(PieceCollisionEnabled);
+			bHasCollisionSettings = true;
+		}
+
+		// Simple shapes are baked into the compound's space. Convex hulls keep sharing the cooked data of the piece mesh.
+		const FTransform PieceToCompound = Mesh->GetComponentTransform() * WorldToComponent;
+		const FVector Scale3D = PieceToCompound.GetScale3D();
+		FTransform RelativeTM = PieceToCompound;
+		RelativeTM.RemoveScaling();
+
+		const FKAggregateGeom& PieceGeom = Mesh->GetBodySetup()->AggGeom;
+		for (const FKBoxElem& Box : PieceGeom.BoxElems)
+		{
+			AggGeom.BoxElems.Add(Box.GetFinalScaled(Scale3D, RelativeTM));
+		}
+		for (const FKSphereElem& Sphere : PieceGeom.SphereElems)
+		{
+			AggGeom.SphereElems.Add(Sphere.GetFinalScaled(Scale3D, RelativeTM));
+		}
+		for (const FKSphylElem& Sphyl : PieceGeom.SphylElems)
+		{
+			AggGeom.SphylElems.Add(Sphyl.GetFinalScaled(Scale3D, RelativeTM));
+		}
+		for (const FKConvexElem& Convex : PieceGeom.ConvexElems)
+		{
+			FKConvexElem& NewConvex = AggGeom.ConvexElems.Add_GetRef(Convex);
+			NewConvex.SetTransform(Convex.GetTransform() * PieceToCompound);
+		}
+
+		FBuildingCompoundShape& Shape = Shapes.AddDefaulted_GetRef();
+		Shape.Piece = Piece;
+		Shape.PieceID = Piece->PieceID;
+		Shape.Bounds = Mesh->Bounds.GetBox();
+		Shape.PieceCollisionEnabled = PieceCollisionEnabled;
+		Shape.PieceNavigableGeometry = PieceNavigableGeometry;
+		LocalBounds += Shape.Bounds.TransformBy(WorldToComponent);
+
+		// Set before the collision goes off, so the piece never stops being relevant to navigation and no tile is rebuilt.
+		Mesh->bHasCustomNavigableGeometry = EHasCustomNavigableGeometry::EvenIfNotCollision;
+		Mesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	// Pieces that left the compound without being destroyed get their own body back.
+	for (const FBuildingCompoundShape& OldShape : OldShapes)
+	{
+		ABuildableBase* Piece = OldShape.Piece.Get();
+		if (Piece && !Piece->IsActorBeingDestroyed())
+		{
+			Piece->BaseMeshComponent->SetCollisionEnabled(OldShape.PieceCollisionEnabled);
+			Piece->BaseMeshComponent->bHasCustomNavigableGeometry = OldShape.PieceNavigableGeometry;
+		}
+	}
+
+	if (Shapes.Num() > 0)
+	{
+		NewBodySetup->bCreatedPhysicsMeshes = true;
+		CompoundBodySetup = NewBodySetup;
+	}
+	else
+	{
+		CompoundBodySetup = nullptr;
+		SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+
+	UpdateBounds();
+	RecreatePhysicsState();
+}
+
+bool UBuildingCompoundComponent::ContainsPiece(const ABuildableBase* Piece) const
+{
+	return Shapes.ContainsByPredicate([Piece](const FBuildingCompoundShape& Shape) { return Shape.Piece == Piece; });
+}
+
+ABuildableBase* UBuildingCompoundComponent::FindPieceAt(const FVector& WorldLocation) const
+{
+	// Hits land on the surface, so the bounds are grown a little. The smallest box wins where pieces overlap, e.g. a pillar in a wall.
+	ABuildableBase* FoundPiece = nullptr;
+	double FoundVolume = TNumericLimits<double>::Max();
+	for (const FBuildingCompoundShape& Shape : Shapes)
+	{
+		if (Shape.Bounds.ExpandBy(1.0).IsInsideOrOn(WorldLocation) && Shape.Bounds.GetVolume() < FoundVolume)
+		{
+			if (ABuildableBase* Piece = Shape.Piece.Get())
+			{
+				FoundPiece = Piece;
+				FoundVolume = Shape.Bounds.GetVolume();
+			}
+		}
+	}
+	return FoundPiece;
+}
+
+void UBuildingCompoundComponent::FindPiecesOverlapping(const FBox& WorldBox, TArray<AActor*>& OutPieces) const
+{
+	for (const FBuildingCompoundShape& Shape : Shapes)
+	{
+		if (Shape.Bounds.Intersect(WorldBox))
+		{
+			if (ABuildableBase* Piece = Shape.Piece.Get())
+			{
+				OutPieces.AddUnique(Piece);
+			}
+		}
+	}
+}
+
+bool UBuildingCompoundComponent::ResolveHit(FHitResult& HitResult)
+{
+	const UBuildingCompoundComponent* Compound = Cast<UBuildingCompoundComponent>(HitResult.GetComponent());
+	ABuildableBase* Piece = Compound ? Compound->FindPieceAt(HitResult.ImpactPoint) : nullptr;
+	if (!Piece)
+	{
+		return false;
+	}
+
+	HitResult.HitObjectHandle = FActorInstanceHandle(Piece);
+	HitResult.Component = Piece->BaseMeshComponent;
+	return true;
+}
+
+AActor* UBuildingCompoundComponent::GetHitActor(const FHitResult& HitResult)
+{
+	if (const UBuildingCompoundComponent* Compound = Cast<UBuildingCompoundComponent>(HitResult.GetComponent()))
+	{
+		return Compound->FindPieceAt(HitResult.ImpactPoint);
+	}
+	return HitResult.GetActor();
+}
+
+FBoxSphereBounds UBuildingCompoundComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	if (!LocalBounds.IsValid)
+	{
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.f);
+	}
+	return FBoxSphereBounds(LocalBounds.TransformBy(LocalToWorld));
+}
+
+ABuildingCompoundActor::ABuildingCompoundActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = false;
+
+	CompoundComponent = CreateDefaultSubobject<UBuildingCompoundComponent>(TEXT("CompoundComponent"));
+	SetRootComponent(CompoundComponent);
+}
+
+float ABuildingCompoundActor::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	// The compound has no health of its own, the damage belongs to the pieces that were hit.
+	if (DamageEvent.IsOfType(FPointDamageEvent::ClassID))
+	{
+		FPointDamageEvent PieceDamageEvent = static_cast<const FPointDamageEvent&>(DamageEvent);
+		if (UBuildingCompoundComponent::ResolveHit(PieceDamageEvent.HitInfo))
+		{
+			return PieceDamageEvent.HitInfo.GetActor()->TakeDamage(DamageAmount, PieceDamageEvent, EventInstigator, DamageCauser);
+		}
+	}
+	else if (DamageEvent.IsOfType(FRadialDamageEvent::ClassID))
+	{
+		const FRadialDamageEvent& RadialDamageEvent = static_cast<const FRadialDamageEvent&>(DamageEvent);
+		TArray<AActor*> Pieces;
+		CompoundComponent->FindPiecesOverlapping(FBox::BuildAABB(RadialDamageEvent.Origin, FVector(RadialDamageEvent.Params.OuterRadius)), Pieces);
+
+		float TotalDamage = 0.f;
+		const float OuterRadiusSquared = FMath::Square(RadialDamageEvent.Params.OuterRadius);
+		for (AActor* Piece : Pieces)
+		{
+			// The overlap only tests boxes, pieces in the corners of the box are still outside the sphere.
+			UStaticMeshComponent* Mesh = CastChecked<ABuildableBase>(Piece)->BaseMeshComponent;
+			const FBox PieceBounds = Mesh->Bounds.GetBox();
+			const FVector ClosestPoint = PieceBounds.GetClosestPointTo(RadialDamageEvent.Origin);
+			if (FVector::DistSquared(ClosestPoint, RadialDamageEvent.Origin) > OuterRadiusSquared)
+			{
+				continue;
+			}
+
+			// The falloff is taken from the closest component hit, which has to be on the piece and not on the compound.
+			FRadialDamageEvent PieceDamageEvent = RadialDamageEvent;
+			PieceDamageEvent.ComponentHits.Reset(1);
+			PieceDamageEvent.ComponentHits.Emplace(Piece, Mesh, ClosestPoint, (RadialDamageEvent.Origin - ClosestPoint).GetSafeNormal());
+			TotalDamage += Piece->TakeDamage(DamageAmount, PieceDamageEvent, EventInstigator, DamageCauser);
+		}
+		return TotalDamage;
+	}
+	return 0.f;
+}
@@ -0,0 +1,71 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Building/BuildingDeviceComponent.h"
+#include "Building/BuildingDeviceSubsystem.h"
+#include "Net/UnrealNetwork.h"
+
+UBuildingDeviceComponent::UBuildingDeviceComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetIsReplicatedByDefault(true);
+}
+
+void UBuildingDeviceComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetOwner()->HasAuthority())
+	{
+		if (UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>())
+		{
+			DeviceSubsystem->RegisterDevice(this);
+		}
+	}
+}
+
+void UBuildingDeviceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (NodeIndex != INDEX_NONE)
+	{
+		if (UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>())
+		{
+			DeviceSubsystem->UnregisterDevice(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UBuildingDeviceComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UBuildingDeviceComponent, bIsClosed);
+	DOREPLIFETIME(UBuildingDeviceComponent, bIsPowered);
+}
+
+void UBuildingDeviceComponent::SetClosed(bool bNewIsClosed)
+{
+	if (bIsClosed == bNewIsClosed || !GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	bIsClosed = bNewIsClosed;
+	if (UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>())
+	{
+		DeviceSubsystem->MarkDeviceDirty(this);
+	}
+}
+
+void UBuildingDeviceComponent::SetPowered(bool bNewIsPowered)
+{
+	bIsPowered = bNewIsPowered;
+	OnPoweredChanged.Broadcast(bIsPowered);
+}
+
+void UBuildingDeviceComponent::OnRep_IsPowered()
+{
+	OnPoweredChanged.Broadcast(bIsPowered);
+}
@@ -0,0 +1,225 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Building/BuildingDeviceSubsystem.h"
+#include "Building/BuildingTrace.h"
+
+namespace HopeDevices
+{
+	static float MaxWireLength = 1500.0f;
+	FAutoConsoleVariableRef CVar_MaxWireLength(TEXT("Hope.Devices.MaxWireLength"), MaxWireLength,
+		TEXT("Longest wire that can connect two building devices."), ECVF_Default);
+}
+
+void UBuildingDeviceSubsystem::Deinitialize()
+{
+	Nodes.Empty();
+	FreeNodes.Empty();
+	DirtyNodes.Empty();
+
+	Super::Deinitialize();
+}
+
+void UBuildingDeviceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (DirtyNodes.Num() == 0)
+	{
+		return;
+	}
+
+	HOPE_BUILDING_SCOPE(DeviceSolve);
+
+	// Devices reacting to their new output may edit the graph again, which is picked up on the next tick.
+	TArray<int32> NodesToSolve = MoveTemp(DirtyNodes);
+	SolveMark++;
+	for (const int32 NodeIndex : NodesToSolve)
+	{
+		if (IsValidNode(NodeIndex) && Nodes[NodeIndex].SolveMark != SolveMark)
+		{
+			SolveNetwork(NodeIndex);
+		}
+	}
+
+	TArray<TWeakObjectPtr<UBuildingDeviceComponent>> DevicesToNotify = MoveTemp(ChangedDevices);
+	for (const TWeakObjectPtr<UBuildingDeviceComponent>& Device : DevicesToNotify)
+	{
+		if (Device.IsValid() && IsValidNode(Device->NodeIndex))
+		{
+			Device->SetPowered(Nodes[Device->NodeIndex].bIsPowered);
+		}
+	}
+}
+
+TStatId UBuildingDeviceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBuildingDeviceSubsystem, STATGROUP_Tickables);
+}
+
+void UBuildingDeviceSubsystem::RegisterDevice(UBuildingDeviceComponent* Device)
+{
+	check(Device);
+	if (Device->NodeIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	// Slots are reused, so consumers placed into a freed slot are served as if they had been placed earlier.
+	Device->NodeIndex = FreeNodes.Num() > 0 ? FreeNodes.Pop(EAllowShrinking::No) : Nodes.AddDefaulted();
+	Nodes[Device->NodeIndex].Device = Device;
+	MarkNodeDirty(Device->NodeIndex);
+}
+
+void UBuildingDeviceSubsystem::UnregisterDevice(UBuildingDeviceComponent* Device)
+{
+	check(Device);
+	const int32 NodeIndex = Device->NodeIndex;
+	if (!Nodes.IsValidIndex(NodeIndex))
+	{
+		return;
+	}
+
+	for (const int32 WiredNode : Nodes[NodeIndex].Wires)
+	{
+		Nodes[WiredNode].Wires.RemoveSingleSwap(NodeIndex);
+		DirtyNodes.Add(WiredNode);
+	}
+
+	Nodes[NodeIndex] = FBuildingDeviceNode();
+	FreeNodes.Add(NodeIndex);
+	Device->NodeIndex = INDEX_NONE;
+}
+
+bool UBuildingDeviceSubsystem::ConnectDevices(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB)
+{
+	if (!DeviceA || !DeviceB || DeviceA == DeviceB || !IsValidNode(DeviceA->NodeIndex) || !IsValidNode(DeviceB->NodeIndex))
+	{
+		return false;
+	}
+
+	const int32 NodeA = DeviceA->NodeIndex;
+	const int32 NodeB = DeviceB->NodeIndex;
+	if (Nodes[NodeA].Wires.Contains(NodeB)
+		|| FVector::DistSquared(DeviceA->GetOwner()->GetActorLocation(), DeviceB->GetOwner()->GetActorLocation()) > FMath::Square(HopeDevices::MaxWireLength))
+	{
+		return false;
+	}
+
+	Nodes[NodeA].Wires.Add(NodeB);
+	Nodes[NodeB].Wires.Add(NodeA);
+	DirtyNodes.Add(NodeA);
+	OnDeviceWireChanged.Broadcast(DeviceA, DeviceB, true);
+	return true;
+}
+
+void UBuildingDeviceSubsystem::DisconnectDevices(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB)
+{
+	if (!DeviceA || !DeviceB || !IsValidNode(DeviceA->NodeIndex) || !IsValidNode(DeviceB->NodeIndex))
+	{
+		return;
+	}
+
+	// The network may have split, so both sides are solved again.
+	const int32 NodeA = DeviceA->NodeIndex;
+	const int32 NodeB = DeviceB->NodeIndex;
+	if (Nodes[NodeA].Wires.RemoveSingleSwap(NodeB) > 0)
+	{
+		Nodes[NodeB].Wires.RemoveSingleSwap(NodeA);
+		DirtyNodes.Add(NodeA);
+		DirtyNodes.Add(NodeB);
+		OnDeviceWireChanged.Broadcast(DeviceA, DeviceB, false);
+	}
+}
+
+void UBuildingDeviceSubsystem::MarkDeviceDirty(UBuildingDeviceComponent* Device)
+{
+	if (Device && IsValidNode(Device->NodeIndex))
+	{
+		MarkNodeDirty(Device->NodeIndex);
+	}
+}
+
+void UBuildingDeviceSubsystem::GetWires(TArray<TPair<UBuildingDeviceComponent*, UBuildingDeviceComponent*>>& OutWires) const
+{
+	for (int32 NodeIndex = 0; NodeIndex < Nodes.Num(); NodeIndex++)
+	{
+		UBuildingDeviceComponent* Device = Nodes[NodeIndex].Device.Get();
+		if (!Device)
+		{
+			continue;
+		}
+
+		// Every wire is stored on both ends, it is reported from the lower one.
+		for (const int32 WiredNode : Nodes[NodeIndex].Wires)
+		{
+			if (WiredNode > NodeIndex && IsValidNode(WiredNode))
+			{
+				OutWires.Emplace(Device, Nodes[WiredNode].Device.Get());
+			}
+		}
+	}
+}
+
+void UBuildingDeviceSubsystem::MarkNodeDirty(int32 NodeIndex)
+{
+	FBuildingDeviceNode& Node = Nodes[NodeIndex];
+	const UBuildingDeviceComponent* Device = Node.Device.Get();
+	Node.Type = Device->DeviceType;
+	Node.Supply = Device->DeviceType == EBuildingDeviceType::EBDT_Generator ? FMath::Max(Device->PowerOutput, 0.f) : 0.f;
+	Node.Demand = Device->DeviceType == EBuildingDeviceType::EBDT_Consumer ? FMath::Max(Device->PowerDemand, 0.f) : 0.f;
+	Node.bConducts = Device->DeviceType != EBuildingDeviceType::EBDT_Switch || Device->bIsClosed;
+
+	// A switch that opened no longer reaches its neighbours from here, so they are solved on their own.
+	DirtyNodes.Add(NodeIndex);
+	DirtyNodes.Append(Node.Wires);
+}
+
+void UBuildingDeviceSubsystem::SolveNetwork(int32 StartNode)
+{
+	NetworkNodes.Reset();
+	NetworkNodes.Add(StartNode);
+	Nodes[StartNode].SolveMark = SolveMark;
+
+	// Open switches are never entered, and a network started from one only holds the switch itself.
+	float Supply = 0.f;
+	for (int32 Index = 0; Index < NetworkNodes.Num(); Index++)
+	{
+		const FBuildingDeviceNode& Node = Nodes[NetworkNodes[Index]];
+		Supply += Node.Supply;
+		if (!Node.bConducts)
+		{
+			continue;
+		}
+		for (const int32 WiredNode : Node.Wires)
+		{
+			FBuildingDeviceNode& Wired = Nodes[WiredNode];
+			if (Wired.SolveMark != SolveMark && Wired.bConducts)
+			{
+				Wired.SolveMark = SolveMark;
+				NetworkNodes.Add(WiredNode);
+			}
+		}
+	}
+	HOPE_BUILDING_COUNT(DeviceNodesSolved, NetworkNodes.Num());
+
+	NetworkNodes.Sort();
+	float RemainingSupply = Supply;
+	for (const int32 NodeIndex : NetworkNodes)
+	{
+		FBuildingDeviceNode& Node = Nodes[NodeIndex];
+		bool bIsPowered = Node.bConducts && Supply > 0.f;
+		if (Node.Type == EBuildingDeviceType::EBDT_Consumer)
+		{
+			bIsPowered = bIsPowered && Node.Demand <= RemainingSupply;
+			RemainingSupply -= bIsPowered ? Node.Demand : 0.f;
+		}
+
+		if (Node.bIsPowered != bIsPowered)
+		{
+			Node.bIsPowered = bIsPowered;
+			ChangedDevices.Add(Node.Device);
+			HOPE_BUILDING_COUNT(DeviceOutputsFlipped, 1);
+		}
+	}
+}
@@ -0,0 +1,629 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Building/BuildingSubsystem.h"
+#include "Building/BuildableBase.h"
+#include "Building/BuildingCompound.h"
+#include "Building/BuildingComponent.h"
+#include "Building/BuildingTrace.h"
+#include "InputControl/HopePlayerController.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "Hope.h"
+
+namespace HopeBuilding
+{
+	static float CellSize = 2000.0f;
+	FAutoConsoleVariableRef CVar_CellSize(TEXT("Hope.Building.CellSize"), CellSize,
+		TEXT("Size of the grid cells buildables are bucketed into. Must be set before any buildable is spawned."), ECVF_ReadOnly);
+
+	static float StreamBytesPerSecond = 32768.0f;
+	FAutoConsoleVariableRef CVar_StreamBytesPerSecond(TEXT("Hope.Building.StreamBytesPerSecond"), StreamBytesPerSecond,
+		TEXT("Bandwidth budget per connection used to trickle building cells to a joining player."), ECVF_Default);
+
+	static float StreamBytesPerPiece = 96.0f;
+	FAutoConsoleVariableRef CVar_StreamBytesPerPiece(TEXT("Hope.Building.StreamBytesPerPiece"), StreamBytesPerPiece,
+		TEXT("Estimated size of the initial replication bunch of one buildable."), ECVF_Default);
+
+	static float PlayableRadius = 6000.0f;
+	FAutoConsoleVariableRef CVar_PlayableRadius(TEXT("Hope.Building.PlayableRadius"), PlayableRadius,
+		TEXT("A joining player is considered playable once every cell within this radius of its pawn has been streamed."), ECVF_Default);
+
+	static float ResortInterval = 1.0f;
+	FAutoConsoleVariableRef CVar_ResortInterval(TEXT("Hope.Building.StreamResortInterval"), ResortInterval,
+		TEXT("How often pending cells are re-sorted against the current pawn location while streaming."), ECVF_Default);
+
+	static float ConnectionTolerance = 5.0f;
+	FAutoConsoleVariableRef CVar_ConnectionTolerance(TEXT("Hope.Building.ConnectionTolerance"), ConnectionTolerance,
+		TEXT("Gap up to which the meshes of two pieces count as touching when the pieces of a base are gathered."), ECVF_Default);
+
+	static float NearDistance = 5000.0f;
+	FAutoConsoleVariableRef CVar_NearDistance(TEXT("Hope.Building.NearDistance"), NearDistance,
+		TEXT("Viewers within this distance of a piece receive all of it: doors, windows, damage and impact updates."), ECVF_Default);
+
+	static float MidDistance = 20000.0f;
+	FAutoConsoleVariableRef CVar_MidDistance(TEXT("Hope.Building.MidDistance"), MidDistance,
+		TEXT("Viewers within this distance of a piece receive structural pieces only."), ECVF_Default);
+
+	static float FarDistance = 40000.0f;
+	FAutoConsoleVariableRef CVar_FarDistance(TEXT("Hope.Building.FarDistance"), FarDistance,
+		TEXT("Viewers within this distance of a piece receive foundations only. Nothing is replicated beyond it."), ECVF_Default);
+
+	static FAutoConsoleCommandWithWorld NetReportCommand(TEXT("Hope.Building.NetReport"),
+		TEXT("Logs the pieces replicated per distance tier and the estimated building bytes of every connection."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+			{
+				if (const UBuildingSubsystem* BuildingSubsystem = World ? World->GetSubsystem<UBuildingSubsystem>() : nullptr)
+				{
+					BuildingSubsystem->LogNetReport();
+				}
+			}));
+
+	// Rough wire size of an impact update: the cell, the array size and per piece a net GUID, a quantized vector and four bytes.
+	static int32 EstimateImpactUpdateBytes(const FBuildingImpactUpdate& Update)
+	{
+		return 10 + Update.Pieces.Num() * 14;
+	}
+
+	static bool bCompoundBodies = true;
+	FAutoConsoleVariableRef CVar_CompoundBodies(TEXT("Hope.Building.CompoundBodies"), bCompoundBodies,
+		TEXT("Fold the collision of settled pieces into one static body per cell. Only affects pieces spawned afterwards."), ECVF_Default);
+
+	static float CompoundSettleTime = 2.0f;
+	FAutoConsoleVariableRef CVar_CompoundSettleTime(TEXT("Hope.Building.CompoundSettleTime"), CompoundSettleTime,
+		TEXT("Seconds a cell has to go without new pieces before they are folded into its compound body."), ECVF_Default);
+
+	static uint8 QuantizeFraction(float Fraction)
+	{
+		return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Fraction * 255.f), 0, 255));
+	}
+}
+
+void UBuildingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UBuildingSubsystem::OnPostLogin);
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(this, &UBuildingSubsystem::OnLogout);
+}
+
+void UBuildingSubsystem::Deinitialize()
+{
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+	Cells.Empty();
+	Connections.Empty();
+	PendingImpacts.Empty();
+	CompoundCells.Empty();
+	DirtyCompoundCells.Empty();
+
+	Super::Deinitialize();
+}
+
+void UBuildingSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Connections.Num() > 0)
+	{
+		UpdateStreamingConnections(DeltaTime);
+	}
+
+	if (DirtyCompoundCells.Num() > 0)
+	{
+		UpdateCompounds();
+	}
+
+	// The server ticks once per net tick, so impacts are flushed at the rate the net driver sends.
+	if (PendingImpacts.Num() > 0)
+	{
+		SendImpactUpdates();
+	}
+}
+
+TStatId UBuildingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBuildingSubsystem, STATGROUP_Tickables);
+}
+
+FIntPoint UBuildingSubsystem::GetCellForLocation(const FVector& Location)
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / HopeBuilding::CellSize), FMath::FloorToInt(Location.Y / HopeBuilding::CellSize));
+}
+
+float UBuildingSubsystem::GetCellSize()
+{
+	return HopeBuilding::CellSize;
+}
+
+float UBuildingSubsystem::GetFarDistance()
+{
+	return HopeBuilding::FarDistance;
+}
+
+void UBuildingSubsystem::GetConnectedPieces(ABuildableBase* Piece, TArray<ABuildableBase*>& OutPieces) const
+{
+	OutPieces.Reset();
+	if (!Piece)
+	{
+		return;
+	}
+
+	// The base mesh keeps its bounds while it is folded into a compound, snap boxes would reach past the piece.
+	TMap<const ABuildableBase*, FBox> Bounds;
+	auto GetBounds = [&Bounds](const ABuildableBase* Buildable) -> const FBox&
+	{
+		if (const FBox* Box = Bounds.Find(Buildable))
+		{
+			return *Box;
+		}
+		return Bounds.Add(Buildable, Buildable->BaseMeshComponent->Bounds.GetBox());
+	};
+
+	// Breadth first over the cells around every piece found so far. A touching piece can be registered in a neighbouring cell.
+	TSet<const ABuildableBase*> Visited;
+	Visited.Add(Piece);
+	OutPieces.Add(Piece);
+	for (int32 Index = 0; Index < OutPieces.Num(); Index++)
+	{
+		const FBox Box = GetBounds(OutPieces[Index]).ExpandBy(HopeBuilding::ConnectionTolerance);
+		const FIntPoint MinCell = GetCellForLocation(Box.Min) - FIntPoint(1, 1);
+		const FIntPoint MaxCell = GetCellForLocation(Box.Max) + FIntPoint(1, 1);
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				const FBuildingCell* Cell = Cells.Find(FIntPoint(X, Y));
+				if (!Cell)
+				{
+					continue;
+				}
+				for (const TWeakObjectPtr<ABuildableBase>& Other : Cell->Pieces)
+				{
+					ABuildableBase* OtherPiece = Other.Get();
+					if (OtherPiece && !Visited.Contains(OtherPiece) && Box.Intersect(GetBounds(OtherPiece)))
+					{
+						Visited.Add(OtherPiece);
+						OutPieces.Add(OtherPiece);
+					}
+				}
+			}
+		}
+	}
+}
+
+EBuildingRelevancyTier UBuildingSubsystem::GetRelevancyTier(const FVector& ViewLocation, const FVector& PieceLocation)
+{
+	const double DistanceSquared = FVector::DistSquared(ViewLocation, PieceLocation);
+	if (DistanceSquared <= FMath::Square(HopeBuilding::NearDistance))
+	{
+		return EBuildingRelevancyTier::Near;
+	}
+	if (DistanceSquared <= FMath::Square(HopeBuilding::MidDistance))
+	{
+		return EBuildingRelevancyTier::Mid;
+	}
+	if (DistanceSquared <= FMath::Square(HopeBuilding::FarDistance))
+	{
+		return EBuildingRelevancyTier::Far;
+	}
+	return EBuildingRelevancyTier::Culled;
+}
+
+EBuildingRelevancyTier UBuildingSubsystem::GetFurthestTier(EBuildingType BuildingType)
+{
+	switch (BuildingType)
+	{
+	case EBuildingType::EBT_Foundation:
+		return EBuildingRelevancyTier::Far;
+	case EBuildingType::EBT_Door:
+	case EBuildingType::EBT_Window:
+		return EBuildingRelevancyTier::Near;
+	default:
+		return EBuildingRelevancyTier::Mid;
+	}
+}
+
+void UBuildingSubsystem::RegisterBuildable(ABuildableBase* Buildable)
+{
+	check(Buildable);
+	HOPE_BUILDING_SCOPE(Register);
+
+	if (Buildable->PieceID == 0)
+	{
+		Buildable->PieceID = ++LastPieceID;
+	}
+	else
+	{
+		LastPieceID = FMath::Max(LastPieceID, Buildable->PieceID);
+	}
+
+	Buildable->StreamingCell = GetCellForLocation(Buildable->GetActorLocation());
+
+	FBuildingCell* Cell = Cells.Find(Buildable->StreamingCell);
+	if (!Cell)
+	{
+		Cell = &Cells.Add(Buildable->StreamingCell);
+
+		// A brand new cell has to be queued for everyone who is still streaming.
+		for (TPair<const AActor*, FBuildingStreamingConnection>& Pair : Connections)
+		{
+			FBuildingStreamingConnection& Connection = Pair.Value;
+			if (Connection.bHasQueue && !Connection.ReleasedCells.Contains(Buildable->StreamingCell))
+			{
+				Connection.PendingCells.Add(Buildable->StreamingCell);
+				Connection.LastSortTime = 0.0;
+			}
+		}
+	}
+	Cell->Pieces.Add(Buildable);
+
+	OnBuildableRegistered.Broadcast(Buildable);
+}
+
+void UBuildingSubsystem::UnregisterBuildable(ABuildableBase* Buildable)
+{
+	check(Buildable);
+
+	if (FBuildingCell* Cell = Cells.Find(Buildable->StreamingCell))
+	{
+		Cell->Pieces.RemoveSingleSwap(Buildable);
+		if (Cell->Pieces.Num() == 0)
+		{
+			Cells.Remove(Buildable->StreamingCell);
+		}
+	}
+
+	OnBuildableUnregistered.Broadcast(Buildable);
+}
+
+bool UBuildingSubsystem::IsCellReleasedFor(const AActor* Viewer, const FIntPoint& Cell) const
+{
+	const FBuildingStreamingConnection* Connection = Connections.Find(Viewer);
+	if (!Connection)
+	{
+		return true;
+	}
+	return Connection->ReleasedCells.Contains(Cell);
+}
+
+void UBuildingSubsystem::OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	if (!NewPlayer || NewPlayer->GetWorld() != GetWorld() || NewPlayer->IsLocalController())
+	{
+		return;
+	}
+
+	FBuildingStreamingConnection& Connection = Connections.Add(NewPlayer);
+	Connection.PlayerController = NewPlayer;
+	Connection.JoinTime = GetWorld()->GetRealTimeSeconds();
+}
+
+void UBuildingSubsystem::OnLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	Connections.Remove(Exiting);
+}
+
+void UBuildingSubsystem::UpdateStreamingConnections(float DeltaTime)
+{
+	const double Now = GetWorld()->GetRealTimeSeconds();
+
+	for (auto It = Connections.CreateIterator(); It; ++It)
+	{
+		FBuildingStreamingConnection& Connection = It.Value();
+		if (!Connection.PlayerController.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		if (Connection.bHasQueue && Connection.PendingCells.Num() == 0)
+		{
+			continue;
+		}
+
+		// Wait for the pawn so the first cells sent are the ones around it.
+		const APawn* Pawn = Connection.PlayerController->GetPawn();
+		if (!Pawn)
+		{
+			continue;
+		}
+		const FVector ViewLocation = Pawn->GetActorLocation();
+
+		if (!Connection.bHasQueue)
+		{
+			Cells.GenerateKeyArray(Connection.PendingCells);
+			Connection.bHasQueue = true;
+			Connection.LastSortTime = 0.0;
+		}
+		if (Now - Connection.LastSortTime >= HopeBuilding::ResortInterval)
+		{
+			SortPendingCells(Connection, ViewLocation);
+			Connection.LastSortTime = Now;
+		}
+
+		// The allowance is capped at one second worth of budget so an idle connection does not burst later.
+		Connection.ByteAllowance = FMath::Min(Connection.ByteAllowance + HopeBuilding::StreamBytesPerSecond * DeltaTime,
+			HopeBuilding::StreamBytesPerSecond);
+
+		// Cells bigger than the allowance are still released and paid back over the next frames.
+		while (Connection.ByteAllowance > 0.f && Connection.PendingCells.Num() > 0)
+		{
+			const FIntPoint Cell = Connection.PendingCells.Pop(EAllowShrinking::No);
+			Connection.ByteAllowance -= GetCellStreamingCost(Cell);
+			Connection.ReleasedCells.Add(Cell);
+		}
+
+		CheckPlayable(Connection, ViewLocation);
+	}
+}
+
+void UBuildingSubsystem::SortPendingCells(FBuildingStreamingConnection& Connection, const FVector& ViewLocation) const
+{
+	const FVector2D ViewLocation2D(ViewLocation);
+	Connection.PendingCells.Sort([&ViewLocation2D](const FIntPoint& A, const FIntPoint& B)
+		{
+			const FVector2D CenterA = (FVector2D(A) + 0.5) * HopeBuilding::CellSize;
+			const FVector2D CenterB = (FVector2D(B) + 0.5) * HopeBuilding::CellSize;
+			return FVector2D::DistSquared(CenterA, ViewLocation2D) > FVector2D::DistSquared(CenterB, ViewLocation2D);
+		});
+}
+
+float UBuildingSubsystem::GetCellStreamingCost(const FIntPoint& Cell) const
+{
+	const FBuildingCell* FoundCell = Cells.Find(Cell);
+	return FoundCell ? FoundCell->Pieces.Num() * HopeBuilding::StreamBytesPerPiece : 0.f;
+}
+
+void UBuildingSubsystem::CheckPlayable(FBuildingStreamingConnection& Connection, const FVector& ViewLocation)
+{
+	if (Connection.bIsPlayable)
+	{
+		return;
+	}
+
+	// Pending cells are sorted far to near, so only the last one has to be checked.
+	if (Connection.PendingCells.Num() > 0)
+	{
+		const FVector2D NearestCenter = (FVector2D(Connection.PendingCells.Last()) + 0.5) * HopeBuilding::CellSize;
+		if (FVector2D::Distance(NearestCenter, FVector2D(ViewLocation)) <= HopeBuilding::PlayableRadius)
+		{
+			return;
+		}
+	}
+
+	Connection.bIsPlayable = true;
+	const double TimeToPlayable = GetWorld()->GetRealTimeSeconds() - Connection.JoinTime;
+	UE_LOG(LogHopeBuilding, Display, TEXT("TimeToPlayable: %s became playable after %.3f s (%d cells released, %d pending)"),
+		*GetNameSafe(Connection.PlayerController.Get()), TimeToPlayable, Connection.ReleasedCells.Num(), Connection.PendingCells.Num());
+}
+
+void UBuildingSubsystem::AddToCompound(ABuildableBase* Buildable)
+{
+	check(Buildable);
+	if (!HopeBuilding::bCompoundBodies)
+	{
+		return;
+	}
+
+	// Clients do not know the streaming cell, so the cell is taken from the location on every machine.
+	const FIntPoint Cell = GetCellForLocation(Buildable->GetActorLocation());
+	FBuildingCompoundCell& CompoundCell = CompoundCells.FindOrAdd(Cell);
+	CompoundCell.Pieces.Add(Buildable);
+	CompoundCell.LastEditTime = GetWorld()->GetTimeSeconds();
+	DirtyCompoundCells.Add(Cell);
+}
+
+void UBuildingSubsystem::RemoveFromCompound(ABuildableBase* Buildable)
+{
+	check(Buildable);
+
+	const FIntPoint Cell = GetCellForLocation(Buildable->GetActorLocation());
+	FBuildingCompoundCell* CompoundCell = CompoundCells.Find(Cell);
+	if (!CompoundCell || CompoundCell->Pieces.RemoveSingleSwap(Buildable) == 0)
+	{
+		return;
+	}
+
+	ABuildingCompoundActor* CompoundActor = CompoundCell->Actor.Get();
+	if (CompoundCell->Pieces.Num() == 0)
+	{
+		if (CompoundActor)
+		{
+			CompoundActor->Destroy();
+		}
+		CompoundCells.Remove(Cell);
+		DirtyCompoundCells.Remove(Cell);
+	}
+	else if (CompoundActor && CompoundActor->GetCompoundComponent()->ContainsPiece(Buildable) && !GetWorld()->bIsTearingDown)
+	{
+		// A destroyed piece must not leave invisible collision behind until the cell settles again.
+		RebuildCompound(Cell, *CompoundCell);
+	}
+}
+
+void UBuildingSubsystem::MarkCompoundDirty(ABuildableBase* Buildable)
+{
+	check(Buildable);
+
+	// The edit time is left alone, an in place change does not need the cell to settle first.
+	const FIntPoint Cell = GetCellForLocation(Buildable->GetActorLocation());
+	if (CompoundCells.Contains(Cell))
+	{
+		DirtyCompoundCells.Add(Cell);
+	}
+}
+
+void UBuildingSubsystem::UpdateCompounds()
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (auto It = DirtyCompoundCells.CreateIterator(); It; ++It)
+	{
+		FBuildingCompoundCell* CompoundCell = CompoundCells.Find(*It);
+		if (CompoundCell && Now - CompoundCell->LastEditTime < HopeBuilding::CompoundSettleTime)
+		{
+			continue;
+		}
+		if (CompoundCell)
+		{
+			RebuildCompound(*It, *CompoundCell);
+		}
+		It.RemoveCurrent();
+	}
+}
+
+void UBuildingSubsystem::RebuildCompound(const FIntPoint& Cell, FBuildingCompoundCell& CompoundCell)
+{
+	TArray<ABuildableBase*> Pieces;
+	Pieces.Reserve(CompoundCell.Pieces.Num());
+	for (const TWeakObjectPtr<ABuildableBase>& Piece : CompoundCell.Pieces)
+	{
+		if (Piece.IsValid())
+		{
+			Pieces.Add(Piece.Get());
+		}
+	}
+
+	ABuildingCompoundActor* CompoundActor = CompoundCell.Actor.Get();
+	if (!CompoundActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		const FVector CellOrigin(FVector2D(Cell) * HopeBuilding::CellSize, 0.f);
+		CompoundActor = GetWorld()->SpawnActor<ABuildingCompoundActor>(CellOrigin, FRotator::ZeroRotator, SpawnParams);
+		CompoundCell.Actor = CompoundActor;
+	}
+	if (CompoundActor)
+	{
+		CompoundActor->GetCompoundComponent()->Rebuild(Pieces);
+	}
+}
+
+void UBuildingSubsystem::AddPieceImpact(ABuildableBase* Piece, float DamageTaken, const FVector& ImpactLocation, EBuildingImpactFlags Flags)
+{
+	check(Piece);
+
+	TArray<FBuildingPendingImpact>& CellImpacts = PendingImpacts.FindOrAdd(Piece->StreamingCell);
+	FBuildingPendingImpact* PendingImpact = CellImpacts.FindByPredicate([Piece](const FBuildingPendingImpact& Impact) { return Impact.Piece == Piece; });
+	if (!PendingImpact)
+	{
+		PendingImpact = &CellImpacts.AddDefaulted_GetRef();
+		PendingImpact->Piece = Piece;
+	}
+
+	const float MaxHealth = FMath::Max(Piece->MaxHealth, 1.f);
+	PendingImpact->ImpactLocation = ImpactLocation;
+	PendingImpact->DamageTaken += DamageTaken / MaxHealth;
+	PendingImpact->Health = 1.f - Piece->Damage / MaxHealth;
+	PendingImpact->NumHits += DamageTaken > 0.f ? 1 : 0;
+	PendingImpact->Flags |= Flags;
+}
+
+void UBuildingSubsystem::SendImpactUpdates()
+{
+	HOPE_BUILDING_SCOPE(ImpactUpdates);
+
+	for (const TPair<FIntPoint, TArray<FBuildingPendingImpact>>& Pair : PendingImpacts)
+	{
+		FBuildingImpactUpdate Update;
+		Update.Cell = Pair.Key;
+		Update.Pieces.Reserve(Pair.Value.Num());
+		for (const FBuildingPendingImpact& PendingImpact : Pair.Value)
+		{
+			// Destroyed pieces go out as a null reference, the flag and location are enough for the effects.
+			FBuildingPieceImpact& Impact = Update.Pieces.AddDefaulted_GetRef();
+			Impact.Piece = PendingImpact.Piece.Get();
+			Impact.ImpactLocation = PendingImpact.ImpactLocation;
+			Impact.DamageTaken = PendingImpact.DamageTaken > 0.f ? FMath::Max(HopeBuilding::QuantizeFraction(PendingImpact.DamageTaken), uint8(1)) : 0;
+			Impact.Health = HopeBuilding::QuantizeFraction(PendingImpact.Health);
+			Impact.NumHits = static_cast<uint8>(FMath::Min(PendingImpact.NumHits, 255));
+			Impact.Flags = static_cast<uint8>(PendingImpact.Flags);
+		}
+
+		const FVector CellCenter((FVector2D(Pair.Key) + 0.5) * HopeBuilding::CellSize, 0.f);
+		bool bReceivedLocally = false;
+		for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			AHopePlayerController* PlayerController = Cast<AHopePlayerController>(It->Get());
+			const AActor* ViewTarget = PlayerController ? PlayerController->GetViewTarget() : nullptr;
+			// Impacts are per piece detail, only near viewers get them. Height is ignored, as for the streaming cells.
+			if (!ViewTarget || !IsCellReleasedFor(PlayerController, Pair.Key)
+				|| GetRelevancyTier(FVector(FVector2D(ViewTarget->GetActorLocation()), 0.f), CellCenter) != EBuildingRelevancyTier::Near)
+			{
+				continue;
+			}
+
+			if (!PlayerController->IsLocalController())
+			{
+				PlayerController->ClientReceiveBuildingImpacts(Update);
+				HOPE_BUILDING_COUNT(ImpactUpdatesSent, 1);
+				if (FBuildingStreamingConnection* Connection = Connections.Find(PlayerController))
+				{
+					const int32 UpdateBytes = HopeBuilding::EstimateImpactUpdateBytes(Update);
+					Connection->ImpactBytesSent += UpdateBytes;
+					HOPE_BUILDING_COUNT(ImpactUpdateBytes, UpdateBytes);
+				}
+			}
+			else if (!bReceivedLocally)
+			{
+				ReceiveImpactUpdate(Update);
+				bReceivedLocally = true;
+			}
+		}
+	}
+	PendingImpacts.Reset();
+}
+
+void UBuildingSubsystem::ReceiveImpactUpdate(const FBuildingImpactUpdate& Update)
+{
+	for (const FBuildingPieceImpact& Impact : Update.Pieces)
+	{
+		if (Impact.Piece)
+		{
+			Impact.Piece->ReceiveImpact(Impact);
+		}
+	}
+	OnBuildingImpacts.Broadcast(Update);
+}
+
+void UBuildingSubsystem::LogNetReport() const
+{
+	UE_LOG(LogHopeBuilding, Display, TEXT("Building net report, %d connections (piece bytes estimated at %.0f per relevant piece)"),
+		Connections.Num(), HopeBuilding::StreamBytesPerPiece);
+
+	for (const TPair<const AActor*, FBuildingStreamingConnection>& Pair : Connections)
+	{
+		const FBuildingStreamingConnection& Connection = Pair.Value;
+		const APlayerController* PlayerController = Connection.PlayerController.Get();
+		const AActor* ViewTarget = PlayerController ? PlayerController->GetViewTarget() : nullptr;
+		if (!ViewTarget)
+		{
+			continue;
+		}
+
+		int32 NumPiecesPerTier[4] = {};
+		int32 NumRelevantPieces = 0;
+		for (const FIntPoint& Cell : Connection.ReleasedCells)
+		{
+			const FBuildingCell* FoundCell = Cells.Find(Cell);
+			if (!FoundCell)
+			{
+				continue;
+			}
+			for (const TWeakObjectPtr<ABuildableBase>& Piece : FoundCell->Pieces)
+			{
+				if (const ABuildableBase* Buildable = Piece.Get())
+				{
+					const EBuildingRelevancyTier Tier = GetRelevancyTier(ViewTarget->GetActorLocation(), Buildable->GetActorLocation());
+					NumPiecesPerTier[(int32)Tier]++;
+					NumRelevantPieces += Tier <= GetFurthestTier(Buildable->BuildingType) ? 1 : 0;
+				}
+			}
+		}
+
+		UE_LOG(LogHopeBuilding, Display, TEXT("  %s: near %d, mid %d, far %d, culled %d pieces. %d relevant, ~%.0f KB pieces, %.1f KB impact updates, %d cells pending"),
+			*GetNameSafe(PlayerController), NumPiecesPerTier[0], NumPiecesPerTier[1], NumPiecesPerTier[2], NumPiecesPerTier[3],
+			NumRelevantPieces, NumRelevantPieces * HopeBuilding::StreamBytesPerPiece / 1024.f, Connection.ImpactBytesSent / 1024.f,
+			Connection.PendingCells.Num());
+	}
+}
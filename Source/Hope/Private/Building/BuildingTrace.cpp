@@ -0,0 +1,34 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Building/BuildingTrace.h"
+
+#if HOPE_BUILDING_TRACE
+
+UE_TRACE_CHANNEL_DEFINE(HopeBuildingChannel);
+
+DEFINE_STAT(STAT_HopeBuilding_GhostUpdate);
+DEFINE_STAT(STAT_HopeBuilding_CameraTrace);
+DEFINE_STAT(STAT_HopeBuilding_DetectBuildBoxes);
+DEFINE_STAT(STAT_HopeBuilding_Collision);
+DEFINE_STAT(STAT_HopeBuilding_Support);
+DEFINE_STAT(STAT_HopeBuilding_FoundationGround);
+DEFINE_STAT(STAT_HopeBuilding_GhostMaterial);
+DEFINE_STAT(STAT_HopeBuilding_GhostMesh);
+DEFINE_STAT(STAT_HopeBuilding_Spawn);
+DEFINE_STAT(STAT_HopeBuilding_Register);
+DEFINE_STAT(STAT_HopeBuilding_ImpactUpdates);
+DEFINE_STAT(STAT_HopeBuilding_CompoundRebuild);
+DEFINE_STAT(STAT_HopeBuilding_DeviceSolve);
+
+DEFINE_STAT(STAT_HopeBuilding_Traces);
+DEFINE_STAT(STAT_HopeBuilding_Overlaps);
+DEFINE_STAT(STAT_HopeBuilding_SnapCandidates);
+DEFINE_STAT(STAT_HopeBuilding_MaterialSwaps);
+DEFINE_STAT(STAT_HopeBuilding_Spawns);
+DEFINE_STAT(STAT_HopeBuilding_ImpactUpdatesSent);
+DEFINE_STAT(STAT_HopeBuilding_ImpactUpdateBytes);
+DEFINE_STAT(STAT_HopeBuilding_DeviceNodesSolved);
+DEFINE_STAT(STAT_HopeBuilding_DeviceOutputsFlipped);
+
+#endif // HOPE_BUILDING_TRACE
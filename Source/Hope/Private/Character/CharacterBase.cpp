@@ -7,9 +7,12 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "HopeInterfaces/ALSInterface.h"
+#include "HopeInterfaces/HopeInterfaceDispatch.h"
+#include "ALS/CharacterAnimInstance.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "ALS/HopeCharacterMovementComponent.h"
+#include "ALS/CharacterSignificanceSubsystem.h"
 
 static FName NAME_HopeCharacterCollisionProfile_Capsule(TEXT("HopePawnCapsule"));
 static FName NAME_HopeCharacterCollisionProfile_Mesh(TEXT("HopePawnMesh"));
@@ -35,6 +38,8 @@ ACharacterBase::ACharacterBase(const FObjectInitializer& ObjectInitializer)
 	MeshComp->SetRelativeRotation(FRotator(0.0f, -90.0f, 0.0f));  // Rotate mesh to be X forward since it is exported as Y forward.
 	MeshComp->SetCollisionProfileName(NAME_HopeCharacterCollisionProfile_Mesh);
 	MeshComp->SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Ignore);
+	// Needed for "UCharacterSignificanceSubsystem" to control the update rate of the mesh.
+	MeshComp->bEnableUpdateRateOptimizations = true;
 
 	// Movement
 	UHopeCharacterMovementComponent* HopeMoveComp = CastChecked<UHopeCharacterMovementComponent>(GetCharacterMovement());
@@ -178,7 +183,7 @@ void ACharacterBase::UpdateCurrentGait_Server_Implementation(EGait Gait)
 void ACharacterBase::UpdateCurrentGait_Client_Implementation(EGait Gait)
 {
 	CurrentGait = Gait;
-	IALSInterface::Execute_RecieveCurrentGait(GetMesh()->GetAnimInstance(), CurrentGait);
+	SendCurrentGaitToAnimInstance();
 
 	switch (CurrentGait)
 	{
@@ -212,6 +217,26 @@ void ACharacterBase::UpdateCurrentGait_Client_Implementation(EGait Gait)
 	}
 }
 
+void ACharacterBase::SendCurrentGaitToAnimInstance()
+{
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (GaitAnimInstance != AnimInstance)
+	{
+		GaitAnimInstance = AnimInstance;
+		bIsGaitAnimInstanceNative = AnimInstance && AnimInstance->IsA<UCharacterAnimInstance>()
+			&& HopeInterfaceDispatch::IsNative(AnimInstance, GET_FUNCTION_NAME_CHECKED(IALSInterface, RecieveCurrentGait));
+	}
+
+	if (bIsGaitAnimInstanceNative)
+	{
+		static_cast<UCharacterAnimInstance*>(AnimInstance)->RecieveCurrentGait_Implementation(CurrentGait);
+	}
+	else if (AnimInstance && AnimInstance->Implements<UALSInterface>())
+	{
+		IALSInterface::Execute_RecieveCurrentGait(AnimInstance, CurrentGait);
+	}
+}
+
 void ACharacterBase::SetGaitSettings(FGaitSettings* InSettings)
 {
 	UCharacterMovementComponent* CMC = GetCharacterMovement();
@@ -284,6 +309,21 @@ void ACharacterBase::BeginPlay()
 	Super::BeginPlay();
 
 	UpdateCurrentGait_Server(EGait::EG_Jogging);
+
+	if (UCharacterSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->RegisterCharacter(this);
+	}
+}
+
+void ACharacterBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCharacterSignificanceSubsystem* SignificanceSubsystem = GetWorld()->GetSubsystem<UCharacterSignificanceSubsystem>())
+	{
+		SignificanceSubsystem->UnregisterCharacter(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ACharacterBase::InitializeCharacterAbilitySystem()
@@ -18,6 +18,9 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Building/BuildingComponent.h"
+#include "Building/BuildingCompound.h"
+#include "Debug/HopeDebugDraw.h"
+#include "InputControl/HopeViewQuerySubsystem.h"
 
 APlayerCharacter::APlayerCharacter()
 {
@@ -59,20 +62,32 @@ FHitResult APlayerCharacter::LineTraceFromCamera_Implementation(float StartLocat
 {
 	FVector Start = PlayerCamera->GetComponentLocation() + PlayerCamera->GetForwardVector() * StartLocationMultiplier;
 	FVector End = PlayerCamera->GetComponentLocation() + PlayerCamera->GetForwardVector() * EndLocationMultiplier;
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(this);
 	FHitResult HitResult;
+	bool bHit = false;
 
-	UKismetSystemLibrary::LineTraceSingle(PlayerCamera,
-		Start,
-		End,
-		ETraceTypeQuery::TraceTypeQuery1,
-		false,
-		ActorsToIgnore,
-		EDrawDebugTrace::None,
-		HitResult,
-		true,
-		FLinearColor::Gray);
+	// The local player reads the shared view ray, remote players are traced on the server.
+	if (UHopeViewQuerySubsystem* ViewQuery = UHopeViewQuerySubsystem::Get(this))
+	{
+		bHit = ViewQuery->GetViewHit(UEngineTypes::ConvertToCollisionChannel(ETraceTypeQuery::TraceTypeQuery1),
+			StartLocationMultiplier, EndLocationMultiplier, HitResult);
+	}
+	else
+	{
+		TArray<AActor*> ActorsToIgnore;
+		ActorsToIgnore.Add(this);
+		bHit = UKismetSystemLibrary::LineTraceSingle(PlayerCamera,
+			Start,
+			End,
+			ETraceTypeQuery::TraceTypeQuery1,
+			false,
+			ActorsToIgnore,
+			EDrawDebugTrace::None,
+			HitResult,
+			true,
+			FLinearColor::Gray);
+	}
+	UBuildingCompoundComponent::ResolveHit(HitResult);
+	HOPE_DEBUG_LINE(Interaction, this, Start, End, bHit ? &HitResult : nullptr);
 	return HitResult;
 }
 
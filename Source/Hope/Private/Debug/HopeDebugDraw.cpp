@@ -0,0 +1,176 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Debug/HopeDebugDraw.h"
+
+#if HOPE_DEBUG_DRAW
+
+#include "DrawDebugHelpers.h"
+#include "Engine/HitResult.h"
+#include "Engine/World.h"
+#include "Hope.h"
+
+namespace HopeDebugDraw
+{
+	int32 Modes[(int32)EHopeDebugCategory::Num] = {};
+
+	FAutoConsoleVariableRef CVar_Building(TEXT("Hope.Debug.Building"), Modes[(int32)EHopeDebugCategory::Building],
+		TEXT("Building ghost support, collision and foundation ground queries. 1 draws, 2 records, 3 both."), ECVF_Cheat);
+
+	FAutoConsoleVariableRef CVar_Interaction(TEXT("Hope.Debug.Interaction"), Modes[(int32)EHopeDebugCategory::Interaction],
+		TEXT("Interaction traces from the player camera. 1 draws, 2 records, 3 both."), ECVF_Cheat);
+
+	FAutoConsoleVariableRef CVar_GroundInfo(TEXT("Hope.Debug.GroundInfo"), Modes[(int32)EHopeDebugCategory::GroundInfo],
+		TEXT("Ground distance traces of the character movement component. 1 draws, 2 records, 3 both."), ECVF_Cheat);
+
+	FAutoConsoleVariableRef CVar_CameraTrace(TEXT("Hope.Debug.CameraTrace"), Modes[(int32)EHopeDebugCategory::CameraTrace],
+		TEXT("Camera traces placing the building ghost. 1 draws, 2 records, 3 both."), ECVF_Cheat);
+
+	static int32 QueryHistorySize = 256;
+	FAutoConsoleVariableRef CVar_QueryHistorySize(TEXT("Hope.Debug.QueryHistorySize"), QueryHistorySize,
+		TEXT("Number of recorded query shapes kept for Hope.Debug.DumpQueries."), ECVF_Cheat);
+
+	static const TCHAR* CategoryNames[] = { TEXT("Building"), TEXT("Interaction"), TEXT("GroundInfo"), TEXT("CameraTrace") };
+	static_assert(UE_ARRAY_COUNT(CategoryNames) == (int32)EHopeDebugCategory::Num, "Every category needs a name");
+
+	struct FQueryShape
+	{
+		double Time = 0.0;
+		uint64 Frame = 0;
+		EHopeDebugCategory Category = EHopeDebugCategory::Building;
+		bool bIsBox = false;
+		bool bHit = false;
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		FVector ImpactPoint = FVector::ZeroVector;
+		FVector Extent = FVector::ZeroVector;
+		FQuat Rotation = FQuat::Identity;
+	};
+
+	// Ring of the last "QueryHistorySize" shapes. Queries may come from worker threads, so it is locked.
+	static FCriticalSection HistoryLock;
+	static TArray<FQueryShape> History;
+	static int32 HistoryHead = 0;
+
+	static void Record(const FQueryShape& Shape)
+	{
+		FScopeLock Lock(&HistoryLock);
+		const int32 Capacity = FMath::Max(QueryHistorySize, 1);
+		if (History.Num() > Capacity || HistoryHead >= Capacity)
+		{
+			// The history size was changed, start over.
+			History.Reset();
+			HistoryHead = 0;
+		}
+		if (History.Num() < Capacity)
+		{
+			History.Add(Shape);
+		}
+		else
+		{
+			History[HistoryHead] = Shape;
+		}
+		HistoryHead = (HistoryHead + 1) % Capacity;
+	}
+
+	static void Draw(const UWorld* World, const FQueryShape& Shape, float LifeTime)
+	{
+		const bool bPersistent = LifeTime > 0.f;
+		if (Shape.bIsBox)
+		{
+			DrawDebugBox(World, Shape.Start, Shape.Extent, Shape.Rotation, Shape.bHit ? FColor::Red : FColor::Green, bPersistent, LifeTime);
+			if (!Shape.Start.Equals(Shape.End))
+			{
+				DrawDebugBox(World, Shape.End, Shape.Extent, Shape.Rotation, FColor::Green, bPersistent, LifeTime);
+				DrawDebugLine(World, Shape.Start, Shape.End, FColor::Green, bPersistent, LifeTime);
+			}
+		}
+		else
+		{
+			DrawDebugLine(World, Shape.Start, Shape.ImpactPoint, FColor::Red, bPersistent, LifeTime);
+			DrawDebugLine(World, Shape.ImpactPoint, Shape.End, FColor::Green, bPersistent, LifeTime);
+		}
+		if (Shape.bHit)
+		{
+			DrawDebugPoint(World, Shape.ImpactPoint, 10.f, FColor::Red, bPersistent, LifeTime);
+		}
+	}
+
+	static void Submit(EHopeDebugCategory Category, const UObject* WorldContext, FQueryShape& Shape, const FHitResult* Hit)
+	{
+		Shape.Category = Category;
+		Shape.Time = FPlatformTime::Seconds();
+		Shape.Frame = GFrameCounter;
+		Shape.bHit = Hit && Hit->bBlockingHit;
+		Shape.ImpactPoint = Shape.bHit ? FVector(Hit->ImpactPoint) : Shape.End;
+
+		const int32 Mode = Modes[(int32)Category];
+		if (Mode & Mode_Record)
+		{
+			Record(Shape);
+		}
+
+		// The line batcher is not thread safe.
+		const UWorld* World = WorldContext ? WorldContext->GetWorld() : nullptr;
+		if ((Mode & Mode_Draw) && World && IsInGameThread())
+		{
+			Draw(World, Shape, 0.f);
+		}
+	}
+
+	void Line(EHopeDebugCategory Category, const UObject* WorldContext, const FVector& Start, const FVector& End, const FHitResult* Hit)
+	{
+		FQueryShape Shape;
+		Shape.Start = Start;
+		Shape.End = End;
+		Submit(Category, WorldContext, Shape, Hit);
+	}
+
+	void Box(EHopeDebugCategory Category, const UObject* WorldContext, const FVector& Start, const FVector& End,
+		const FVector& Extent, const FQuat& Rotation, const FHitResult* Hit)
+	{
+		FQueryShape Shape;
+		Shape.bIsBox = true;
+		Shape.Start = Start;
+		Shape.End = End;
+		Shape.Extent = Extent;
+		Shape.Rotation = Rotation;
+		Submit(Category, WorldContext, Shape, Hit);
+	}
+
+	static void DumpQueries(const TArray<FString>& Args, UWorld* World)
+	{
+		const float LifeTime = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 10.f;
+
+		TArray<FQueryShape> Shapes;
+		{
+			FScopeLock Lock(&HistoryLock);
+			// Oldest first.
+			for (int32 Index = 0; Index < History.Num(); Index++)
+			{
+				Shapes.Add(History[(HistoryHead + Index) % History.Num()]);
+			}
+		}
+
+		UE_LOG(LogHopeDebug, Display, TEXT("%d recorded queries, oldest first"), Shapes.Num());
+		for (const FQueryShape& Shape : Shapes)
+		{
+			UE_LOG(LogHopeDebug, Display, TEXT("[%llu] %.4f %s %s Start=(%s) End=(%s)%s%s"),
+				Shape.Frame, Shape.Time, CategoryNames[(int32)Shape.Category], Shape.bIsBox ? TEXT("Box") : TEXT("Line"),
+				*Shape.Start.ToCompactString(), *Shape.End.ToCompactString(),
+				Shape.bIsBox ? *FString::Printf(TEXT(" Extent=(%s)"), *Shape.Extent.ToCompactString()) : TEXT(""),
+				Shape.bHit ? *FString::Printf(TEXT(" Hit=(%s)"), *Shape.ImpactPoint.ToCompactString()) : TEXT(""));
+
+			if (World && LifeTime > 0.f)
+			{
+				Draw(World, Shape, LifeTime);
+			}
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs DumpQueriesCommand(TEXT("Hope.Debug.DumpQueries"),
+		TEXT("Logs the recorded query history and draws it for the given number of seconds (10 by default)."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&DumpQueries));
+}
+
+#endif // HOPE_DEBUG_DRAW
@@ -0,0 +1,344 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Game/HopeWorldJournal.h"
+#include "Game/HopeWorldSaveSubsystem.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Hope.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Journal Entries Written"), STAT_HopeJournalEntriesWritten, STATGROUP_HopeSave);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Journal Bytes Written"), STAT_HopeJournalBytesWritten, STATGROUP_HopeSave);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Journal Overflow"), STAT_HopeJournalOverflow, STATGROUP_HopeSave);
+
+namespace HopeWorldJournal
+{
+	static int32 RingCapacity = 16384;
+	FAutoConsoleVariableRef CVar_RingCapacity(TEXT("Hope.Save.JournalRingCapacity"), RingCapacity,
+		TEXT("Number of mutations the journal ring buffer holds before the game thread spills into its overflow array."), ECVF_ReadOnly);
+
+	static float FlushIntervalMs = 50.0f;
+	FAutoConsoleVariableRef CVar_FlushIntervalMs(TEXT("Hope.Save.JournalFlushIntervalMs"), FlushIntervalMs,
+		TEXT("How often the journal writer drains the ring buffer and hands one batch to the file system."), ECVF_Default);
+
+	static uint32 ComputeCrc(const FHopeJournalEntry& Entry, const FString& ClassPath)
+	{
+		FHopeJournalEntry CrcEntry = Entry;
+		CrcEntry.Crc = 0;
+		uint32 Crc = FCrc::MemCrc32(&CrcEntry, sizeof(CrcEntry));
+		if (Entry.PayloadSize > 0)
+		{
+			const FTCHARToUTF8 Utf8ClassPath(*ClassPath);
+			Crc = FCrc::MemCrc32(Utf8ClassPath.Get(), Utf8ClassPath.Length(), Crc);
+		}
+		return Crc;
+	}
+
+	// Returns the numbers of the segment files next to "BaseFilePath", in ascending order.
+	static void FindSegments(const FString& BaseFilePath, TArray<uint32>& OutSegments)
+	{
+		TArray<FString> FileNames;
+		IFileManager::Get().FindFiles(FileNames, *(BaseFilePath + TEXT(".*") + FileExtension), true, false);
+
+		for (const FString& FileName : FileNames)
+		{
+			// <Slot>.<Segment>.hwj
+			const FString SegmentString = FPaths::GetExtension(FPaths::GetBaseFilename(FileName));
+			if (SegmentString.IsNumeric())
+			{
+				OutSegments.Add(static_cast<uint32>(FCString::Strtoui64(*SegmentString, nullptr, 10)));
+			}
+		}
+		OutSegments.Sort();
+	}
+}
+
+FHopeWorldJournal::FHopeWorldJournal(const FString& InBaseFilePath, uint32 FirstSegment)
+	: BaseFilePath(InBaseFilePath)
+	, Queue(FMath::Max(HopeWorldJournal::RingCapacity, 2))
+	, Segment(FirstSegment)
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+	Thread = FRunnableThread::Create(this, TEXT("HopeWorldJournal"), 0, TPri_BelowNormal);
+}
+
+FHopeWorldJournal::~FHopeWorldJournal()
+{
+	// Whatever is still in the overflow goes in before the writer does its last drain.
+	while (Overflow.Num() > 0 && Thread)
+	{
+		FlushOverflow();
+		WakeEvent->Trigger();
+		FPlatformProcess::Sleep(0.001f);
+	}
+
+	if (Thread)
+	{
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+void FHopeWorldJournal::Push(const FHopeJournalMutation& Mutation)
+{
+	if (Overflow.Num() > 0 || !Queue.Enqueue(Mutation))
+	{
+		Overflow.Add(Mutation);
+		INC_DWORD_STAT(STAT_HopeJournalOverflow);
+		WakeEvent->Trigger();
+	}
+}
+
+void FHopeWorldJournal::FlushOverflow()
+{
+	int32 NumMoved = 0;
+	while (NumMoved < Overflow.Num() && Queue.Enqueue(Overflow[NumMoved]))
+	{
+		NumMoved++;
+	}
+	Overflow.RemoveAt(0, NumMoved, EAllowShrinking::No);
+}
+
+FString FHopeWorldJournal::GetSegmentFilePath(const FString& BaseFilePath, uint32 Segment)
+{
+	return FString::Printf(TEXT("%s.%06u%s"), *BaseFilePath, Segment, HopeWorldJournal::FileExtension);
+}
+
+uint32 FHopeWorldJournal::FindLastSegment(const FString& BaseFilePath)
+{
+	TArray<uint32> Segments;
+	HopeWorldJournal::FindSegments(BaseFilePath, Segments);
+	return Segments.Num() > 0 ? Segments.Last() : 0;
+}
+
+void FHopeWorldJournal::ReadSegments(const FString& BaseFilePath, uint32 FirstSegment,
+	TFunctionRef<void(const FHopeJournalEntry& Entry, const FString& ClassPath)> Visitor)
+{
+	TArray<uint32> Segments;
+	HopeWorldJournal::FindSegments(BaseFilePath, Segments);
+	for (const uint32 ReadSegment : Segments)
+	{
+		if (ReadSegment < FirstSegment)
+		{
+			continue;
+		}
+
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *GetSegmentFilePath(BaseFilePath, ReadSegment), FILEREAD_Silent))
+		{
+			continue;
+		}
+
+		FHopeJournalSegmentHeader Header;
+		if (Data.Num() < sizeof(Header))
+		{
+			continue;
+		}
+		FMemory::Memcpy(&Header, Data.GetData(), sizeof(Header));
+		if (Header.Magic != HopeWorldJournal::Magic || Header.Version != HopeWorldJournal::CurrentVersion)
+		{
+			UE_LOG(LogHopeBuilding, Warning, TEXT("Skipping journal segment %u, unknown format"), ReadSegment);
+			continue;
+		}
+
+		int64 Offset = sizeof(Header);
+		while (Offset + int64(sizeof(FHopeJournalEntry)) <= Data.Num())
+		{
+			FHopeJournalEntry Entry;
+			FMemory::Memcpy(&Entry, Data.GetData() + Offset, sizeof(Entry));
+			Offset += sizeof(Entry);
+			if (Offset + Entry.PayloadSize > Data.Num())
+			{
+				break;
+			}
+
+			const FUTF8ToTCHAR Payload(reinterpret_cast<const ANSICHAR*>(Data.GetData() + Offset), Entry.PayloadSize);
+			const FString ClassPath(Payload.Length(), Payload.Get());
+			Offset += Entry.PayloadSize;
+
+			// Anything after a torn entry was never completely written.
+			if (Entry.Crc != HopeWorldJournal::ComputeCrc(Entry, ClassPath))
+			{
+				UE_LOG(LogHopeBuilding, Warning, TEXT("Journal segment %u ends with a torn entry at offset %lld"), ReadSegment, Offset);
+				break;
+			}
+			Visitor(Entry, ClassPath);
+		}
+	}
+}
+
+uint32 FHopeWorldJournal::Run()
+{
+	while (!bStopping)
+	{
+		WakeEvent->Wait(FMath::Max(FMath::RoundToInt(HopeWorldJournal::FlushIntervalMs), 1));
+		Drain();
+	}
+
+	Drain();
+	CloseSegment();
+	return 0;
+}
+
+void FHopeWorldJournal::Stop()
+{
+	bStopping = true;
+	WakeEvent->Trigger();
+}
+
+void FHopeWorldJournal::Drain()
+{
+	FHopeJournalMutation Mutation;
+	int32 NumEntries = 0;
+	while (Queue.Dequeue(Mutation))
+	{
+		switch (Mutation.Op)
+		{
+		case EHopeJournalOp::Rotate:
+			CloseSegment();
+			Segment = Mutation.Segment;
+			break;
+		case EHopeJournalOp::Truncate:
+			DeleteSegmentsBefore(Mutation.Segment);
+			break;
+		case EHopeJournalOp::DefineClass:
+		{
+			const uint16 ClassIndex = Mutation.Record.ClassIndex;
+			if (ClassPaths.Num() <= ClassIndex)
+			{
+				ClassPaths.SetNum(ClassIndex + 1);
+			}
+			ClassPaths[ClassIndex] = Mutation.ClassPath.ToString();
+
+			FHopeJournalEntry Entry;
+			Entry.Op = EHopeJournalOp::DefineClass;
+			Entry.Record.ClassIndex = ClassIndex;
+			WriteEntry(Entry, ClassPaths[ClassIndex]);
+			NumEntries++;
+			break;
+		}
+		case EHopeJournalOp::Connect:
+		case EHopeJournalOp::Disconnect:
+		{
+			FHopeJournalEntry Entry;
+			Entry.Op = Mutation.Op;
+			FMemory::Memcpy(&Entry.Record, &Mutation.Wire, sizeof(Mutation.Wire));
+			WriteEntry(Entry, FString());
+			NumEntries++;
+			break;
+		}
+		default:
+		{
+			FHopeJournalEntry Entry;
+			Entry.Op = Mutation.Op;
+			Entry.Record = Mutation.Record;
+			WriteEntry(Entry, FString());
+			NumEntries++;
+			break;
+		}
+		}
+	}
+
+	// One write and flush per batch. Handing the data to the OS is enough to survive the server process crashing.
+	if (!File)
+	{
+		Buffer.Reset();
+	}
+	else if (Buffer.Num() > 0)
+	{
+		File->Write(Buffer.GetData(), Buffer.Num());
+		File->Flush();
+		INC_DWORD_STAT_BY(STAT_HopeJournalEntriesWritten, NumEntries);
+		INC_DWORD_STAT_BY(STAT_HopeJournalBytesWritten, Buffer.Num());
+		Buffer.Reset();
+	}
+}
+
+void FHopeWorldJournal::WriteEntry(FHopeJournalEntry& Entry, const FString& ClassPath)
+{
+	if (!File)
+	{
+		OpenSegment(Segment);
+		if (!File)
+		{
+			return;
+		}
+	}
+
+	const FTCHARToUTF8 Utf8ClassPath(*ClassPath);
+	Entry.Sequence = NextSequence++;
+	Entry.PayloadSize = static_cast<uint16>(Utf8ClassPath.Length());
+	Entry.Crc = HopeWorldJournal::ComputeCrc(Entry, ClassPath);
+
+	Buffer.Append(reinterpret_cast<const uint8*>(&Entry), sizeof(Entry));
+	Buffer.Append(reinterpret_cast<const uint8*>(Utf8ClassPath.Get()), Entry.PayloadSize);
+}
+
+void FHopeWorldJournal::OpenSegment(uint32 NewSegment)
+{
+	Segment = NewSegment;
+	const FString FilePath = GetSegmentFilePath(BaseFilePath, Segment);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+	File = PlatformFile.OpenWrite(*FilePath, true, true);
+	if (!File)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Failed to open journal segment %s"), *FilePath);
+		return;
+	}
+
+	if (File->Size() == 0)
+	{
+		FHopeJournalSegmentHeader Header;
+		Header.Segment = Segment;
+		Buffer.Append(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+	}
+
+	// Classes go first, so the segment can be replayed without the ones before it.
+	for (int32 ClassIndex = 0; ClassIndex < ClassPaths.Num(); ClassIndex++)
+	{
+		if (!ClassPaths[ClassIndex].IsEmpty())
+		{
+			FHopeJournalEntry Entry;
+			Entry.Op = EHopeJournalOp::DefineClass;
+			Entry.Record.ClassIndex = ClassIndex;
+			WriteEntry(Entry, ClassPaths[ClassIndex]);
+		}
+	}
+}
+
+void FHopeWorldJournal::CloseSegment()
+{
+	if (File)
+	{
+		if (Buffer.Num() > 0)
+		{
+			File->Write(Buffer.GetData(), Buffer.Num());
+			Buffer.Reset();
+		}
+		File->Flush();
+		delete File;
+		File = nullptr;
+	}
+}
+
+void FHopeWorldJournal::DeleteSegmentsBefore(uint32 KeepSegment)
+{
+	TArray<uint32> Segments;
+	HopeWorldJournal::FindSegments(BaseFilePath, Segments);
+	for (const uint32 DeleteSegment : Segments)
+	{
+		if (DeleteSegment < KeepSegment && (DeleteSegment != Segment || !File))
+		{
+			IFileManager::Get().Delete(*GetSegmentFilePath(BaseFilePath, DeleteSegment), false, false, true);
+		}
+	}
+}
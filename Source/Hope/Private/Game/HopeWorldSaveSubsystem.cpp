@@ -0,0 +1,1303 @@
+// Copyright Sertim all rights reserved
+
+
+#include "Game/HopeWorldSaveSubsystem.h"
+#include "Game/HopeSaveGame.h"
+#include "Building/BuildableBase.h"
+#include "Building/BuildingSubsystem.h"
+#include "Building/BuildingDeviceSubsystem.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "EngineUtils.h"
+#include "Async/Async.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Hope.h"
+
+DECLARE_CYCLE_STAT(TEXT("Autosave Snapshot"), STAT_HopeAutosaveSnapshot, STATGROUP_HopeSave);
+DECLARE_CYCLE_STAT(TEXT("Autosave Write (worker)"), STAT_HopeAutosaveWrite, STATGROUP_HopeSave);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Autosave Snapshot (ms)"), STAT_HopeAutosaveSnapshotMs, STATGROUP_HopeSave);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Last Autosave Dirty Records"), STAT_HopeAutosaveDirtyRecords, STATGROUP_HopeSave);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Last Autosave Bytes Written"), STAT_HopeAutosaveBytesWritten, STATGROUP_HopeSave);
+
+namespace HopeWorldSave
+{
+	static float MaterializeBudgetMs = 4.0f;
+	FAutoConsoleVariableRef CVar_MaterializeBudgetMs(TEXT("Hope.Save.MaterializeBudgetMs"), MaterializeBudgetMs,
+		TEXT("Game thread time per frame spent spawning loaded chunks that are not near any player."), ECVF_Default);
+
+	static float NearPlayerRadius = 6000.0f;
+	FAutoConsoleVariableRef CVar_NearPlayerRadius(TEXT("Hope.Save.NearPlayerRadius"), NearPlayerRadius,
+		TEXT("Loaded chunks within this distance of a player are spawned right away, ignoring the time budget."), ECVF_Default);
+
+	static float AutosaveInterval = 300.0f;
+	FAutoConsoleVariableRef CVar_AutosaveInterval(TEXT("Hope.Save.AutosaveInterval"), AutosaveInterval,
+		TEXT("Seconds between background autosaves. 0 disables autosaving."), ECVF_Default);
+
+	static FString AutosaveSlot = TEXT("Autosave");
+	FAutoConsoleVariableRef CVar_AutosaveSlot(TEXT("Hope.Save.AutosaveSlot"), AutosaveSlot,
+		TEXT("Save slot written by background autosaves."), ECVF_Default);
+
+	static bool bRecoverOnStart = true;
+	FAutoConsoleVariableRef CVar_RecoverOnStart(TEXT("Hope.Save.RecoverOnStart"), bRecoverOnStart,
+		TEXT("Load the autosave and replay the journal on top of it when a server world begins play."), ECVF_Default);
+
+	static uint64 AlignOffset(uint64 Offset)
+	{
+		return Align(Offset, RecordAlignment);
+	}
+
+	static uint64 GetWireTableOffset(const FHopeWorldSaveHeader& Header)
+	{
+		return AlignOffset(Header.PlayerTableOffset + uint64(Header.NumPlayers) * sizeof(FHopePlayerSaveRecord));
+	}
+
+	static uint32 GetDeviceNameCrc(const UBuildingDeviceComponent* Device)
+	{
+		return FCrc::StrCrc32(*Device->GetName());
+	}
+
+	static uint64 GetDeviceKey(uint32 PieceID, uint32 DeviceNameCrc)
+	{
+		return (uint64(PieceID) << 32) | DeviceNameCrc;
+	}
+
+	static FVector2D GetChunkCenter(const FHopeWorldSaveChunk& Chunk, float CellSize)
+	{
+		return (FVector2D(Chunk.CellX, Chunk.CellY) + 0.5) * CellSize;
+	}
+
+	static FTransform GetPlayerTransform(const FHopePlayerSaveRecord& Record)
+	{
+		return FTransform(FQuat(Record.Rotation[0], Record.Rotation[1], Record.Rotation[2], Record.Rotation[3]),
+			FVector(Record.Location[0], Record.Location[1], Record.Location[2]));
+	}
+
+	static FString GetPlayerRecordID(const FHopePlayerSaveRecord& Record)
+	{
+		return UTF8_TO_TCHAR(Record.PlayerID);
+	}
+
+	// Writes "Buffer" next to "FilePath" first so a failed write never leaves a broken save behind.
+	static bool SaveFileAtomic(const TArray<uint8>& Buffer, const FString& FilePath)
+	{
+		const FString TempFilePath = FilePath + TEXT(".tmp");
+		return FFileHelper::SaveArrayToFile(Buffer, *TempFilePath) && IFileManager::Get().Move(*FilePath, *TempFilePath);
+	}
+}
+
+void UHopeWorldSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	AutosaveImage = MakeShared<FHopeWorldSaveImage, ESPMode::ThreadSafe>();
+
+	if (UBuildingSubsystem* BuildingSubsystem = Collection.InitializeDependency<UBuildingSubsystem>())
+	{
+		RegisteredHandle = BuildingSubsystem->OnBuildableRegistered.AddUObject(this, &UHopeWorldSaveSubsystem::OnBuildableRegistered);
+		UnregisteredHandle = BuildingSubsystem->OnBuildableUnregistered.AddUObject(this, &UHopeWorldSaveSubsystem::OnBuildableUnregistered);
+	}
+	if (UBuildingDeviceSubsystem* DeviceSubsystem = Collection.InitializeDependency<UBuildingDeviceSubsystem>())
+	{
+		WireChangedHandle = DeviceSubsystem->OnDeviceWireChanged.AddUObject(this, &UHopeWorldSaveSubsystem::OnDeviceWireChanged);
+	}
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(this, &UHopeWorldSaveSubsystem::OnPostLogin);
+}
+
+void UHopeWorldSaveSubsystem::Deinitialize()
+{
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->OnBuildableRegistered.Remove(RegisteredHandle);
+		BuildingSubsystem->OnBuildableUnregistered.Remove(UnregisteredHandle);
+	}
+	if (UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>())
+	{
+		DeviceSubsystem->OnDeviceWireChanged.Remove(WireChangedHandle);
+	}
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+
+	// The worker owns the image and the file handle until it is done, never leave it half written.
+	FinishAutosaveTask();
+	Journal.Reset();
+	FinishLoading();
+
+	Super::Deinitialize();
+}
+
+void UHopeWorldSaveSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (!InWorld.IsGameWorld() || InWorld.GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// The new journal starts after every segment on disk, so a crash during recovery does not lose them.
+	JournalSegment = FHopeWorldJournal::FindLastSegment(GetJournalBaseFilePath(HopeWorldSave::AutosaveSlot)) + 1;
+	if (HopeWorldSave::bRecoverOnStart)
+	{
+		RecoverWorld();
+	}
+	StartJournal();
+
+	// Segments left on disk belong to a world that is not going to be restored.
+	if (!HopeWorldSave::bRecoverOnStart)
+	{
+		FHopeJournalMutation Mutation;
+		Mutation.Op = EHopeJournalOp::Truncate;
+		Mutation.Segment = JournalSegment;
+		Journal->Push(Mutation);
+	}
+}
+
+void UHopeWorldSaveSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Journal)
+	{
+		Journal->FlushOverflow();
+	}
+
+	if (PendingChunks.Num() > 0)
+	{
+		MaterializePendingChunks(HopeWorldSave::MaterializeBudgetMs / 1000.0);
+	}
+
+	// Devices only register when their piece begins play, so the wires wait for the world to begin play as well.
+	if (PendingWires.Num() > 0 && !IsLoading() && GetWorld()->HasBegunPlay())
+	{
+		RestoreWires();
+	}
+
+	if (AutosaveTask.IsValid() && AutosaveTask.IsReady())
+	{
+		FinishAutosaveTask();
+	}
+
+	if (HopeWorldSave::AutosaveInterval > 0.f && GetWorld()->GetNetMode() != NM_Client && !bIsSuspended)
+	{
+		TimeSinceAutosave += DeltaTime;
+		if (TimeSinceAutosave >= HopeWorldSave::AutosaveInterval && Autosave())
+		{
+			TimeSinceAutosave = 0.f;
+		}
+	}
+}
+
+TStatId UHopeWorldSaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHopeWorldSaveSubsystem, STATGROUP_Tickables);
+}
+
+FString UHopeWorldSaveSubsystem::GetWorldFilePath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / (SlotName + HopeWorldSave::FileExtension);
+}
+
+/*
+*		***********************	Save ***********************
+*/
+
+bool UHopeWorldSaveSubsystem::SaveWorld(const FString& SlotName)
+{
+	if (GetWorld()->GetNetMode() == NM_Client || bIsSuspended)
+	{
+		return false;
+	}
+
+	TArray<FHopeBuildablePieceRecord> Records;
+	TArray<FString> ClassPaths;
+	TArray<FHopePlayerSaveRecord> Players;
+	TArray<FHopeDeviceWireRecord> Wires;
+	CaptureWorld(Records, ClassPaths, Players, Wires);
+
+	TArray<uint8> Buffer;
+	WriteWorldFile(Buffer, Records, ClassPaths, Players, Wires);
+
+	const FString FilePath = GetWorldFilePath(SlotName);
+	if (!HopeWorldSave::SaveFileAtomic(Buffer, FilePath))
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Failed to write world file %s"), *FilePath);
+		return false;
+	}
+
+	UHopeSaveGame* SaveGame = Cast<UHopeSaveGame>(UGameplayStatics::CreateSaveGameObject(UHopeSaveGame::StaticClass()));
+	SaveGame->WorldSaveVersion = HopeWorldSave::CurrentVersion;
+	SaveGame->WorldFileName = FPaths::GetCleanFilename(FilePath);
+	SaveGame->NumPieces = Records.Num();
+	SaveGame->SaveTime = FDateTime::UtcNow();
+
+	return UGameplayStatics::SaveGameToSlot(SaveGame, SlotName, 0);
+}
+
+void UHopeWorldSaveSubsystem::CaptureWorld(TArray<FHopeBuildablePieceRecord>& OutRecords, TArray<FString>& OutClassPaths,
+	TArray<FHopePlayerSaveRecord>& OutPlayers, TArray<FHopeDeviceWireRecord>& OutWires) const
+{
+	if (const UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		TMap<const UClass*, uint16> LocalClassIndices;
+		for (const TPair<FIntPoint, FBuildingCell>& Cell : BuildingSubsystem->GetCells())
+		{
+			for (const TWeakObjectPtr<ABuildableBase>& Piece : Cell.Value.Pieces)
+			{
+				const ABuildableBase* Buildable = Piece.Get();
+				if (!Buildable)
+				{
+					continue;
+				}
+
+				uint16* ClassIndex = LocalClassIndices.Find(Buildable->GetClass());
+				if (!ClassIndex)
+				{
+					ClassIndex = &LocalClassIndices.Add(Buildable->GetClass(), OutClassPaths.Num());
+					OutClassPaths.Add(FSoftClassPath(Buildable->GetClass()).ToString());
+				}
+				CaptureRecord(Buildable, *ClassIndex, OutRecords.AddDefaulted_GetRef());
+			}
+		}
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		FHopePlayerSaveRecord Record;
+		if (CapturePlayerRecord(It->Get(), Record))
+		{
+			OutPlayers.Add(Record);
+		}
+	}
+
+	CaptureWires(OutWires);
+}
+
+void UHopeWorldSaveSubsystem::CaptureRecord(const ABuildableBase* Buildable, uint16 ClassIndex, FHopeBuildablePieceRecord& OutRecord)
+{
+	const FVector Location = Buildable->GetActorLocation();
+	const FQuat Rotation = Buildable->GetActorQuat();
+
+	OutRecord.Location[0] = Location.X;
+	OutRecord.Location[1] = Location.Y;
+	OutRecord.Location[2] = Location.Z;
+	OutRecord.Rotation[0] = Rotation.X;
+	OutRecord.Rotation[1] = Rotation.Y;
+	OutRecord.Rotation[2] = Rotation.Z;
+	OutRecord.Rotation[3] = Rotation.W;
+	OutRecord.PieceID = Buildable->PieceID;
+	OutRecord.ClassIndex = ClassIndex;
+	OutRecord.BuildingType = static_cast<uint8>(Buildable->BuildingType);
+	OutRecord.Flags = (Buildable->bIsOpen ? HopeWorldSave::PieceFlag_Open : 0) | HopeWorldSave::PieceFlag_HasTier;
+	OutRecord.Damage = Buildable->Damage;
+	OutRecord.StiltHeight = Buildable->StiltHeight;
+	OutRecord.Tier = static_cast<uint8>(Buildable->Tier);
+}
+
+void UHopeWorldSaveSubsystem::CaptureWires(TArray<FHopeDeviceWireRecord>& OutWires) const
+{
+	const UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>();
+	if (!DeviceSubsystem)
+	{
+		return;
+	}
+
+	TArray<TPair<UBuildingDeviceComponent*, UBuildingDeviceComponent*>> Wires;
+	DeviceSubsystem->GetWires(Wires);
+	OutWires.Reserve(OutWires.Num() + Wires.Num());
+	for (const TPair<UBuildingDeviceComponent*, UBuildingDeviceComponent*>& Wire : Wires)
+	{
+		FHopeDeviceWireRecord Record;
+		if (CaptureWire(Wire.Key, Wire.Value, Record))
+		{
+			OutWires.Add(Record);
+		}
+	}
+}
+
+bool UHopeWorldSaveSubsystem::CaptureWire(const UBuildingDeviceComponent* DeviceA, const UBuildingDeviceComponent* DeviceB, FHopeDeviceWireRecord& OutRecord)
+{
+	const ABuildableBase* PieceA = DeviceA ? Cast<ABuildableBase>(DeviceA->GetOwner()) : nullptr;
+	const ABuildableBase* PieceB = DeviceB ? Cast<ABuildableBase>(DeviceB->GetOwner()) : nullptr;
+	if (!PieceA || !PieceB || PieceA->PieceID == 0 || PieceB->PieceID == 0)
+	{
+		return false;
+	}
+
+	OutRecord.PieceA = PieceA->PieceID;
+	OutRecord.PieceB = PieceB->PieceID;
+	OutRecord.DeviceA = HopeWorldSave::GetDeviceNameCrc(DeviceA);
+	OutRecord.DeviceB = HopeWorldSave::GetDeviceNameCrc(DeviceB);
+	if (HopeWorldSave::GetDeviceKey(OutRecord.PieceA, OutRecord.DeviceA) > HopeWorldSave::GetDeviceKey(OutRecord.PieceB, OutRecord.DeviceB))
+	{
+		Swap(OutRecord.PieceA, OutRecord.PieceB);
+		Swap(OutRecord.DeviceA, OutRecord.DeviceB);
+	}
+	return true;
+}
+
+bool UHopeWorldSaveSubsystem::CapturePlayerRecord(const APlayerController* PlayerController, FHopePlayerSaveRecord& OutRecord)
+{
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn)
+	{
+		return false;
+	}
+
+	const FTCHARToUTF8 PlayerID(*GetPlayerSaveID(PlayerController));
+	FMemory::Memcpy(OutRecord.PlayerID, PlayerID.Get(), FMath::Min<int32>(PlayerID.Length(), UE_ARRAY_COUNT(OutRecord.PlayerID) - 1));
+
+	const FVector Location = Pawn->GetActorLocation();
+	const FQuat Rotation = PlayerController->GetControlRotation().Quaternion();
+
+	OutRecord.Location[0] = Location.X;
+	OutRecord.Location[1] = Location.Y;
+	OutRecord.Location[2] = Location.Z;
+	OutRecord.Rotation[0] = Rotation.X;
+	OutRecord.Rotation[1] = Rotation.Y;
+	OutRecord.Rotation[2] = Rotation.Z;
+	OutRecord.Rotation[3] = Rotation.W;
+	return true;
+}
+
+FString UHopeWorldSaveSubsystem::GetPlayerSaveID(const APlayerController* PlayerController)
+{
+	const APlayerState* PlayerState = PlayerController ? PlayerController->PlayerState.Get() : nullptr;
+	if (!PlayerState)
+	{
+		return FString();
+	}
+	return PlayerState->GetUniqueId().IsValid() ? PlayerState->GetUniqueId().ToString() : PlayerState->GetPlayerName();
+}
+
+void UHopeWorldSaveSubsystem::WriteWorldFile(TArray<uint8>& OutBuffer, TArray<FHopeBuildablePieceRecord>& Records, const TArray<FString>& ClassPaths,
+	const TArray<FHopePlayerSaveRecord>& Players, const TArray<FHopeDeviceWireRecord>& Wires)
+{
+	auto GetRecordCell = [](const FHopeBuildablePieceRecord& Record)
+		{
+			return UBuildingSubsystem::GetCellForLocation(FVector(Record.Location[0], Record.Location[1], Record.Location[2]));
+		};
+
+	// Group records by cell so every chunk is one contiguous range of the piece data.
+	Records.Sort([&GetRecordCell](const FHopeBuildablePieceRecord& A, const FHopeBuildablePieceRecord& B)
+		{
+			const FIntPoint CellA = GetRecordCell(A);
+			const FIntPoint CellB = GetRecordCell(B);
+			return CellA.X != CellB.X ? CellA.X < CellB.X : CellA.Y < CellB.Y;
+		});
+
+	TArray<FHopeWorldSaveChunk> Chunks;
+	for (int32 Index = 0; Index < Records.Num(); Index++)
+	{
+		const FIntPoint Cell = GetRecordCell(Records[Index]);
+		if (Chunks.Num() == 0 || Chunks.Last().CellX != Cell.X || Chunks.Last().CellY != Cell.Y)
+		{
+			FHopeWorldSaveChunk& Chunk = Chunks.AddDefaulted_GetRef();
+			Chunk.CellX = Cell.X;
+			Chunk.CellY = Cell.Y;
+			Chunk.FirstPiece = Index;
+		}
+		Chunks.Last().NumPieces++;
+	}
+
+	TArray<uint8> ClassTable;
+	for (const FString& ClassPath : ClassPaths)
+	{
+		const FTCHARToUTF8 Utf8ClassPath(*ClassPath);
+		const uint16 Length = static_cast<uint16>(Utf8ClassPath.Length());
+		ClassTable.Append(reinterpret_cast<const uint8*>(&Length), sizeof(Length));
+		ClassTable.Append(reinterpret_cast<const uint8*>(Utf8ClassPath.Get()), Length);
+	}
+
+	FHopeWorldSaveHeader Header;
+	Header.NumClasses = ClassPaths.Num();
+	Header.NumChunks = Chunks.Num();
+	Header.NumPieces = Records.Num();
+	Header.NumPlayers = Players.Num();
+	Header.NumWires = Wires.Num();
+	Header.CellSize = UBuildingSubsystem::GetCellSize();
+	Header.ClassTableOffset = sizeof(FHopeWorldSaveHeader);
+	Header.ChunkTableOffset = HopeWorldSave::AlignOffset(Header.ClassTableOffset + ClassTable.Num());
+	Header.PieceDataOffset = HopeWorldSave::AlignOffset(Header.ChunkTableOffset + Chunks.Num() * sizeof(FHopeWorldSaveChunk));
+	Header.PlayerTableOffset = HopeWorldSave::AlignOffset(Header.PieceDataOffset + Records.Num() * sizeof(FHopeBuildablePieceRecord));
+
+	const uint64 WireTableOffset = HopeWorldSave::GetWireTableOffset(Header);
+
+	OutBuffer.SetNumZeroed(WireTableOffset + Wires.Num() * sizeof(FHopeDeviceWireRecord));
+	FMemory::Memcpy(OutBuffer.GetData(), &Header, sizeof(Header));
+	FMemory::Memcpy(OutBuffer.GetData() + Header.ClassTableOffset, ClassTable.GetData(), ClassTable.Num());
+	FMemory::Memcpy(OutBuffer.GetData() + Header.ChunkTableOffset, Chunks.GetData(), Chunks.Num() * sizeof(FHopeWorldSaveChunk));
+	FMemory::Memcpy(OutBuffer.GetData() + Header.PieceDataOffset, Records.GetData(), Records.Num() * sizeof(FHopeBuildablePieceRecord));
+	FMemory::Memcpy(OutBuffer.GetData() + Header.PlayerTableOffset, Players.GetData(), Players.Num() * sizeof(FHopePlayerSaveRecord));
+	FMemory::Memcpy(OutBuffer.GetData() + WireTableOffset, Wires.GetData(), Wires.Num() * sizeof(FHopeDeviceWireRecord));
+}
+
+bool UHopeWorldSaveSubsystem::CompressWorldFile(const TArray<uint8>& WorldFile, TArray<uint8>& OutBuffer)
+{
+	FHopeWorldSaveCompressedHeader Header;
+	Header.UncompressedSize = WorldFile.Num();
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, WorldFile.Num());
+	OutBuffer.SetNumUninitialized(sizeof(Header) + CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Oodle, OutBuffer.GetData() + sizeof(Header), CompressedSize, WorldFile.GetData(), WorldFile.Num()))
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(OutBuffer.GetData(), &Header, sizeof(Header));
+	OutBuffer.SetNum(sizeof(Header) + CompressedSize, EAllowShrinking::No);
+	return true;
+}
+
+/*
+*		***********************	Save ***********************
+*/
+
+
+/*
+*		***********************	Autosave ***********************
+*/
+
+bool UHopeWorldSaveSubsystem::Autosave()
+{
+	if (GetWorld()->GetNetMode() == NM_Client || bIsSuspended)
+	{
+		return false;
+	}
+	// One write at a time, the dirty records keep piling up until the worker is free again.
+	if (AutosaveTask.IsValid())
+	{
+		if (!AutosaveTask.IsReady())
+		{
+			return false;
+		}
+		FinishAutosaveTask();
+	}
+
+	FHopeWorldSaveDelta Delta;
+	const double SnapshotStartTime = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_HopeAutosaveSnapshot);
+
+		Delta.DirtyPieces.Reserve(DirtyPieces.Num());
+		for (const TPair<uint32, TWeakObjectPtr<ABuildableBase>>& Pair : DirtyPieces)
+		{
+			if (const ABuildableBase* Buildable = Pair.Value.Get())
+			{
+				CaptureRecord(Buildable, GetClassIndex(Buildable->GetClass()), Delta.DirtyPieces.AddDefaulted_GetRef());
+			}
+		}
+		Delta.RemovedPieces = RemovedPieces.Array();
+
+		// Players are few and move all the time, so they are always captured.
+		for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			FHopePlayerSaveRecord Record;
+			if (CapturePlayerRecord(It->Get(), Record))
+			{
+				Delta.Players.Add(Record);
+			}
+		}
+
+		// Wires have no dirty tracking and are few, so all of them are captured. The wires of a load that are not
+		// restored yet only exist in the image, which keeps them until then.
+		if (!IsLoading() && PendingWires.Num() == 0)
+		{
+			CaptureWires(Delta.Wires);
+			Delta.bHasWires = true;
+		}
+
+		Delta.NewClassPaths = MoveTemp(NewClassPaths);
+		DirtyPieces.Reset();
+		RemovedPieces.Reset();
+
+		// Everything from here on goes to a new journal segment, the old ones are deleted once this autosave is on disk.
+		JournalSegment++;
+		if (Journal)
+		{
+			FHopeJournalMutation Mutation;
+			Mutation.Op = EHopeJournalOp::Rotate;
+			Mutation.Segment = JournalSegment;
+			Journal->Push(Mutation);
+		}
+	}
+	SET_FLOAT_STAT(STAT_HopeAutosaveSnapshotMs, (FPlatformTime::Seconds() - SnapshotStartTime) * 1000.0);
+	SET_DWORD_STAT(STAT_HopeAutosaveDirtyRecords, Delta.DirtyPieces.Num() + Delta.RemovedPieces.Num());
+
+	AutosaveTaskSlot = HopeWorldSave::AutosaveSlot;
+	AutosaveTaskSegment = JournalSegment;
+	const FString FilePath = GetWorldFilePath(AutosaveTaskSlot);
+
+	AutosaveTask = Async(EAsyncExecution::ThreadPool, [Image = AutosaveImage, Delta = MoveTemp(Delta), FilePath]() mutable
+		{
+			SCOPE_CYCLE_COUNTER(STAT_HopeAutosaveWrite);
+
+			Image->ClassPaths.Append(Delta.NewClassPaths);
+			for (const uint32 PieceID : Delta.RemovedPieces)
+			{
+				Image->Pieces.Remove(PieceID);
+			}
+			for (const FHopeBuildablePieceRecord& Record : Delta.DirtyPieces)
+			{
+				Image->Pieces.Add(Record.PieceID, Record);
+			}
+			for (const FHopePlayerSaveRecord& Record : Delta.Players)
+			{
+				Image->Players.Add(HopeWorldSave::GetPlayerRecordID(Record), Record);
+			}
+			if (Delta.bHasWires)
+			{
+				Image->Wires = MoveTemp(Delta.Wires);
+			}
+
+			TArray<FHopeBuildablePieceRecord> Records;
+			Image->Pieces.GenerateValueArray(Records);
+			TArray<FHopePlayerSaveRecord> Players;
+			Image->Players.GenerateValueArray(Players);
+
+			FHopeAutosaveResult Result;
+			Result.NumPieces = Records.Num();
+
+			TArray<uint8> WorldFile;
+			WriteWorldFile(WorldFile, Records, Image->ClassPaths, Players, Image->Wires);
+
+			TArray<uint8> CompressedFile;
+			if (CompressWorldFile(WorldFile, CompressedFile) && HopeWorldSave::SaveFileAtomic(CompressedFile, FilePath))
+			{
+				Result.BytesWritten = CompressedFile.Num();
+			}
+			return Result;
+		});
+
+	return true;
+}
+
+void UHopeWorldSaveSubsystem::FinishAutosaveTask()
+{
+	if (!AutosaveTask.IsValid())
+	{
+		return;
+	}
+
+	const FHopeAutosaveResult Result = AutosaveTask.Get();
+	AutosaveTask.Reset();
+
+	if (Result.BytesWritten == INDEX_NONE)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Autosave failed to write %s"), *GetWorldFilePath(AutosaveTaskSlot));
+		return;
+	}
+	SET_DWORD_STAT(STAT_HopeAutosaveBytesWritten, Result.BytesWritten);
+	UE_LOG(LogHopeBuilding, Verbose, TEXT("Autosave wrote %d pieces (%lld bytes) to %s"), Result.NumPieces, Result.BytesWritten, *AutosaveTaskSlot);
+
+	// The save game object is tiny, the slot system writes it without blocking the game thread.
+	UHopeSaveGame* SaveGame = Cast<UHopeSaveGame>(UGameplayStatics::CreateSaveGameObject(UHopeSaveGame::StaticClass()));
+	SaveGame->WorldSaveVersion = HopeWorldSave::CurrentVersion;
+	SaveGame->WorldFileName = FPaths::GetCleanFilename(GetWorldFilePath(AutosaveTaskSlot));
+	SaveGame->NumPieces = Result.NumPieces;
+	SaveGame->SaveTime = FDateTime::UtcNow();
+	SaveGame->JournalSegment = AutosaveTaskSegment;
+	UGameplayStatics::AsyncSaveGameToSlot(SaveGame, AutosaveTaskSlot, 0);
+
+	// Replaying a segment twice is harmless, so they can go before the save game object is written.
+	if (Journal)
+	{
+		FHopeJournalMutation Mutation;
+		Mutation.Op = EHopeJournalOp::Truncate;
+		Mutation.Segment = AutosaveTaskSegment;
+		Journal->Push(Mutation);
+	}
+}
+
+void UHopeWorldSaveSubsystem::MarkPieceDirty(ABuildableBase* Buildable)
+{
+	if (Buildable && Buildable->PieceID != 0 && !bIsMaterializing && !bIsSuspended)
+	{
+		DirtyPieces.Add(Buildable->PieceID, Buildable);
+	}
+}
+
+void UHopeWorldSaveSubsystem::RecordPieceMutation(ABuildableBase* Buildable, EHopeJournalOp Op)
+{
+	if (Buildable && !bIsMaterializing && !bIsSuspended)
+	{
+		MarkPieceDirty(Buildable);
+		PushJournal(Op, Buildable);
+	}
+}
+
+void UHopeWorldSaveSubsystem::OnBuildableRegistered(ABuildableBase* Buildable)
+{
+	// Pieces spawned from a save are already part of the autosave image.
+	if (!bIsMaterializing && !bIsSuspended)
+	{
+		RemovedPieces.Remove(Buildable->PieceID);
+		MarkPieceDirty(Buildable);
+		PushJournal(EHopeJournalOp::Place, Buildable);
+	}
+}
+
+void UHopeWorldSaveSubsystem::OnBuildableUnregistered(ABuildableBase* Buildable)
+{
+	// Pieces that only end play because the world or their level goes away are still part of the save.
+	if (!Buildable->IsActorBeingDestroyed() || bIsMaterializing || bIsSuspended)
+	{
+		return;
+	}
+
+	DirtyPieces.Remove(Buildable->PieceID);
+	RemovedPieces.Add(Buildable->PieceID);
+	PushJournal(EHopeJournalOp::Destroy, Buildable);
+}
+
+void UHopeWorldSaveSubsystem::OnDeviceWireChanged(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB, bool bConnected)
+{
+	// Restored wires are already part of the autosave image, the next autosave captures all wires anyway.
+	FHopeDeviceWireRecord Wire;
+	if (!bIsMaterializing && !bIsSuspended && CaptureWire(DeviceA, DeviceB, Wire))
+	{
+		PushJournalWire(bConnected ? EHopeJournalOp::Connect : EHopeJournalOp::Disconnect, Wire);
+	}
+}
+
+void UHopeWorldSaveSubsystem::SeedAutosaveImage()
+{
+	FinishAutosaveTask();
+
+	AutosaveImage = MakeShared<FHopeWorldSaveImage, ESPMode::ThreadSafe>();
+	AutosaveImage->ClassPaths = LoadedClassPaths;
+	AutosaveImage->Pieces.Reserve(LoadedHeader.NumPieces + ReplayedPieces.Num());
+	for (uint32 Index = 0; Index < LoadedHeader.NumPieces; Index++)
+	{
+		if (!ReplayedRemovals.Contains(LoadedPieces[Index].PieceID))
+		{
+			AutosaveImage->Pieces.Add(LoadedPieces[Index].PieceID, LoadedPieces[Index]);
+		}
+	}
+	AutosaveImage->Pieces.Append(ReplayedPieces);
+	AutosaveImage->Wires = PendingWires;
+
+	// Classes that failed to load keep their slot so the indices of the loaded records stay valid.
+	ClassIndices.Reset();
+	NewClassPaths.Reset();
+	for (int32 Index = 0; Index < LoadedClasses.Num(); Index++)
+	{
+		if (LoadedClasses[Index])
+		{
+			ClassIndices.Add(LoadedClasses[Index].Get(), Index);
+			PushJournalClass(LoadedClasses[Index].Get(), Index);
+		}
+	}
+	NumClassPaths = LoadedClassPaths.Num();
+
+	// Anything placed before the load was cleared with the world it belonged to.
+	DirtyPieces.Reset();
+	RemovedPieces.Reset();
+}
+
+uint16 UHopeWorldSaveSubsystem::GetClassIndex(const UClass* Class)
+{
+	if (const uint16* ClassIndex = ClassIndices.Find(Class))
+	{
+		return *ClassIndex;
+	}
+
+	NewClassPaths.Add(FSoftClassPath(Class).ToString());
+	const uint16 ClassIndex = ClassIndices.Add(Class, NumClassPaths++);
+	PushJournalClass(Class, ClassIndex);
+	return ClassIndex;
+}
+
+/*
+*		***********************	Autosave ***********************
+*/
+
+
+/*
+*		***********************	Load ***********************
+*/
+
+bool UHopeWorldSaveSubsystem::LoadWorld(const FString& SlotName)
+{
+	if (GetWorld()->GetNetMode() == NM_Client || IsLoading())
+	{
+		return false;
+	}
+
+	const UHopeSaveGame* SaveGame = Cast<UHopeSaveGame>(UGameplayStatics::LoadGameFromSlot(SlotName, 0));
+	if (!SaveGame || SaveGame->WorldFileName.IsEmpty())
+	{
+		return false;
+	}
+
+	LoadStartTime = FPlatformTime::Seconds();
+	if (!OpenWorldFile(FPaths::ProjectSavedDir() / TEXT("SaveGames") / SaveGame->WorldFileName))
+	{
+		return false;
+	}
+	StartLoading();
+
+	// The journal only describes changes to the autosave, which is a different world now.
+	Autosave();
+	return true;
+}
+
+bool UHopeWorldSaveSubsystem::RecoverWorld()
+{
+	if (GetWorld()->GetNetMode() == NM_Client || IsLoading())
+	{
+		return false;
+	}
+
+	LoadStartTime = FPlatformTime::Seconds();
+
+	// Without an autosave the whole journal is replayed on an empty world.
+	uint32 FirstSegment = 0;
+	const UHopeSaveGame* SaveGame = Cast<UHopeSaveGame>(UGameplayStatics::LoadGameFromSlot(HopeWorldSave::AutosaveSlot, 0));
+	if (SaveGame && !SaveGame->WorldFileName.IsEmpty())
+	{
+		if (!OpenWorldFile(FPaths::ProjectSavedDir() / TEXT("SaveGames") / SaveGame->WorldFileName))
+		{
+			return false;
+		}
+		FirstSegment = SaveGame->JournalSegment;
+	}
+
+	ReplayJournal(FirstSegment);
+	if (!SaveGame && ReplayedPieces.Num() == 0)
+	{
+		FinishLoading();
+		return false;
+	}
+
+	StartLoading();
+	return true;
+}
+
+bool UHopeWorldSaveSubsystem::OpenWorldFile(const FString& FilePath)
+{
+	// Map the file so piece records are read straight from the page cache.
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	if (MappedFile)
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFileData, *FilePath))
+	{
+		Data = LoadedFileData.GetData();
+		Size = LoadedFileData.Num();
+	}
+
+	// Autosaves are compressed as a whole, inflate them once and read the result like a mapped file.
+	FHopeWorldSaveCompressedHeader CompressedHeader;
+	if (Data && Size >= static_cast<int64>(sizeof(CompressedHeader)))
+	{
+		FMemory::Memcpy(&CompressedHeader, Data, sizeof(CompressedHeader));
+	}
+	if (Data && CompressedHeader.Magic == HopeWorldSave::CompressedMagic && CompressedHeader.UncompressedSize <= MAX_int32)
+	{
+		TArray<uint8> UncompressedData;
+		UncompressedData.SetNumUninitialized(CompressedHeader.UncompressedSize);
+		if (FCompression::UncompressMemory(NAME_Oodle, UncompressedData.GetData(), UncompressedData.Num(),
+			Data + sizeof(CompressedHeader), Size - sizeof(CompressedHeader)))
+		{
+			LoadedFileData = MoveTemp(UncompressedData);
+			Data = LoadedFileData.GetData();
+			Size = LoadedFileData.Num();
+		}
+		else
+		{
+			Data = nullptr;
+		}
+		MappedRegion.Reset();
+		MappedFile.Reset();
+	}
+
+	if (!Data || !ParseWorldFile(Data, Size))
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Failed to load world file %s"), *FilePath);
+		FinishLoading();
+		return false;
+	}
+	return true;
+}
+
+void UHopeWorldSaveSubsystem::StartLoading()
+{
+	ClearBuildables();
+	SeedAutosaveImage();
+
+	// Pieces the journal touched are spawned right away, there are only as many as changed since the last autosave.
+	{
+		TGuardValue<bool> MaterializingGuard(bIsMaterializing, true);
+		for (const TPair<uint32, FHopeBuildablePieceRecord>& Pair : ReplayedPieces)
+		{
+			SpawnPiece(Pair.Value);
+		}
+	}
+
+	// Players that are already in the game are placed right away, the others when their pawn is possessed.
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		OnPostLogin(nullptr, It->Get());
+		if (APlayerController* PlayerController = It->Get())
+		{
+			OnPlayerPawnChanged(nullptr, PlayerController->GetPawn());
+		}
+	}
+
+	// Spawn what players are standing in right away, the rest is trickled in by Tick.
+	LastSortTime = 0.0;
+	MaterializePendingChunks(0.0);
+}
+
+void UHopeWorldSaveSubsystem::ClearBuildables()
+{
+	// The loaded world replaces this one, its removal is not a change the journal should replay.
+	TGuardValue<bool> MaterializingGuard(bIsMaterializing, true);
+	for (TActorIterator<ABuildableBase> It(GetWorld()); It; ++It)
+	{
+		It->Destroy();
+	}
+}
+
+bool UHopeWorldSaveSubsystem::ParseWorldFile(const uint8* Data, int64 Size)
+{
+	if (Size < static_cast<int64>(HopeWorldSave::HeaderSizeV1))
+	{
+		return false;
+	}
+
+	// Older headers are shorter, the fields they lack keep their defaults.
+	FHopeWorldSaveHeader Header;
+	FMemory::Memcpy(&Header, Data, HopeWorldSave::HeaderSizeV1);
+	if (Header.Magic != HopeWorldSave::Magic)
+	{
+		return false;
+	}
+	if (Header.Version == 0 || Header.Version > HopeWorldSave::CurrentVersion)
+	{
+		UE_LOG(LogHopeBuilding, Error, TEXT("Unsupported world file version %u (expected %u)"), Header.Version, HopeWorldSave::CurrentVersion);
+		return false;
+	}
+	if (Header.Version >= 2)
+	{
+		if (Size < static_cast<int64>(sizeof(FHopeWorldSaveHeader)))
+		{
+			return false;
+		}
+		FMemory::Memcpy(&Header, Data, sizeof(FHopeWorldSaveHeader));
+	}
+	else
+	{
+		Header.PlayerTableOffset = 0;
+		Header.NumPlayers = 0;
+	}
+	if (Header.Version < 3)
+	{
+		Header.NumWires = 0;
+	}
+
+	const uint64 ChunkTableEnd = Header.ChunkTableOffset + uint64(Header.NumChunks) * sizeof(FHopeWorldSaveChunk);
+	const uint64 PieceDataEnd = Header.PieceDataOffset + uint64(Header.NumPieces) * sizeof(FHopeBuildablePieceRecord);
+	const uint64 PlayerTableEnd = Header.PlayerTableOffset + uint64(Header.NumPlayers) * sizeof(FHopePlayerSaveRecord);
+	const uint64 WireTableOffset = HopeWorldSave::GetWireTableOffset(Header);
+	const uint64 WireTableEnd = WireTableOffset + uint64(Header.NumWires) * sizeof(FHopeDeviceWireRecord);
+	if (!IsAligned(Header.ChunkTableOffset, HopeWorldSave::RecordAlignment) || !IsAligned(Header.PieceDataOffset, HopeWorldSave::RecordAlignment)
+		|| !IsAligned(Header.PlayerTableOffset, HopeWorldSave::RecordAlignment) || Header.ClassTableOffset > Header.ChunkTableOffset
+		|| ChunkTableEnd > uint64(Size) || PieceDataEnd > uint64(Size) || PlayerTableEnd > uint64(Size) || WireTableEnd > uint64(Size))
+	{
+		return false;
+	}
+
+	// Class table
+	const uint8* ClassData = Data + Header.ClassTableOffset;
+	const uint8* ClassDataEnd = Data + Header.ChunkTableOffset;
+	LoadedClasses.Reset(Header.NumClasses);
+	LoadedClassPaths.Reset(Header.NumClasses);
+	for (uint32 Index = 0; Index < Header.NumClasses; Index++)
+	{
+		uint16 Length = 0;
+		if (ClassData + sizeof(Length) > ClassDataEnd)
+		{
+			return false;
+		}
+		FMemory::Memcpy(&Length, ClassData, sizeof(Length));
+		ClassData += sizeof(Length);
+		if (ClassData + Length > ClassDataEnd)
+		{
+			return false;
+		}
+
+		const FUTF8ToTCHAR ClassPath(reinterpret_cast<const ANSICHAR*>(ClassData), Length);
+		FString& LoadedClassPath = LoadedClassPaths.Emplace_GetRef(ClassPath.Length(), ClassPath.Get());
+		LoadedClasses.Add(FSoftClassPath(LoadedClassPath).TryLoadClass<ABuildableBase>());
+		ClassData += Length;
+	}
+
+	// Chunk table
+	const FHopeWorldSaveChunk* Chunks = reinterpret_cast<const FHopeWorldSaveChunk*>(Data + Header.ChunkTableOffset);
+	PendingChunks.Reset(Header.NumChunks);
+	for (uint32 Index = 0; Index < Header.NumChunks; Index++)
+	{
+		if (uint64(Chunks[Index].FirstPiece) + Chunks[Index].NumPieces > Header.NumPieces)
+		{
+			PendingChunks.Reset();
+			return false;
+		}
+		PendingChunks.Add(&Chunks[Index]);
+	}
+
+	// Player table
+	SavedPlayerTransforms.Reset();
+	const FHopePlayerSaveRecord* Players = reinterpret_cast<const FHopePlayerSaveRecord*>(Data + Header.PlayerTableOffset);
+	for (uint32 Index = 0; Index < Header.NumPlayers; Index++)
+	{
+		FHopePlayerSaveRecord Record = Players[Index];
+		Record.PlayerID[UE_ARRAY_COUNT(Record.PlayerID) - 1] = '\0';
+		SavedPlayerTransforms.Add(HopeWorldSave::GetPlayerRecordID(Record), HopeWorldSave::GetPlayerTransform(Record));
+	}
+
+	// Wire table
+	PendingWires.Reset(Header.NumWires);
+	PendingWires.Append(reinterpret_cast<const FHopeDeviceWireRecord*>(Data + WireTableOffset), Header.NumWires);
+
+	LoadedHeader = Header;
+	LoadedPieces = reinterpret_cast<const FHopeBuildablePieceRecord*>(Data + Header.PieceDataOffset);
+	NumMaterializedPieces = 0;
+	return true;
+}
+
+void UHopeWorldSaveSubsystem::ReplayJournal(uint32 FirstSegment)
+{
+	// Journal class index -> index into "LoadedClasses". Every segment defines its classes again.
+	TMap<uint16, uint16> ClassRemap;
+	int32 NumEntries = 0;
+
+	FHopeWorldJournal::ReadSegments(GetJournalBaseFilePath(HopeWorldSave::AutosaveSlot), FirstSegment,
+		[this, &ClassRemap, &NumEntries](const FHopeJournalEntry& Entry, const FString& ClassPath)
+		{
+			NumEntries++;
+			const uint32 PieceID = Entry.Record.PieceID;
+			switch (Entry.Op)
+			{
+			case EHopeJournalOp::DefineClass:
+			{
+				int32 LoadedIndex = LoadedClassPaths.IndexOfByKey(ClassPath);
+				if (LoadedIndex == INDEX_NONE)
+				{
+					LoadedIndex = LoadedClassPaths.Add(ClassPath);
+					LoadedClasses.Add(FSoftClassPath(ClassPath).TryLoadClass<ABuildableBase>());
+				}
+				ClassRemap.Add(Entry.Record.ClassIndex, static_cast<uint16>(LoadedIndex));
+				break;
+			}
+			case EHopeJournalOp::Place:
+			case EHopeJournalOp::Damage:
+			case EHopeJournalOp::DoorState:
+			case EHopeJournalOp::Upgrade:
+			{
+				if (const uint16* LoadedIndex = ClassRemap.Find(Entry.Record.ClassIndex))
+				{
+					FHopeBuildablePieceRecord& Record = ReplayedPieces.Add(PieceID, Entry.Record);
+					Record.ClassIndex = *LoadedIndex;
+					ReplayedRemovals.Remove(PieceID);
+				}
+				break;
+			}
+			case EHopeJournalOp::Destroy:
+				ReplayedPieces.Remove(PieceID);
+				ReplayedRemovals.Add(PieceID);
+				break;
+			case EHopeJournalOp::Connect:
+				PendingWires.AddUnique(Entry.GetWire());
+				break;
+			case EHopeJournalOp::Disconnect:
+				PendingWires.Remove(Entry.GetWire());
+				break;
+			default:
+				break;
+			}
+		});
+
+	UE_CLOG(NumEntries > 0, LogHopeBuilding, Display, TEXT("Replayed %d journal entries: %d pieces restored, %d removed"),
+		NumEntries, ReplayedPieces.Num(), ReplayedRemovals.Num());
+}
+
+void UHopeWorldSaveSubsystem::MaterializePendingChunks(double TimeBudgetSeconds)
+{
+	TArray<FVector> PlayerLocations;
+	GetPlayerLocations(PlayerLocations);
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastSortTime >= 1.0)
+	{
+		SortPendingChunks(PlayerLocations);
+		LastSortTime = Now;
+	}
+
+	const double EndTime = Now + TimeBudgetSeconds;
+	while (PendingChunks.Num() > 0)
+	{
+		const FHopeWorldSaveChunk* Chunk = PendingChunks.Last();
+		if (FPlatformTime::Seconds() >= EndTime && !IsChunkNearPlayers(*Chunk, PlayerLocations))
+		{
+			break;
+		}
+		PendingChunks.Pop(EAllowShrinking::No);
+		MaterializeChunk(*Chunk);
+	}
+
+	if (PendingChunks.Num() == 0)
+	{
+		UE_LOG(LogHopeBuilding, Display, TEXT("World load finished: %d pieces in %.3f s"), NumMaterializedPieces, FPlatformTime::Seconds() - LoadStartTime);
+		FinishLoading();
+	}
+}
+
+void UHopeWorldSaveSubsystem::MaterializeChunk(const FHopeWorldSaveChunk& Chunk)
+{
+	TGuardValue<bool> MaterializingGuard(bIsMaterializing, true);
+
+	const bool bHasJournalChanges = ReplayedPieces.Num() > 0 || ReplayedRemovals.Num() > 0;
+	for (uint32 Index = Chunk.FirstPiece; Index < Chunk.FirstPiece + Chunk.NumPieces; Index++)
+	{
+		const FHopeBuildablePieceRecord& Record = LoadedPieces[Index];
+		if (bHasJournalChanges && (ReplayedPieces.Contains(Record.PieceID) || ReplayedRemovals.Contains(Record.PieceID)))
+		{
+			continue;
+		}
+		SpawnPiece(Record);
+	}
+}
+
+void UHopeWorldSaveSubsystem::SpawnPiece(const FHopeBuildablePieceRecord& Record)
+{
+	if (!LoadedClasses.IsValidIndex(Record.ClassIndex) || !LoadedClasses[Record.ClassIndex])
+	{
+		return;
+	}
+
+	const FTransform Transform(FQuat(Record.Rotation[0], Record.Rotation[1], Record.Rotation[2], Record.Rotation[3]),
+		FVector(Record.Location[0], Record.Location[1], Record.Location[2]));
+
+	ABuildableBase* SpawnedBuilding = GetWorld()->SpawnActorDeferred<ABuildableBase>(LoadedClasses[Record.ClassIndex], Transform);
+	if (SpawnedBuilding)
+	{
+		SpawnedBuilding->PieceID = Record.PieceID;
+		SpawnedBuilding->Damage = Record.Damage;
+		SpawnedBuilding->bIsOpen = (Record.Flags & HopeWorldSave::PieceFlag_Open) != 0;
+		SpawnedBuilding->StiltHeight = Record.StiltHeight;
+		if (Record.Flags & HopeWorldSave::PieceFlag_HasTier)
+		{
+			SpawnedBuilding->Tier = static_cast<EBuildingTier>(Record.Tier);
+		}
+		UGameplayStatics::FinishSpawningActor(SpawnedBuilding, Transform);
+		NumMaterializedPieces++;
+	}
+}
+
+void UHopeWorldSaveSubsystem::SortPendingChunks(const TArray<FVector>& PlayerLocations)
+{
+	if (PlayerLocations.Num() == 0)
+	{
+		return;
+	}
+
+	const float CellSize = LoadedHeader.CellSize;
+	auto GetDistanceToPlayers = [&PlayerLocations, CellSize](const FHopeWorldSaveChunk& Chunk)
+		{
+			const FVector2D Center = HopeWorldSave::GetChunkCenter(Chunk, CellSize);
+			double MinDistanceSquared = TNumericLimits<double>::Max();
+			for (const FVector& Location : PlayerLocations)
+			{
+				MinDistanceSquared = FMath::Min(MinDistanceSquared, FVector2D::DistSquared(Center, FVector2D(Location)));
+			}
+			return MinDistanceSquared;
+		};
+
+	// Far to near, so the nearest chunk is popped first.
+	PendingChunks.Sort([&GetDistanceToPlayers](const FHopeWorldSaveChunk& A, const FHopeWorldSaveChunk& B)
+		{
+			return GetDistanceToPlayers(A) > GetDistanceToPlayers(B);
+		});
+}
+
+bool UHopeWorldSaveSubsystem::IsChunkNearPlayers(const FHopeWorldSaveChunk& Chunk, const TArray<FVector>& PlayerLocations) const
+{
+	const FVector2D Center = HopeWorldSave::GetChunkCenter(Chunk, LoadedHeader.CellSize);
+	for (const FVector& Location : PlayerLocations)
+	{
+		if (FVector2D::Distance(Center, FVector2D(Location)) <= HopeWorldSave::NearPlayerRadius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UHopeWorldSaveSubsystem::GetPlayerLocations(TArray<FVector>& OutLocations) const
+{
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr)
+		{
+			OutLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+}
+
+void UHopeWorldSaveSubsystem::FinishLoading()
+{
+	PendingChunks.Reset();
+	LoadedHeader = FHopeWorldSaveHeader();
+	LoadedPieces = nullptr;
+	LoadedClasses.Reset();
+	LoadedClassPaths.Reset();
+	ReplayedPieces.Reset();
+	ReplayedRemovals.Reset();
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedFileData.Empty();
+}
+
+void UHopeWorldSaveSubsystem::RestoreWires()
+{
+	UBuildingDeviceSubsystem* DeviceSubsystem = GetWorld()->GetSubsystem<UBuildingDeviceSubsystem>();
+	if (!DeviceSubsystem)
+	{
+		PendingWires.Reset();
+		return;
+	}
+
+	// Piece ID and device name -> device, for every piece that has devices.
+	TMap<uint64, UBuildingDeviceComponent*> Devices;
+	for (TActorIterator<ABuildableBase> It(GetWorld()); It; ++It)
+	{
+		TInlineComponentArray<UBuildingDeviceComponent*> PieceDevices(*It);
+		for (UBuildingDeviceComponent* Device : PieceDevices)
+		{
+			Devices.Add(HopeWorldSave::GetDeviceKey(It->PieceID, HopeWorldSave::GetDeviceNameCrc(Device)), Device);
+		}
+	}
+
+	TGuardValue<bool> MaterializingGuard(bIsMaterializing, true);
+	int32 NumRestored = 0;
+	for (const FHopeDeviceWireRecord& Wire : PendingWires)
+	{
+		UBuildingDeviceComponent** DeviceA = Devices.Find(HopeWorldSave::GetDeviceKey(Wire.PieceA, Wire.DeviceA));
+		UBuildingDeviceComponent** DeviceB = Devices.Find(HopeWorldSave::GetDeviceKey(Wire.PieceB, Wire.DeviceB));
+		if (DeviceA && DeviceB && DeviceSubsystem->ConnectDevices(*DeviceA, *DeviceB))
+		{
+			NumRestored++;
+		}
+	}
+
+	UE_CLOG(NumRestored < PendingWires.Num(), LogHopeBuilding, Warning, TEXT("Restored %d of %d saved wires, the others lost a piece or device"),
+		NumRestored, PendingWires.Num());
+	PendingWires.Reset();
+}
+
+void UHopeWorldSaveSubsystem::OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	if (NewPlayer && NewPlayer->GetWorld() == GetWorld() && SavedPlayerTransforms.Num() > 0)
+	{
+		NewPlayer->OnPossessedPawnChanged.AddUniqueDynamic(this, &UHopeWorldSaveSubsystem::OnPlayerPawnChanged);
+	}
+}
+
+void UHopeWorldSaveSubsystem::OnPlayerPawnChanged(APawn* OldPawn, APawn* NewPawn)
+{
+	APlayerController* PlayerController = NewPawn ? NewPawn->GetController<APlayerController>() : nullptr;
+	if (!PlayerController)
+	{
+		return;
+	}
+
+	FTransform SavedTransform;
+	if (!SavedPlayerTransforms.RemoveAndCopyValue(GetPlayerSaveID(PlayerController), SavedTransform))
+	{
+		return;
+	}
+
+	NewPawn->SetActorLocation(SavedTransform.GetLocation(), false, nullptr, ETeleportType::TeleportPhysics);
+	PlayerController->SetControlRotation(SavedTransform.Rotator());
+	PlayerController->OnPossessedPawnChanged.RemoveDynamic(this, &UHopeWorldSaveSubsystem::OnPlayerPawnChanged);
+}
+
+/*
+*		***********************	Load ***********************
+*/
+
+
+/*
+*		***********************	Journal ***********************
+*/
+
+void UHopeWorldSaveSubsystem::StartJournal()
+{
+	Journal = MakeUnique<FHopeWorldJournal>(GetJournalBaseFilePath(HopeWorldSave::AutosaveSlot), JournalSegment);
+
+	// Classes indexed during recovery have to be known to the new segment.
+	for (const TPair<const UClass*, uint16>& Pair : ClassIndices)
+	{
+		PushJournalClass(Pair.Key, Pair.Value);
+	}
+}
+
+void UHopeWorldSaveSubsystem::PushJournal(EHopeJournalOp Op, const ABuildableBase* Buildable)
+{
+	if (!Journal || Buildable->PieceID == 0)
+	{
+		return;
+	}
+
+	FHopeJournalMutation Mutation;
+	Mutation.Op = Op;
+	CaptureRecord(Buildable, GetClassIndex(Buildable->GetClass()), Mutation.Record);
+	Journal->Push(Mutation);
+}
+
+void UHopeWorldSaveSubsystem::PushJournalClass(const UClass* Class, uint16 ClassIndex)
+{
+	if (Journal)
+	{
+		FHopeJournalMutation Mutation;
+		Mutation.Op = EHopeJournalOp::DefineClass;
+		Mutation.Record.ClassIndex = ClassIndex;
+		Mutation.ClassPath = FTopLevelAssetPath(Class);
+		Journal->Push(Mutation);
+	}
+}
+
+void UHopeWorldSaveSubsystem::PushJournalWire(EHopeJournalOp Op, const FHopeDeviceWireRecord& Wire)
+{
+	if (Journal)
+	{
+		FHopeJournalMutation Mutation;
+		Mutation.Op = Op;
+		Mutation.Wire = Wire;
+		Journal->Push(Mutation);
+	}
+}
+
+FString UHopeWorldSaveSubsystem::GetJournalBaseFilePath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / SlotName;
+}
+
+/*
+*		***********************	Journal ***********************
+*/
@@ -0,0 +1,90 @@
+// Copyright Sertim all rights reserved
+
+#include "HopeInterfaces/HopeInterfaceDispatch.h"
+#include "HopeInterfaces/PlayerInterface.h"
+#include "HopeInterfaces/ALSInterface.h"
+#include "ALS/CharacterAnimInstance.h"
+#include "Building/BuildingComponent.h"
+#include "GameFramework/Character.h"
+#include "Kismet/GameplayStatics.h"
+#include "Hope.h"
+
+bool HopeInterfaceDispatch::IsNative(const UObject* Object, FName FunctionName)
+{
+	// Blueprint implementations and overrides are found first, and are never native.
+	const UFunction* Function = Object ? Object->FindFunction(FunctionName) : nullptr;
+	return Function && Function->HasAnyFunctionFlags(FUNC_Native);
+}
+
+#if !UE_BUILD_SHIPPING
+
+namespace HopeInterfaceDispatch
+{
+	// Runs "Call" "NumCalls" times and returns the average cost of one call in nanoseconds.
+	template <typename CallType>
+	static double MeasureCall(int32 NumCalls, CallType&& Call)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < NumCalls; Index++)
+		{
+			Call();
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1000000000.0 / FMath::Max(NumCalls, 1);
+	}
+
+	static void RunBenchmark(const TArray<FString>& Args, UWorld* World)
+	{
+		int32 NumCalls = 100000;
+		FParse::Value(*FString::Join(Args, TEXT(" ")), TEXT("Calls="), NumCalls);
+		NumCalls = FMath::Max(NumCalls, 1);
+
+		ACharacter* Character = World ? Cast<ACharacter>(UGameplayStatics::GetPlayerPawn(World, 0)) : nullptr;
+		if (!Character || !Character->Implements<UPlayerInterface>())
+		{
+			UE_LOG(LogHopeDebug, Error, TEXT("Interface dispatch benchmark needs a local player character implementing the player interface"));
+			return;
+		}
+
+		// Summed so the calls can not be optimized away.
+		UPTRINT Sink = 0;
+
+		const double ExecuteComponent = MeasureCall(NumCalls, [Character, &Sink]()
+			{
+				Sink += reinterpret_cast<UPTRINT>(IPlayerInterface::Execute_GetPlayerBuildingComponent(Character));
+			});
+		const TWeakObjectPtr<UBuildingComponent> CachedComponent = IPlayerInterface::Execute_GetPlayerBuildingComponent(Character);
+		const double CachedComponentCost = MeasureCall(NumCalls, [&CachedComponent, &Sink]()
+			{
+				Sink += reinterpret_cast<UPTRINT>(CachedComponent.Get());
+			});
+		UE_LOG(LogHopeDebug, Display, TEXT("GetPlayerBuildingComponent: Execute %.1f ns, cached %.1f ns (native: %s)"),
+			ExecuteComponent, CachedComponentCost,
+			IsNative(Character, GET_FUNCTION_NAME_CHECKED(IPlayerInterface, GetPlayerBuildingComponent)) ? TEXT("yes") : TEXT("no"));
+
+		UCharacterAnimInstance* AnimInstance = Cast<UCharacterAnimInstance>(Character->GetMesh()->GetAnimInstance());
+		if (AnimInstance)
+		{
+			// Passing the current gait back keeps the anim instance as it was.
+			const EGait Gait = AnimInstance->IncomingGait;
+			const double ExecuteGait = MeasureCall(NumCalls, [AnimInstance, Gait]()
+				{
+					IALSInterface::Execute_RecieveCurrentGait(AnimInstance, Gait);
+				});
+			const double NativeGait = MeasureCall(NumCalls, [AnimInstance, Gait]()
+				{
+					AnimInstance->RecieveCurrentGait_Implementation(Gait);
+				});
+			UE_LOG(LogHopeDebug, Display, TEXT("RecieveCurrentGait: Execute %.1f ns, native %.1f ns (native: %s)"),
+				ExecuteGait, NativeGait,
+				IsNative(AnimInstance, GET_FUNCTION_NAME_CHECKED(IALSInterface, RecieveCurrentGait)) ? TEXT("yes") : TEXT("no"));
+		}
+
+		UE_LOG(LogHopeDebug, Verbose, TEXT("Interface dispatch benchmark sink %llu"), static_cast<uint64>(Sink));
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(TEXT("Hope.Debug.InterfaceDispatchBenchmark"),
+		TEXT("Compares the per call cost of interface Execute_ calls on the local player with their native fast paths. Calls=<N>"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunBenchmark));
+}
+
+#endif // !UE_BUILD_SHIPPING
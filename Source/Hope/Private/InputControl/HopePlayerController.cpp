@@ -13,7 +13,10 @@
 #include "GameFramework/Character.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Building/BuildingComponent.h"
+#include "Building/BuildingSubsystem.h"
+#include "InputControl/HopeViewQuerySubsystem.h"
 #include "HopeInterfaces/BuildInterface.h"
+#include "HopeInterfaces/HopeInterfaceDispatch.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Camera/CameraComponent.h"
 #include "HopeInterfaces/ALSInterface.h"
@@ -36,7 +39,25 @@ void AHopePlayerController::Tick(float DeltaSeconds)
 {
 	Super::Tick(DeltaSeconds);
 
-	UInv_FunctionLibrary::TraceForItem(this, ItemTraceLength, ItemTraceChannel, ThisActor, LastActor, Inv_Widget);
+	// The inventory trace only has work to do when the actor under the crosshair changed since its last run,
+	// which the shared view ray answers without another trace.
+	FHitResult ItemHit;
+	UHopeViewQuerySubsystem* ViewQuery = UHopeViewQuerySubsystem::Get(this);
+	const bool bItemHit = ViewQuery && ViewQuery->GetViewHit(ItemTraceChannel, 0.f, ItemTraceLength, ItemHit);
+	const TWeakObjectPtr<AActor> ViewHitActor = bItemHit ? ItemHit.GetActor() : nullptr;
+	if (!ViewQuery || ViewHitActor != LastViewHitActor)
+	{
+		UInv_FunctionLibrary::TraceForItem(this, ItemTraceLength, ItemTraceChannel, ThisActor, LastActor, Inv_Widget);
+	}
+	LastViewHitActor = ViewHitActor;
+}
+
+void AHopePlayerController::ClientReceiveBuildingImpacts_Implementation(const FBuildingImpactUpdate& Update)
+{
+	if (UBuildingSubsystem* BuildingSubsystem = GetWorld()->GetSubsystem<UBuildingSubsystem>())
+	{
+		BuildingSubsystem->ReceiveImpactUpdate(Update);
+	}
 }
 
 void AHopePlayerController::BeginPlay()
@@ -140,38 +161,62 @@ void AHopePlayerController::Crouch()
 	IALSInterface::Execute_ToggleCrouch(GetPawn());
 }
 
+UBuildingComponent* AHopePlayerController::GetBuildingComponent()
+{
+	APawn* ControlledPawn = GetPawn();
+	if (BuildingComponentPawn != ControlledPawn)
+	{
+		BuildingComponentPawn = ControlledPawn;
+		bIsBuildingComponentNative = ControlledPawn && ControlledPawn->Implements<UPlayerInterface>()
+			&& HopeInterfaceDispatch::IsNative(ControlledPawn, GET_FUNCTION_NAME_CHECKED(IPlayerInterface, GetPlayerBuildingComponent));
+		CachedBuildingComponent = bIsBuildingComponentNative ? IPlayerInterface::Execute_GetPlayerBuildingComponent(ControlledPawn) : nullptr;
+	}
+
+	if (bIsBuildingComponentNative)
+	{
+		return CachedBuildingComponent.Get();
+	}
+	return ControlledPawn && ControlledPawn->Implements<UPlayerInterface>() ? IPlayerInterface::Execute_GetPlayerBuildingComponent(ControlledPawn) : nullptr;
+}
+
 void AHopePlayerController::EnableBuildingMode()
 {
-	IPlayerInterface::Execute_GetPlayerBuildingComponent(GetPawn())->StartBuildMode();
+	if (UBuildingComponent* BuildingComponent = GetBuildingComponent())
+	{
+		BuildingComponent->StartBuildMode();
+	}
 }
 
 void AHopePlayerController::SwitchBuildingUp()
 {
-	UBuildingComponent* BuildingComponent = IPlayerInterface::Execute_GetPlayerBuildingComponent(GetPawn());
+	UBuildingComponent* BuildingComponent = GetBuildingComponent();
+	if (!BuildingComponent) return;
 	BuildingComponent->BuildID = FMath::Clamp(BuildingComponent->BuildID + 1, 0, BuildingComponent->Buildables.Num() - 1);
 	BuildingComponent->ChangeBuildGhostMesh();
 }
 
 void AHopePlayerController::SwitchBuildingDown()
 {
-	UBuildingComponent* BuildingComponent = IPlayerInterface::Execute_GetPlayerBuildingComponent(GetPawn());
+	UBuildingComponent* BuildingComponent = GetBuildingComponent();
+	if (!BuildingComponent) return;
 	BuildingComponent->BuildID = FMath::Clamp(BuildingComponent->BuildID - 1, 0, BuildingComponent->Buildables.Num() - 1);
 	BuildingComponent->ChangeBuildGhostMesh();
 }
 
 void AHopePlayerController::PlaceBuilding()
 {
-	UBuildingComponent* BuildingComponent = IPlayerInterface::Execute_GetPlayerBuildingComponent(GetPawn());
-	if (BuildingComponent->bIsBuildModeOn && BuildingComponent->bCanBuild)
+	UBuildingComponent* BuildingComponent = GetBuildingComponent();
+	if (BuildingComponent && BuildingComponent->bIsBuildModeOn && BuildingComponent->bCanBuild)
 	{
 		BuildingComponent->SpawnBuilding_Server(BuildingComponent->Buildables[BuildingComponent->BuildID]->BuildingClass,
-			BuildingComponent->BuildTransform, GetPawn(), GetPawn());
+			BuildingComponent->BuildTransform, BuildingComponent->BuildStiltHeight);
 	}
 }
 
 void AHopePlayerController::RotateBuilding(const FInputActionValue& Value)
 {
-	UBuildingComponent* BuildingComponent = IPlayerInterface::Execute_GetPlayerBuildingComponent(GetPawn());
+	UBuildingComponent* BuildingComponent = GetBuildingComponent();
+	if (!BuildingComponent) return;
 	float InputFloatValue = Value.Get<float>();
 	if(InputFloatValue == 1) BuildingComponent->RotateBuildGhostMesh(BuildingRotationSpeed);
 	else BuildingComponent->RotateBuildGhostMesh(-BuildingRotationSpeed);
@@ -0,0 +1,129 @@
+// Copyright Sertim all rights reserved
+
+
+#include "InputControl/HopeViewQuerySubsystem.h"
+#include "Camera/CameraComponent.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+
+DECLARE_STATS_GROUP(TEXT("HopeView"), STATGROUP_HopeView, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("View Trace"), STAT_HopeViewTrace, STATGROUP_HopeView);
+DECLARE_DWORD_COUNTER_STAT(TEXT("View Traces"), STAT_HopeViewTraces, STATGROUP_HopeView);
+DECLARE_DWORD_COUNTER_STAT(TEXT("View Queries"), STAT_HopeViewQueries, STATGROUP_HopeView);
+
+namespace HopeView
+{
+	static float MinQueryDistance = 1000.0f;
+	FAutoConsoleVariableRef CVar_MinQueryDistance(TEXT("Hope.View.MinQueryDistance"), MinQueryDistance,
+		TEXT("Minimum length of the shared view trace. It grows to the longest distance requested."), ECVF_Default);
+}
+
+UHopeViewQuerySubsystem* UHopeViewQuerySubsystem::Get(const AActor* Actor)
+{
+	const APawn* Pawn = Cast<APawn>(Actor);
+	const APlayerController* PlayerController = Pawn ? Cast<APlayerController>(Pawn->GetController()) : Cast<APlayerController>(Actor);
+	if (!PlayerController || !PlayerController->IsLocalController())
+	{
+		return nullptr;
+	}
+	return ULocalPlayer::GetSubsystem<UHopeViewQuerySubsystem>(PlayerController->GetLocalPlayer());
+}
+
+UCameraComponent* UHopeViewQuerySubsystem::FindViewCamera()
+{
+	const APlayerController* PlayerController = GetLocalPlayer()->GetPlayerController(GetWorld());
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn)
+	{
+		return nullptr;
+	}
+
+	UCameraComponent* Camera = ViewCamera.Get();
+	if (!Camera || Camera->GetOwner() != Pawn)
+	{
+		Camera = Pawn->FindComponentByClass<UCameraComponent>();
+		ViewCamera = Camera;
+	}
+	return Camera;
+}
+
+void UHopeViewQuerySubsystem::UpdateCache(float RequiredDistance)
+{
+	UCameraComponent* Camera = FindViewCamera();
+	if (!Camera)
+	{
+		CachedHits.Reset();
+		bHasCache = false;
+		return;
+	}
+
+	const FVector Location = Camera->GetComponentLocation();
+	const FVector Direction = Camera->GetForwardVector();
+	if (bHasCache && CachedFrame == GFrameCounter && RequiredDistance <= CachedDistance
+		&& Location.Equals(CachedLocation) && Direction.Equals(CachedDirection))
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_HopeViewTrace);
+	INC_DWORD_STAT(STAT_HopeViewTraces);
+
+	CachedLocation = Location;
+	CachedDirection = Direction;
+	CachedDistance = FMath::Max3(CachedDistance, RequiredDistance, HopeView::MinQueryDistance);
+	CachedFrame = GFrameCounter;
+	bHasCache = true;
+
+	// Multi traces by object type report every hit as a touch, so the whole ray is collected in one query.
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(HopeViewQuery), false, Camera->GetOwner());
+	CachedHits.Reset();
+	GetWorld()->LineTraceMultiByObjectType(CachedHits, Location, Location + Direction * CachedDistance,
+		FCollisionObjectQueryParams(FCollisionObjectQueryParams::AllObjects), QueryParams);
+	CachedHits.Sort([](const FHitResult& A, const FHitResult& B) { return A.Distance < B.Distance; });
+}
+
+bool UHopeViewQuerySubsystem::GetViewHit(ECollisionChannel Channel, float MinDistance, float MaxDistance, FHitResult& OutHit)
+{
+	INC_DWORD_STAT(STAT_HopeViewQueries);
+	UpdateCache(MaxDistance);
+	if (!bHasCache)
+	{
+		OutHit = FHitResult();
+		return false;
+	}
+
+	const FVector TraceStart = CachedLocation + CachedDirection * MinDistance;
+	const FVector TraceEnd = CachedLocation + CachedDirection * MaxDistance;
+	const float TraceLength = FMath::Max(MaxDistance - MinDistance, UE_KINDA_SMALL_NUMBER);
+
+	// A channel trace stops at the first component that blocks its channel and passes through everything else.
+	for (const FHitResult& Hit : CachedHits)
+	{
+		if (Hit.Distance < MinDistance)
+		{
+			continue;
+		}
+		if (Hit.Distance > MaxDistance)
+		{
+			break;
+		}
+
+		const UPrimitiveComponent* Component = Hit.GetComponent();
+		if (Component && Component->GetCollisionResponseToChannel(Channel) == ECR_Block)
+		{
+			OutHit = Hit;
+			OutHit.bBlockingHit = true;
+			OutHit.TraceStart = TraceStart;
+			OutHit.TraceEnd = TraceEnd;
+			OutHit.Distance = Hit.Distance - MinDistance;
+			OutHit.Time = OutHit.Distance / TraceLength;
+			return true;
+		}
+	}
+
+	OutHit = FHitResult(TraceStart, TraceEnd);
+	OutHit.Location = TraceEnd;
+	OutHit.ImpactPoint = TraceEnd;
+	return false;
+}
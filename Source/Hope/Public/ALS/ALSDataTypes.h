@@ -42,6 +42,16 @@ enum class ERootYawOffsetMode : uint8
 	ERYOM_Accumulate UMETA(DisplayName = "Accumulate")
 };
 
+// How much a character matters to the local viewers, most significant first. Set by "UCharacterSignificanceSubsystem".
+UENUM(BlueprintType)
+enum class ESignificanceTier : uint8
+{
+	EST_Critical UMETA(DisplayName = "Critical"),
+	EST_High UMETA(DisplayName = "High"),
+	EST_Medium UMETA(DisplayName = "Medium"),
+	EST_Low UMETA(DisplayName = "Low")
+};
+
 USTRUCT(BlueprintType)
 struct HOPE_API FDirectionalAnimations
 {
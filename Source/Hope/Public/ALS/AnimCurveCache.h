@@ -0,0 +1,39 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimInstance;
+
+/**
+ * Curve values of one anim instance, each looked up at most once per update.
+ *
+ * The evaluated curves are only kept in a map by name, so there is no index to read them by. Names are registered
+ * once at initialization together with their hash, and reads go through the handle "Register" returned.
+ * The cache is invalidated at the start of every thread safe update, which is also when the curves last changed.
+ */
+struct FAnimCurveCache
+{
+	// Game thread, at initialization. Registering the same name again returns the same handle.
+	int32 Register(FName CurveName);
+
+	void Invalidate() { ++Serial; }
+
+	// Value of the curve in the last evaluated pose, 0 if it has none. Same thread the anim instance updates on.
+	float GetValue(const UAnimInstance& AnimInstance, int32 Handle);
+
+private:
+
+	struct FEntry
+	{
+		FName Name;
+		uint32 Hash = 0;
+		float Value = 0.f;
+		uint32 Serial = 0;
+	};
+
+	TArray<FEntry, TInlineAllocator<8>> Entries;
+
+	uint32 Serial = 1;
+};
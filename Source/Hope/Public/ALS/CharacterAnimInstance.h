@@ -11,12 +11,90 @@
 #include "Animation/AnimNodeReference.h"
 #include "Animation/AnimInstanceProxy.h"
 #include "GameplayEffectTypes.h"
+#include "ALS/CharacterLocomotionSubsystem.h"
+#include "ALS/CharacterFootProbeSubsystem.h"
+#include "ALS/AnimCurveCache.h"
 #include "CharacterAnimInstance.generated.h"
 
 class UCharacterMovementComponent;
 class ACharacterBase;
 class UAbilitySystemComponent;
 
+// Owner and movement state the thread safe update reads. Copied on the game thread in "FCharacterAnimInstanceProxy::PreUpdate".
+struct FCharacterAnimGameThreadData
+{
+	FVector ActorLocation = FVector::ZeroVector;
+	FRotator ActorRotation = FRotator::ZeroRotator;
+	FRotator BaseAimRotation = FRotator::ZeroRotator;
+	FVector Velocity = FVector::ZeroVector;
+
+	FVector CurrentAcceleration = FVector::ZeroVector;
+	FVector LastUpdateVelocity = FVector::ZeroVector;
+	// Gravity already scaled by the "GravityScale" of the movement component.
+	float GravityZ = 0.f;
+	float GroundFriction = 0.f;
+	float BrakingFriction = 0.f;
+	float BrakingFrictionFactor = 0.f;
+	float BrakingDecelerationWalking = 0.f;
+	bool bUseSeparateBrakingFriction = false;
+	bool bIsMovingOnGround = false;
+	bool bIsFalling = false;
+
+	ESignificanceTier SignificanceTier = ESignificanceTier::EST_Critical;
+
+	// Computed for all characters at once by "UCharacterLocomotionSubsystem".
+	FCharacterLocomotionResult Locomotion;
+
+	// Ground under the feet traced by "UCharacterFootProbeSubsystem", empty while foot placement is off.
+	FFootProbeResult LeftFootProbe;
+	FFootProbeResult RightFootProbe;
+};
+
+/**
+ * Per frame state of the "UCharacterAnimInstance" that its linked layers read, so they neither cast to it nor touch UObjects
+ * from worker threads. Published at the end of its thread safe update, the few values its state node functions change
+ * during the graph update are published again right away. Only the main anim instance writes it.
+ */
+struct FCharacterAnimSnapshot
+{
+	FVector WorldLocation = FVector::ZeroVector;
+	FVector LocalVelocity2D = FVector::ZeroVector;
+	FVector LocalAcceleration2D = FVector::ZeroVector;
+
+	// Movement values for stop and pivot prediction.
+	FVector CurrentAcceleration = FVector::ZeroVector;
+	FVector LastUpdateVelocity = FVector::ZeroVector;
+	float GroundFriction = 0.f;
+	float BrakingFriction = 0.f;
+	float BrakingFrictionFactor = 0.f;
+	float BrakingDecelerationWalking = 0.f;
+
+	float DisplacementSinceLastUpdate = 0.f;
+	float DisplacementSpeed = 0.f;
+	float RootYawOffset = 0.f;
+	float LastPivotTime = 0.f;
+	float TimeSinceFiredWeapon = 9999.0f;
+	float GroundDistance = -1.0f;
+	// Only published while "bUseFootPlacement" is true.
+	float DisableLegIKCurveValue = 0.f;
+
+	EGait CurrentGait = EGait::EG_Jogging;
+	ELocomotionDirections VelocityLocomotionDirection = ELocomotionDirections::ELD_Forward;
+	ELocomotionDirections AccelerationLocomotionDirection = ELocomotionDirections::ELD_Forward;
+	ESignificanceTier SignificanceTier = ESignificanceTier::EST_Critical;
+
+	bool bUseSeparateBrakingFriction = false;
+	bool bIsCrouching = false;
+	bool bIsOnGround = false;
+	bool bIsJumping = false;
+	bool bIsFalling = false;
+	bool bIsAccelerating = false;
+	bool bIsRunningIntoWall = false;
+	bool bUseFootPlacement = false;
+	bool bUseReducedGraph = false;
+	bool bIsServerAnimation = false;
+};
+
 USTRUCT()
 struct FCharacterAnimInstanceProxy : public FAnimInstanceProxy
 {
@@ -25,6 +103,7 @@ struct FCharacterAnimInstanceProxy : public FAnimInstanceProxy
 protected:
 
 	virtual void InitializeObjects(UAnimInstance* InAnimInstance) override;
+	virtual void ClearObjects() override;
 	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
 	virtual void Update(float DeltaSeconds) override;
 
@@ -42,6 +121,20 @@ public:
 	UPROPERTY(Transient)
 	class UCharacterMovementComponent* MovementComponent = nullptr;
 
+	FCharacterAnimGameThreadData GameThreadData;
+
+	FCharacterAnimSnapshot Snapshot;
+
+	// Slot in the locomotion subsystem of the world, INDEX_NONE in worlds without one.
+	TWeakObjectPtr<UCharacterLocomotionSubsystem> LocomotionSubsystem;
+	int32 LocomotionSlot = INDEX_NONE;
+
+	// Used instead of the subsystem's state while not registered, e.g. in the editor preview.
+	FCharacterLocomotionState LocomotionState;
+
+	// Slot in the foot probe subsystem of the world, INDEX_NONE on dedicated servers and in worlds without one.
+	TWeakObjectPtr<UCharacterFootProbeSubsystem> FootProbeSubsystem;
+	int32 FootProbeSlot = INDEX_NONE;
 };
 
 
@@ -74,12 +167,24 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "GameplayTags")
 	FGameplayTagBlueprintPropertyMap GameplayTagPropertyMap;
 
+	// Curves read during the update, registered in "NativeInitializeAnimation".
+	FAnimCurveCache CurveCache;
+	int32 TurnYawWeightCurve = INDEX_NONE;
+	int32 RemainingTurnYawCurve = INDEX_NONE;
+	int32 DisableLegIKCurve = INDEX_NONE;
+
 public:
 
 	UCharacterAnimInstance(const FObjectInitializer& ObjectInitializer);
 
 	virtual void InitializeWithAbilitySystem(UAbilitySystemComponent* ASC);
 
+	// Read by the linked layers during the graph update, which runs on the same thread as the update of this instance.
+	const FCharacterAnimSnapshot& GetAnimSnapshot() const { return Proxy.Snapshot; }
+
+	// Called by the linked layers when they enter a pivot. Publishes the new time to the snapshot as well.
+	void SetLastPivotTime(float InLastPivotTime);
+
 	/*
 	*		***********************	Update Functions ***********************
 	*/
@@ -87,6 +192,16 @@ public:
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "00.Setup")
 	bool bIsFirstUpdate = true;
 
+	/**
+	 * Set on dedicated servers while Hope.Anim.ServerAnimation is on. Only the work montages, root motion and gameplay states
+	 * depend on is done then. The graph skips its cosmetic layers while this is true.
+	 */
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "00.Setup")
+	bool bIsServerAnimation = false;
+
+	// Whether the anim instances of "Owner" run in server animation mode.
+	static bool ShouldUseServerAnimation(const AActor* Owner);
+
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "00.Setup")
 	float UpperBodyDynamicAdditiveWeight = 0.0f;
 
@@ -117,6 +232,9 @@ public:
 	UFUNCTION(meta = (ThreadSafe))
 	void UpdateBlendWeightData(float DeltaSeconds);
 
+	// Copies the state the linked layers read into "Proxy.Snapshot".
+	void PublishSnapshot();
+
 	UFUNCTION(Category = "StateNodeFunctions", BlueprintCallable, meta = (BlueprintThreadSafe))
 	void UpdateIdleState(const FAnimUpdateContext& Context, const FAnimNodeReference& Node);
 
@@ -346,9 +464,29 @@ public:
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States|Overlay State")
 	EOverlayState OverlayState;
 
+	// Only true up to "MaxFootPlacementTier".
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States")
 	bool bUseFootPlacement = false;
 
+	// Registers the character with "UCharacterFootProbeSubsystem". Only turn this on once the foot placement of the graph reads
+	// "LeftFootGround" and "RightFootGround" instead of tracing itself, otherwise every foot is traced twice.
+	UPROPERTY(EditDefaultsOnly, Category = "08.Character States|Foot Placement")
+	bool bUseFootProbes = false;
+
+	// Ground under each foot for the leg IK, traced for all characters at once. Empty while "bUseFootPlacement" or
+	// "bUseFootProbes" is false.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States|Foot Placement")
+	FFootProbeResult LeftFootGround;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States|Foot Placement")
+	FFootProbeResult RightFootGround;
+
+	UPROPERTY(EditDefaultsOnly, Category = "08.Character States|Foot Placement")
+	FName LeftFootBoneName = FName("foot_l");
+
+	UPROPERTY(EditDefaultsOnly, Category = "08.Character States|Foot Placement")
+	FName RightFootBoneName = FName("foot_r");
+
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States")
 	float TimeSinceFiredWeapon = 9999.0f;
 
@@ -406,6 +544,22 @@ public:
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "10.Skeletal Control", EditDefaultsOnly)
 	FName DisableLegIKCurveName = FName("DisableLegIK");
 
+	/* Significance */
+	// Set by "UCharacterSignificanceSubsystem" from distance, visibility and what the character is doing.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States|Significance")
+	ESignificanceTier SignificanceTier = ESignificanceTier::EST_Critical;
+
+	// The graph blends to its reduced branch while this is true, from "ReducedGraphTier" on.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "08.Character States|Significance")
+	bool bUseReducedGraph = false;
+
+	UPROPERTY(EditDefaultsOnly, Category = "08.Character States|Significance")
+	ESignificanceTier ReducedGraphTier = ESignificanceTier::EST_Low;
+
+	UPROPERTY(EditDefaultsOnly, Category = "08.Character States|Significance")
+	ESignificanceTier MaxFootPlacementTier = ESignificanceTier::EST_High;
+	/* Significance */
+
 	/*
 	*		***********************	08.Character States ***********************
 	*/
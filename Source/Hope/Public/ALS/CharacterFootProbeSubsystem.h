@@ -0,0 +1,82 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "CharacterFootProbeSubsystem.generated.h"
+
+class USkeletalMeshComponent;
+
+// Ground found under one foot by "UCharacterFootProbeSubsystem".
+USTRUCT(BlueprintType)
+struct FFootProbeResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector GroundLocation = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly)
+	FVector GroundNormal = FVector::UpVector;
+
+	UPROPERTY(BlueprintReadOnly)
+	bool bHasGround = false;
+};
+
+/**
+ * World subsystem tracing the ground under the feet of every registered character.
+ *
+ * The traces of all characters are issued together once per frame as async traces, and their results read back the
+ * frame after. A foot that stayed over the same spot keeps its last result instead of tracing again.
+ * Only characters marked eligible are probed, the anim instances mark them by their significance tier.
+ */
+UCLASS()
+class HOPE_API UCharacterFootProbeSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Game thread only. Returns the slot of the character, INDEX_NONE without a mesh.
+	int32 RegisterCharacter(USkeletalMeshComponent* Mesh, FName LeftFootBoneName, FName RightFootBoneName);
+	void UnregisterCharacter(int32 Slot);
+
+	// Game thread only. Characters that aren't eligible drop their results and stop tracing.
+	void SetEligible(int32 Slot, bool bIsEligible);
+
+	// Game thread only. Latest ground under both feet, returns false for unknown slots.
+	bool GetResults(int32 Slot, FFootProbeResult& OutLeftFoot, FFootProbeResult& OutRightFoot) const;
+
+private:
+
+	struct FFootProbe
+	{
+		FFootProbeResult Result;
+
+		// Trace issued last frame, read back on the next tick.
+		FTraceHandle PendingTrace;
+
+		// Foot location and frame of the last trace.
+		FVector ProbedLocation = FVector::ZeroVector;
+		uint64 ProbedFrame = 0;
+		bool bHasProbed = false;
+	};
+
+	struct FCharacterSlot
+	{
+		TWeakObjectPtr<USkeletalMeshComponent> Mesh;
+		FName FootBoneNames[2];
+		FFootProbe Feet[2];
+		bool bIsEligible = false;
+		bool bIsUsed = false;
+	};
+
+	TArray<FCharacterSlot> Slots;
+	TArray<int32> FreeSlots;
+};
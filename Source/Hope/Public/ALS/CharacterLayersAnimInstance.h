@@ -7,10 +7,14 @@
 #include "ALS/ALSDataTypes.h"
 #include "Animation/AnimExecutionContext.h"
 #include "Animation/AnimNodeReference.h"
+#include "ALS/AnimCurveCache.h"
+#include "ALS/LocomotionAnimData.h"
 #include "CharacterLayersAnimInstance.generated.h"
 
 class UCharacterAnimInstance;
 
+struct FCharacterAnimSnapshot;
+
 /**
  * Layers anim instance class connected to the "CharacterAnimInstance".
  */
@@ -18,17 +22,48 @@ UCLASS()
 class HOPE_API UCharacterLayersAnimInstance : public UAnimInstance
 {
 	GENERATED_BODY()
+
+public:
+
+	virtual void PostLoad() override;
 	
 protected:
 
+	virtual void NativeInitializeAnimation() override;
+	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 	virtual void NativeThreadSafeUpdateAnimation(float DeltaSeconds) override;
 
+	// Returns the main anim instance resolved on the game thread. Native code reads "GetMainSnapshot" instead.
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "00.Setup", meta = (ReturnDisplayName = "ReturnValue"), DisplayName = "GetABPCharacterBase", meta = (BlueprintThreadSafe))
 	UCharacterAnimInstance* GetCharacterAnimInstance();
 
+	// State of the main anim instance for this frame, or a default one while there is none.
+	const FCharacterAnimSnapshot& GetMainSnapshot() const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UCharacterAnimInstance> MainAnimInstance;
+
+	// Curves read during the update, registered in "NativeInitializeAnimation".
+	FAnimCurveCache CurveCache;
+	int32 ApplyHipfireOverridePoseCurve = INDEX_NONE;
+	int32 DisableRHandIKCurve = INDEX_NONE;
+	int32 DisableLHandIKCurve = INDEX_NONE;
+	int32 DisableLeftHandPoseOverrideCurve = INDEX_NONE;
+
 	UFUNCTION(meta = (ThreadSafe))
 	void UpdateBlendWeightData(float DeltaSeconds);
 
+	// Locomotion animations used while the current overlay state has none of its own.
+	UPROPERTY(EditAnywhere, Category = "00.Setup")
+	TObjectPtr<ULocomotionAnimData> DefaultLocomotionAnimData;
+
+	UPROPERTY(EditAnywhere, Category = "00.Setup")
+	TMap<EOverlayState, TObjectPtr<ULocomotionAnimData>> OverlayLocomotionAnimData;
+
+	// Data of the current overlay state, picked on the game thread. Null only while no data is assigned.
+	UPROPERTY(Transient)
+	TObjectPtr<ULocomotionAnimData> LocomotionAnimData;
+
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "00.Setup", EditDefaultsOnly)
 	FName LocomotionDistanceCurveName = FName("Distance");
 
@@ -36,15 +71,6 @@ protected:
 	*			************ Idle ***********
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "01.Idle")
-	UAnimSequence* IdleAnim;
-
-	UPROPERTY(EditAnywhere, Category = "01.Idle")
-	UAnimSequence* CrouchedIdleAnim;
-
-	UPROPERTY(EditAnywhere, Category = "01.Idle")
-	TArray<UAnimSequence*> IdleBreaksAnims;
-
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "01.Idle")
 	int32 CurrentIdleBreakIndex = 0;
 
@@ -102,12 +128,6 @@ protected:
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "02.Start", EditDefaultsOnly)
 	FVector2D PlayRateClampStartsPivots = FVector2D(0.6f, 5.f);
 
-	UPROPERTY(EditAnywhere, Category = "02.Start")
-	FDirectionalAnimations WalkStartAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "02.Start")
-	FDirectionalAnimations JogStartAnimations;
-
 	UFUNCTION(Category = "StateNodeFunctions", BlueprintCallable, meta = (BlueprintThreadSafe))
 	void SetupStartAnim(const FAnimUpdateContext& Context, const FAnimNodeReference& Node);
 
@@ -123,12 +143,6 @@ protected:
 	*			************ Cycle ***********
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "03.Cycle")
-	FDirectionalAnimations WalkCycleAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "03.Cycle")
-	FDirectionalAnimations JogCycleAnimations;
-
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "03.Cycle", EditDefaultsOnly)
 	FVector2D PlayRateClampCycle = FVector2D(0.8f, 1.2f);
 
@@ -147,12 +161,6 @@ protected:
 	*			************ Stop ***********
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "04.Stop")
-	FDirectionalAnimations WalkStopAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "04.Stop")
-	FDirectionalAnimations JogStopAnimations;
-
 	UFUNCTION(Category = "04.Stop", BlueprintCallable, meta = (BlueprintThreadSafe), BlueprintPure, meta = (ReturnDisplayName = "ReturnValue"))
 	bool ShouldDistanceMatchStop();
 
@@ -174,12 +182,6 @@ protected:
 	*			************ Pivot ***********
 	*/
 
-	UPROPERTY(EditAnywhere, Category = "05.Pivot")
-	FDirectionalAnimations WalkPivotAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "05.Pivot")
-	FDirectionalAnimations JogPivotAnimations;
-
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "05.Pivot")
 	FVector PivotStartingAcceleration = FVector::ZeroVector;
 
@@ -216,12 +218,6 @@ protected:
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "06.Turn In Place")
 	float TurnInPlaceTime = 0.f;
 
-	UPROPERTY(EditAnywhere, Category = "06.Turn In Place")
-	UAnimSequence* TurnRight90Anim;
-
-	UPROPERTY(EditAnywhere, Category = "06.Turn In Place")
-	UAnimSequence* TurnLeft90Anim;
-
 	UFUNCTION(Category = "StateNodeFunctions", BlueprintCallable, meta = (BlueprintThreadSafe))
 	void SetupTurnInPlaceEntry(const FAnimUpdateContext& Context, const FAnimNodeReference& Node);
 
@@ -245,39 +241,6 @@ protected:
 	*/
 
 
-	/*
-	*			************ Crouch ***********
-	*/
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	UAnimSequence* CrouchEnterAnim;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	UAnimSequence* CrouchExitAnim;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	FDirectionalAnimations CrouchStartAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	FDirectionalAnimations CrouchCycleAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	FDirectionalAnimations CrouchStopAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	FDirectionalAnimations CrouchPivotAnimations;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	UAnimSequence* CrouchTurnRight90Anim;
-
-	UPROPERTY(EditAnywhere, Category = "07.Crouch")
-	UAnimSequence* CrouchTurnLeft90Anim;
-
-	/*
-	*			************ Crouch ***********
-	*/
-
-
 	/*
 	*			************ Air ***********
 	*/
@@ -351,6 +314,18 @@ protected:
 	UPROPERTY(Transient, EditAnywhere, Category = "10.Skeletal Control")
 	bool DisableHandIK = false;
 
+	// Hand IK is disabled for characters less significant than this, see "UCharacterSignificanceSubsystem".
+	UPROPERTY(EditDefaultsOnly, Category = "10.Skeletal Control")
+	ESignificanceTier MaxHandIKTier = ESignificanceTier::EST_Medium;
+
+	// Copied from the main anim instance. The layers blend to their reduced branch while this is true.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "10.Skeletal Control")
+	bool bUseReducedGraph = false;
+
+	// Copied from the main anim instance. Idle breaks, hip fire weights, hand IK and cycle stride warping are skipped while true.
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "10.Skeletal Control")
+	bool bIsServerAnimation = false;
+
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "10.Skeletal Control", EditDefaultsOnly)
 	FName DisableRHandIKCurveName = FName("DisableRHandIK");
 
@@ -408,4 +383,61 @@ protected:
 	/*
 	*			************ Blend Weight Data ***********
 	*/
+
+private:
+
+#if WITH_EDITORONLY_DATA
+	// Animations set on the anim blueprint before they moved to "ULocomotionAnimData". Moved into a data asset generated
+	// inside the blueprint by "PostLoad", the blueprint only has to be resaved.
+	UPROPERTY()
+	UAnimSequence* IdleAnim_DEPRECATED = nullptr;
+	UPROPERTY()
+	UAnimSequence* CrouchedIdleAnim_DEPRECATED = nullptr;
+	UPROPERTY()
+	TArray<UAnimSequence*> IdleBreaksAnims_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations WalkStartAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations JogStartAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations SprintStartAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations WalkCycleAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations JogCycleAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations SprintCycleAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations WalkStopAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations JogStopAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations SprintStopAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations WalkPivotAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations JogPivotAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations SprintPivotAnimations_DEPRECATED;
+	UPROPERTY()
+	UAnimSequence* TurnRight90Anim_DEPRECATED = nullptr;
+	UPROPERTY()
+	UAnimSequence* TurnLeft90Anim_DEPRECATED = nullptr;
+	UPROPERTY()
+	UAnimSequence* CrouchEnterAnim_DEPRECATED = nullptr;
+	UPROPERTY()
+	UAnimSequence* CrouchExitAnim_DEPRECATED = nullptr;
+	UPROPERTY()
+	FDirectionalAnimations CrouchStartAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations CrouchCycleAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations CrouchStopAnimations_DEPRECATED;
+	UPROPERTY()
+	FDirectionalAnimations CrouchPivotAnimations_DEPRECATED;
+	UPROPERTY()
+	UAnimSequence* CrouchTurnRight90Anim_DEPRECATED = nullptr;
+	UPROPERTY()
+	UAnimSequence* CrouchTurnLeft90Anim_DEPRECATED = nullptr;
+#endif // WITH_EDITORONLY_DATA
 };
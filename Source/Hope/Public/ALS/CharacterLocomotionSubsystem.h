@@ -0,0 +1,158 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterLocomotionSubsystem.generated.h"
+
+class UCharacterLocomotionSubsystem;
+class UCharacterMovementComponent;
+class USkeletalMeshComponent;
+
+// Locomotion values of one character derived from its movement, read by "UCharacterAnimInstance" in its thread safe update.
+struct FCharacterLocomotionResult
+{
+	FVector LocalVelocity2D = FVector::ZeroVector;
+	FVector LocalAcceleration2D = FVector::ZeroVector;
+	FVector PivotDirection2D = FVector::ZeroVector;
+
+	// 2D distance moved since the last consumed result.
+	float DisplacementSinceLastUpdate = 0.f;
+
+	// Angle of the velocity and the acceleration relative to the actor's yaw, in degrees. 0 while they are nearly zero.
+	float VelocityLocomotionAngle = 0.f;
+	float AccelerationLocomotionAngle = 0.f;
+
+	bool bIsMoving = false;
+	bool bIsAccelerating = false;
+	bool bIsRunningIntoWall = false;
+};
+
+// State carried from one consumed result of a character to the next.
+struct FCharacterLocomotionState
+{
+	FVector LastLocation = FVector::ZeroVector;
+	FVector PivotDirection2D = FVector::ZeroVector;
+	bool bHasLastLocation = false;
+};
+
+// Runs the batched solve once per frame, after the movement and before the animation of every registered character.
+USTRUCT()
+struct FCharacterLocomotionTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	UCharacterLocomotionSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCharacterLocomotionTickFunction> : public TStructOpsTypeTraitsBase2<FCharacterLocomotionTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/**
+ * World subsystem computing the per frame locomotion values of every character anim instance in one pass.
+ *
+ * Once all registered movement components ticked, their location, yaw, velocity and acceleration are gathered into
+ * struct of arrays buffers and the derived values are computed four characters at a time with vector registers.
+ * Each anim instance picks its result up in "FCharacterAnimInstanceProxy::PreUpdate".
+ * Rotations are taken as yaw only, which is all a character's capsule ever has.
+ */
+UCLASS()
+class HOPE_API UCharacterLocomotionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Game thread only. Returns the slot of the character, INDEX_NONE if it has no movement component or mesh.
+	int32 RegisterCharacter(APawn* Owner, UCharacterMovementComponent* MovementComponent, USkeletalMeshComponent* Mesh);
+	void UnregisterCharacter(int32 Slot);
+
+	/**
+	 * Game thread only. Fills "OutResult" for the character of "Slot" and keeps its state for the next result.
+	 * A character the batch did not cover this frame is solved on its own. Returns false for unknown slots.
+	 */
+	bool ConsumeResult(int32 Slot, FCharacterLocomotionResult& OutResult);
+
+	// Scalar reference of the batched kernel. Updates "State" right away.
+	static void SolveSingle(FCharacterLocomotionState& State, const FVector& Location, float Yaw, const FVector& Velocity,
+		const FVector& Acceleration, FCharacterLocomotionResult& OutResult);
+
+private:
+
+	friend struct FCharacterLocomotionTickFunction;
+
+	struct FCharacterSlot
+	{
+		TWeakObjectPtr<APawn> Owner;
+		TWeakObjectPtr<UCharacterMovementComponent> MovementComponent;
+		TWeakObjectPtr<USkeletalMeshComponent> Mesh;
+
+		FCharacterLocomotionState State;
+
+		// Location gathered for the batch, becomes "State.LastLocation" once the result is consumed.
+		FVector GatheredLocation = FVector::ZeroVector;
+
+		// Lane of the last batch and the frame it was solved in.
+		int32 Lane = INDEX_NONE;
+		uint64 SolvedFrame = 0;
+
+		bool bIsUsed = false;
+	};
+
+	// Gathers the inputs of every registered character into the lanes and runs the kernel over them.
+	void SolveAll();
+
+	// Runs the kernel over "NumLanes", padded to a multiple of four.
+	void RunKernel(int32 NumLanes);
+
+	// Makes the movement of the slot tick before the solve and its mesh after it.
+	void AddPrerequisites(FCharacterSlot& CharacterSlot);
+	void RemovePrerequisites(FCharacterSlot& CharacterSlot);
+
+	FCharacterLocomotionTickFunction TickFunction;
+
+	TArray<FCharacterSlot> Slots;
+	TArray<int32> FreeSlots;
+
+	// Slot of each lane of the last batch.
+	TArray<int32> LaneSlots;
+
+	// Kernel inputs, one entry per lane.
+	TArray<float> DisplacementX;
+	TArray<float> DisplacementY;
+	TArray<float> Yaw;
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> AccelerationX;
+	TArray<float> AccelerationY;
+	TArray<float> PivotX;
+	TArray<float> PivotY;
+
+	// Kernel outputs, one entry per lane. Flags are stored as 1 or 0.
+	TArray<float> OutDisplacement;
+	TArray<float> OutLocalVelocityX;
+	TArray<float> OutLocalVelocityY;
+	TArray<float> OutLocalAccelerationX;
+	TArray<float> OutLocalAccelerationY;
+	TArray<float> OutVelocityAngle;
+	TArray<float> OutAccelerationAngle;
+	TArray<float> OutPivotX;
+	TArray<float> OutPivotY;
+	TArray<float> OutIsMoving;
+	TArray<float> OutIsAccelerating;
+	TArray<float> OutIsRunningIntoWall;
+};
@@ -0,0 +1,48 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ALS/ALSDataTypes.h"
+#include "CharacterSignificanceSubsystem.generated.h"
+
+class ACharacterBase;
+
+/**
+ * World subsystem scoring every "ACharacterBase" by distance to the local viewers, whether it was rendered and what it is doing.
+ *
+ * The resulting tier drives the update rate of the character's mesh, skipped frames being interpolated while it is visible,
+ * and the anim instances read it to switch to their reduced graph and drop foot placement and hand IK.
+ * Without a local viewer, e.g. on a dedicated server, every character keeps full fidelity.
+ */
+UCLASS()
+class HOPE_API UCharacterSignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Called by the characters when they begin and end play.
+	void RegisterCharacter(ACharacterBase* Character);
+	void UnregisterCharacter(ACharacterBase* Character);
+
+private:
+
+	// Scores every registered character against the current view points and applies the tiers that changed.
+	void UpdateSignificance();
+
+	ESignificanceTier CalculateTier(const ACharacterBase* Character, TConstArrayView<FVector> ViewLocations) const;
+
+	static void ApplyTier(ACharacterBase* Character, ESignificanceTier Tier);
+
+	TArray<TWeakObjectPtr<ACharacterBase>> Characters;
+
+	TArray<FVector> ViewLocations;
+
+	float TimeSinceUpdate = 0.f;
+};
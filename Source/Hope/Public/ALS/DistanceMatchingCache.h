@@ -0,0 +1,46 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAnimSequenceBase;
+struct FAnimUpdateContext;
+struct FSequenceEvaluatorReference;
+
+// Distance curve of one sequence sampled at a fixed time step, and its inverse sampled at a fixed distance step.
+struct FDistanceMatchingTable
+{
+	float TimeStep = 0.f;
+	float PlayLength = 0.f;
+	TArray<float> Distances;
+
+	float MinDistance = 0.f;
+	float MaxDistance = 0.f;
+	float DistanceStep = 0.f;
+	TArray<float> Times;
+
+	// Both clamp to the sampled range.
+	float GetDistance(float Time) const;
+	float GetTime(float Distance) const;
+};
+
+/**
+ * Inverted distance curves shared by every character, so distance matching is a table read instead of a curve search.
+ *
+ * The table of a sequence and curve is built the first time it is matched against, from whichever thread that is.
+ * Curves that don't increase over the sequence can't be inverted, they keep going through "UAnimDistanceMatchingLibrary".
+ */
+struct FDistanceMatchingCache
+{
+	// Same as the "UAnimDistanceMatchingLibrary" functions of the same name.
+	static void DistanceMatchToTarget(const FSequenceEvaluatorReference& SequenceEvaluator, float DistanceToTarget, FName DistanceCurveName);
+	static void AdvanceTimeByDistanceMatching(const FAnimUpdateContext& UpdateContext, const FSequenceEvaluatorReference& SequenceEvaluator,
+		float DistanceTraveled, FName DistanceCurveName, FVector2D PlayRateClamp = FVector2D(0.75f, 1.25f));
+
+	// Null if the curve is missing or can't be inverted.
+	static TSharedPtr<const FDistanceMatchingTable, ESPMode::ThreadSafe> FindOrBuildTable(const UAnimSequenceBase* Sequence, FName DistanceCurveName);
+
+	// Drops every table, e.g. after a distance curve was edited.
+	static void Reset();
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "WorldCollision.h"
 #include "HopeCharacterMovementComponent.generated.h"
 
 /**
@@ -65,6 +66,16 @@ protected:
 	// Cached ground info for the character.  Do not access this directly!  It's only updated when accessed via GetGroundInfo().
 	FHopeCharacterGroundInfo CachedGroundInfo;
 
+	// Ground trace issued by "GetGroundInfo" while not walking and the frame it was issued in.
+	// It can only be read back on the very next frame, so it is only issued while "GetGroundInfo" runs every frame.
+	FTraceHandle GroundTraceHandle;
+	uint64 GroundTraceFrame = 0;
+
+	// Last traced ground distance and the world time it was measured at. Extrapolated with the vertical velocity until
+	// the next result, or until it is older than "HopeCharacter.GroundExtrapolationTime".
+	float GroundResultDistance = 0.0f;
+	double GroundResultTime = -1.0;
+
 	UPROPERTY(Transient)
 	bool bHasReplicatedAcceleration = false;
 };
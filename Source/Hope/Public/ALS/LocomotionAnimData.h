@@ -0,0 +1,171 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ALS/ALSDataTypes.h"
+#include "LocomotionAnimData.generated.h"
+
+class UAnimSequence;
+
+// Locomotion states that pick a directional animation per gait, see "ULocomotionAnimData::SelectLocomotionAnim".
+enum class ELocomotionAnimSet : uint8
+{
+	ELAS_Start,
+	ELAS_Cycle,
+	ELAS_Stop,
+	ELAS_Pivot,
+	ELAS_MAX
+};
+
+/**
+ * Locomotion animations of one overlay state, shared by every "UCharacterLayersAnimInstance" using them.
+ *
+ * Nothing in here changes at runtime, the anim instances only hold a pointer to the data of their current overlay state.
+ * Start, cycle, stop, pivot and turn in place animations are flattened into tables on load, so selecting one is a single read.
+ */
+UCLASS(BlueprintType)
+class HOPE_API ULocomotionAnimData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif // WITH_EDITOR
+
+	UAnimSequence* SelectLocomotionAnim(ELocomotionAnimSet Set, EGait Gait, ELocomotionDirections Direction) const
+	{
+		return LocomotionAnimTable[(static_cast<int32>(Set) * NumLocomotionGaits + static_cast<int32>(Gait)) * NumLocomotionDirections + static_cast<int32>(Direction)];
+	}
+
+	UAnimSequence* SelectTurnInPlaceAnim(bool bIsCrouching, bool bTurnRight) const
+	{
+		return TurnInPlaceAnimTable[bIsCrouching ? 1 : 0][bTurnRight ? 1 : 0];
+	}
+
+	// Fills "LocomotionAnimTable" and "TurnInPlaceAnimTable" from the properties below. Call it after setting them from code.
+	void BuildTables();
+
+	/*
+	*			************ Idle ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "01.Idle")
+	UAnimSequence* IdleAnim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "01.Idle")
+	UAnimSequence* CrouchedIdleAnim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "01.Idle")
+	TArray<UAnimSequence*> IdleBreaksAnims;
+
+	/*
+	*			************ Start ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "02.Start")
+	FDirectionalAnimations WalkStartAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "02.Start")
+	FDirectionalAnimations JogStartAnimations;
+
+	// Entries left empty use the jog animation.
+	UPROPERTY(EditAnywhere, Category = "02.Start")
+	FDirectionalAnimations SprintStartAnimations;
+
+	/*
+	*			************ Cycle ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "03.Cycle")
+	FDirectionalAnimations WalkCycleAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "03.Cycle")
+	FDirectionalAnimations JogCycleAnimations;
+
+	// Entries left empty use the jog animation.
+	UPROPERTY(EditAnywhere, Category = "03.Cycle")
+	FDirectionalAnimations SprintCycleAnimations;
+
+	/*
+	*			************ Stop ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "04.Stop")
+	FDirectionalAnimations WalkStopAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "04.Stop")
+	FDirectionalAnimations JogStopAnimations;
+
+	// Entries left empty use the jog animation.
+	UPROPERTY(EditAnywhere, Category = "04.Stop")
+	FDirectionalAnimations SprintStopAnimations;
+
+	/*
+	*			************ Pivot ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "05.Pivot")
+	FDirectionalAnimations WalkPivotAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "05.Pivot")
+	FDirectionalAnimations JogPivotAnimations;
+
+	// Entries left empty use the jog animation.
+	UPROPERTY(EditAnywhere, Category = "05.Pivot")
+	FDirectionalAnimations SprintPivotAnimations;
+
+	/*
+	*			************ TurnInPlace ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "06.Turn In Place")
+	UAnimSequence* TurnRight90Anim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "06.Turn In Place")
+	UAnimSequence* TurnLeft90Anim = nullptr;
+
+	/*
+	*			************ Crouch ***********
+	*/
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	UAnimSequence* CrouchEnterAnim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	UAnimSequence* CrouchExitAnim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	FDirectionalAnimations CrouchStartAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	FDirectionalAnimations CrouchCycleAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	FDirectionalAnimations CrouchStopAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	FDirectionalAnimations CrouchPivotAnimations;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	UAnimSequence* CrouchTurnRight90Anim = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "07.Crouch")
+	UAnimSequence* CrouchTurnLeft90Anim = nullptr;
+
+private:
+
+	static constexpr int32 NumLocomotionGaits = 4;
+	static constexpr int32 NumLocomotionDirections = 4;
+
+	// Indexed by [set][gait][direction]. The sequences are kept alive by the properties the table was built from.
+	UAnimSequence* LocomotionAnimTable[static_cast<int32>(ELocomotionAnimSet::ELAS_MAX) * NumLocomotionGaits * NumLocomotionDirections] = {};
+
+	// Indexed by [crouching][turning right].
+	UAnimSequence* TurnInPlaceAnimTable[2][2] = {};
+};
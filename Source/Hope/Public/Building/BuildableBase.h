@@ -5,8 +5,12 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "HopeInterfaces/BuildInterface.h"
+#include "Building/BuildingComponent.h"
+#include "Building/BuildingImpactTypes.h"
 #include "BuildableBase.generated.h"
 
+class UInstancedStaticMeshComponent;
+
 UCLASS()
 class HOPE_API ABuildableBase : public AActor, public IBuildInterface
 {
@@ -28,7 +32,99 @@ public:
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Building Properties")
 	EBuildingType BuildingType;
 
+	// Taken from the current entry of "Tiers" when there is one.
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Building Properties")
+	float MaxHealth = 500.f;
+
+	// Material tier of the piece. Replicated as a single byte, the mesh and health come from "Tiers" on every machine.
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, ReplicatedUsing = OnRep_Tier, Category = "Building Properties")
+	EBuildingTier Tier = EBuildingTier::EBT_Twig;
+
+	// Tiers this piece can be upgraded to. Pieces without entries keep the mesh and "MaxHealth" set on the class.
+	UPROPERTY(EditDefaultsOnly, Category = "Building Properties")
+	TMap<EBuildingTier, FBuildingTierData> Tiers;
+
+	// Returns true if the piece has an entry for "NewTier" above its current tier.
+	bool CanUpgradeTo(EBuildingTier NewTier) const;
+
+	// Changes the tier of this piece in place. The damage taken is kept as a fraction of the new "MaxHealth".
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building Properties")
+	void SetTier(EBuildingTier NewTier);
+
+	// Damage taken so far. The piece is destroyed once it reaches "MaxHealth".
+	// Clients only see it as of the last impact update, in 1/255 steps of "MaxHealth".
+	UPROPERTY(BlueprintReadOnly, Category = "Building Properties")
+	float Damage = 0.f;
+
+	// Open state of doors and other pieces that can be opened. Saved and journaled with the piece.
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_IsOpen, Category = "Building Properties")
+	bool bIsOpen = false;
+
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building Properties")
+	void SetIsOpen(bool bNewIsOpen);
+
+	// Doors, windows and any piece currently open. Their collision moves with them, so they never fold into a compound.
+	bool CanOpen() const { return BuildingType == EBuildingType::EBT_Door || BuildingType == EBuildingType::EBT_Window || bIsOpen; }
+
+	// Height of the stilts under a foundation leveled on uneven ground, measured down from the actor origin.
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_StiltHeight, Category = "Building Properties")
+	float StiltHeight = 0.f;
+
+	// Stretched down from the footprint corners to fill "StiltHeight". Its pivot is expected at the bottom.
+	UPROPERTY(EditDefaultsOnly, Category = "Building Properties")
+	TObjectPtr<UStaticMesh> StiltMesh;
+
+	// Persistent ID assigned by the "UBuildingSubsystem" on the server. Kept across world saves.
+	uint32 PieceID = 0;
+
+	// Grid cell this piece is registered in by the "UBuildingSubsystem". Only valid on the server.
+	FIntPoint StreamingCell = FIntPoint::ZeroValue;
+
+	// Pieces are only relevant to a joining player once their cell has been streamed to it,
+	// and only up to the distance tier of their building type, see "EBuildingRelevancyTier".
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Called by the "UBuildingSubsystem" with the impacts of this piece aggregated over one net tick.
+	void ReceiveImpact(const FBuildingPieceImpact& Impact);
+
 protected:
 	
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Called on the server and on clients whenever "bIsOpen" changes, so Blueprints can play the open or close animation.
+	UFUNCTION(BlueprintImplementableEvent, Category = "Building Properties")
+	void OnOpenStateChanged();
+
+	// Called on clients and the listen server host so Blueprints can play hit effects. "ImpactLocation" is the last hit of the batch.
+	UFUNCTION(BlueprintImplementableEvent, Category = "Building Properties")
+	void OnImpacted(float DamageTakenFraction, int32 NumHits, FVector ImpactLocation);
+
+	// Called on the server and on clients after "Tier" changed and the new mesh was applied.
+	UFUNCTION(BlueprintImplementableEvent, Category = "Building Properties")
+	void OnTierChanged();
+
+private:
+
+	UFUNCTION()
+	void OnRep_IsOpen();
+
+	UFUNCTION()
+	void OnRep_StiltHeight();
+
+	UFUNCTION()
+	void OnRep_Tier();
+
+	// Swaps the mesh, materials and "MaxHealth" to the entry of "Tier" in "Tiers".
+	void ApplyTier();
+
+	// Places one stilt under every corner of "BaseMeshComponent", or removes them when "StiltHeight" is 0.
+	void UpdateStilts();
+
+	UPROPERTY(Transient)
+	TObjectPtr<UInstancedStaticMeshComponent> StiltComponent;
 };
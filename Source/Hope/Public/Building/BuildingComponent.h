@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "WorldCollision.h"
 #include "BuildingComponent.generated.h"
 
 class UCameraComponent;
@@ -23,6 +24,34 @@ enum class EBuildingType : uint8
 	EBT_Window UMETA(DisplayName = "Window")
 };
 
+// Material of a piece. Upgrading only changes the tier of the existing actor, see "ABuildableBase::SetTier".
+UENUM(BlueprintType)
+enum class EBuildingTier : uint8
+{
+	EBT_Twig UMETA(DisplayName = "Twig"),
+	EBT_Wood UMETA(DisplayName = "Wood"),
+	EBT_Stone UMETA(DisplayName = "Stone"),
+	EBT_Metal UMETA(DisplayName = "Metal")
+};
+
+// Look and health of a piece at one tier.
+USTRUCT(BlueprintType)
+struct HOPE_API FBuildingTierData
+{
+	GENERATED_BODY()
+
+	// Expected to keep the footprint of the other tiers, so snapping and support do not change with the tier.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Tier")
+	TObjectPtr<UStaticMesh> Mesh;
+
+	// Overrides by material slot. Empty uses the materials of "Mesh".
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Tier")
+	TArray<TObjectPtr<UMaterialInterface>> Materials;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Tier")
+	float MaxHealth = 500.f;
+};
+
 USTRUCT(BlueprintType)
 struct HOPE_API FBuildables : public FTableRowBase
 {
@@ -41,11 +70,38 @@ struct HOPE_API FBuildables : public FTableRowBase
 	EBuildingType BuildingType = EBuildingType::EBT_Foundation;
 };
 
+// Ground under a foundation footprint, evaluated from one batch of height samples.
+struct FFoundationGround
+{
+	// Transform the samples were taken for, before leveling.
+	FTransform Transform;
+
+	// Height the foundation is placed at and how far its stilts reach down from there.
+	float TopZ = 0.f;
+	float StiltHeight = 0.f;
+
+	bool bIsSnapped = false;
+	bool bIsValid = false;
+	bool bIsSupported = false;
+};
+
+// Time spent in each stage of the ghost updates. Only collected while the building benchmark asks for it.
+struct FBuildingGhostTimings
+{
+	double TraceSeconds = 0.0;
+	double SnapSeconds = 0.0;
+	double OverlapSeconds = 0.0;
+	double SupportSeconds = 0.0;
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), Blueprintable)
 class HOPE_API UBuildingComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
+	// Drives the ghost from scripted camera paths, see "BuildingBenchmark.cpp".
+	friend class FBuildingBenchmark;
+
 public:	
 
 	UBuildingComponent();
@@ -63,10 +119,13 @@ public:
 	UPROPERTY(BlueprintReadOnly, Replicated)
 	int32 BuildID = 0;
 
+	// Stilts needed under the foundation at "BuildTransform". Passed along when the piece is spawned.
+	float BuildStiltHeight = 0.f;
+
 	void ChangeBuildGhostMesh();
 
 	UFUNCTION(Server, Reliable)
-	void SpawnBuilding_Server(TSubclassOf<ABuildableBase> BuildingClass, const FTransform& Transform, AActor* Owner, APawn* Instigator);
+	void SpawnBuilding_Server(TSubclassOf<ABuildableBase> BuildingClass, const FTransform& Transform, float StiltHeight);
 
 	void RotateBuildGhostMesh(float YawRotation);
 
@@ -76,6 +135,21 @@ public:
 	UFUNCTION(Server, Reliable)
 	void InteractWithBuilding_Server();
 
+	// Upgrades the piece the player looks at to "NewTier". With "bWholeBase" every piece connected to it is upgraded too.
+	// Nothing changes unless "CanUpgradeBuilding" accepts the pieces and "PayForUpgrade" succeeds.
+	UFUNCTION(BlueprintCallable, Server, Reliable, Category = "Building System")
+	void UpgradeBuilding_Server(EBuildingTier NewTier, bool bWholeBase);
+
+	// Server side check of one piece of an upgrade. The native version needs a tier above the current one and a piece placed by
+	// the owner of this component. Pieces without an owner, loaded from a save or placed in the level, are open to anyone.
+	UFUNCTION(BlueprintNativeEvent, Category = "Building System")
+	bool CanUpgradeBuilding(const ABuildableBase* Building, EBuildingTier NewTier) const;
+
+	// Takes the cost of upgrading "Buildings" to "NewTier" once they passed "CanUpgradeBuilding". Returning false cancels
+	// the whole upgrade. The native version is free, override it to check and remove the resources.
+	UFUNCTION(BlueprintNativeEvent, Category = "Building System")
+	bool PayForUpgrade(const TArray<ABuildableBase*>& Buildings, EBuildingTier NewTier);
+
 protected:
 
 	virtual void BeginPlay() override;
@@ -132,4 +206,47 @@ protected:
 
 	UPROPERTY(EditAnywhere, Category = "Building System|Tags")
 	FName PillarTagName = FName("Pillar");
+
+
+	/*
+	*		***********************	Foundation Ground ***********************
+	*/
+
+	// Levels "BuildTransform" on the sampled ground and decides whether the foundation can stand there.
+	bool IsFoundationSupported(bool bIsSnapped);
+
+	// Sends one batch of async traces covering the footprint of the ghost at "BuildTransform". Results are read on a later update.
+	void RequestFoundationGroundSamples(bool bIsSnapped);
+
+	// Evaluates the batch sent earlier into "FoundationGround" once the trace results are available.
+	void ResolveFoundationGroundSamples();
+
+	// Samples per footprint side, so the batch has this value squared traces.
+	UPROPERTY(EditAnywhere, Category = "Building System|Foundation", meta = (ClampMin = 2, ClampMax = 8))
+	int32 FoundationSamplesPerSide = 3;
+
+	// Uneven ground is leveled with stilts up to this height. Steeper ground rejects the foundation.
+	UPROPERTY(EditAnywhere, Category = "Building System|Foundation")
+	float FoundationMaxStiltHeight = 150.f;
+
+	// Extra length of the sample traces above and below the stilt range.
+	UPROPERTY(EditAnywhere, Category = "Building System|Foundation")
+	float FoundationSampleMargin = 80.f;
+
+	// How far the ghost may move away from where the last samples were taken before they are ignored.
+	UPROPERTY(EditAnywhere, Category = "Building System|Foundation")
+	float FoundationSampleTolerance = 50.f;
+
+	TArray<FTraceHandle> FoundationTraceHandles;
+	FTransform FoundationTraceTransform;
+	bool bFoundationTraceSnapped = false;
+
+	FFoundationGround FoundationGround;
+
+	// Set by the building benchmark while it records, null otherwise.
+	FBuildingGhostTimings* GhostTimings = nullptr;
+
+	/*
+	*		***********************	Foundation Ground ***********************
+	*/
 };
@@ -0,0 +1,108 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/Actor.h"
+#include "BuildingCompound.generated.h"
+
+class ABuildableBase;
+class UBodySetup;
+
+// Range of the compound's shapes that came from one piece.
+struct FBuildingCompoundShape
+{
+	TWeakObjectPtr<ABuildableBase> Piece;
+
+	// Only set on the server, clients never receive piece IDs.
+	uint32 PieceID = 0;
+
+	// World bounds of the piece's collision, used to map hits and overlaps back to it.
+	FBox Bounds = FBox(ForceInit);
+
+	// Collision the piece had before it was folded, restored when it leaves the compound.
+	TEnumAsByte<ECollisionEnabled::Type> PieceCollisionEnabled = ECollisionEnabled::QueryAndPhysics;
+
+	// Navigation export setting of the piece before it was folded, restored with its collision.
+	TEnumAsByte<EHasCustomNavigableGeometry::Type> PieceNavigableGeometry = EHasCustomNavigableGeometry::Yes;
+};
+
+/**
+ * One static physics body holding the simple collision of every settled piece in a building cell.
+ * Folded pieces turn their own mesh collision off, so the physics scene sees one body per cell instead of one per piece.
+ * They keep exporting their geometry to the navmesh though, so folding never changes or dirties navigation.
+ * Snap boxes stay on the pieces, the building component needs them as separate components.
+ */
+UCLASS(NotBlueprintable, NotPlaceable)
+class HOPE_API UBuildingCompoundComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UBuildingCompoundComponent();
+
+	// Rebuilds the body from "Pieces". Pieces that are folded and not in "Pieces" get their own collision back.
+	void Rebuild(const TArray<ABuildableBase*>& Pieces);
+
+	bool ContainsPiece(const ABuildableBase* Piece) const;
+
+	// Returns the folded piece at "WorldLocation", usually the impact point of a hit on this component.
+	ABuildableBase* FindPieceAt(const FVector& WorldLocation) const;
+
+	// Adds the folded pieces whose bounds intersect "WorldBox".
+	void FindPiecesOverlapping(const FBox& WorldBox, TArray<AActor*>& OutPieces) const;
+
+	// Points "HitResult" at the piece that was hit if it hit a compound. Returns true if it was changed.
+	static bool ResolveHit(FHitResult& HitResult);
+
+	// Returns the piece that was hit if "HitResult" hit a compound, the hit actor otherwise.
+	static AActor* GetHitActor(const FHitResult& HitResult);
+
+	int32 GetNumShapes() const { return Shapes.Num(); }
+
+	/*UPrimitiveComponent*/
+	virtual UBodySetup* GetBodySetup() override { return CompoundBodySetup; }
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	/*UPrimitiveComponent end*/
+
+private:
+
+	// Returns true if the simple collision of "Piece" can be folded into this compound.
+	bool CanFold(const ABuildableBase* Piece) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UBodySetup> CompoundBodySetup;
+
+	TArray<FBuildingCompoundShape> Shapes;
+
+	FBox LocalBounds = FBox(ForceInit);
+
+	// Collision settings copied from the first folded piece. Pieces with other settings keep their own body.
+	bool bHasCollisionSettings = false;
+};
+
+/**
+ * Holds the compound body of one building cell. Spawned locally on the server and on clients by the "UBuildingSubsystem",
+ * never replicated.
+ */
+UCLASS(NotBlueprintable, NotPlaceable, Transient)
+class HOPE_API ABuildingCompoundActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+
+	ABuildingCompoundActor();
+
+	UBuildingCompoundComponent* GetCompoundComponent() const { return CompoundComponent; }
+
+	// Passes the damage on to the folded pieces that were hit.
+	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+private:
+
+	UPROPERTY(VisibleAnywhere)
+	TObjectPtr<UBuildingCompoundComponent> CompoundComponent;
+};
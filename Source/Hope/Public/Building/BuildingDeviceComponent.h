@@ -0,0 +1,78 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "BuildingDeviceComponent.generated.h"
+
+UENUM(BlueprintType)
+enum class EBuildingDeviceType : uint8
+{
+	EBDT_Generator UMETA(DisplayName = "Generator"),
+	EBDT_Consumer UMETA(DisplayName = "Consumer"),
+	EBDT_Switch UMETA(DisplayName = "Switch")
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnDevicePoweredChanged, bool, bIsPowered);
+
+/**
+ * Powered device of a base, such as a light, door, turret or heater. Added to the Blueprint of a buildable and wired
+ * to other devices with the "UBuildingDeviceSubsystem", which solves the network on the server.
+ * Devices never tick, they only hear back when their output flips.
+ */
+UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent), Blueprintable)
+class HOPE_API UBuildingDeviceComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UBuildingDeviceComponent();
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Device")
+	EBuildingDeviceType DeviceType = EBuildingDeviceType::EBDT_Consumer;
+
+	// Power a generator feeds into its network.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Device", meta = (EditCondition = "DeviceType == EBuildingDeviceType::EBDT_Generator"))
+	float PowerOutput = 50.f;
+
+	// Power a consumer needs to run. When a network is short of power, its consumers are served in the order they were placed.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Building Device", meta = (EditCondition = "DeviceType == EBuildingDeviceType::EBDT_Consumer"))
+	float PowerDemand = 10.f;
+
+	// Switches only pass power on while closed. This is the logic of a network, Blueprints set it from doors, sensors or timers.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Replicated, Category = "Building Device")
+	bool bIsClosed = true;
+
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category = "Building Device")
+	void SetClosed(bool bNewIsClosed);
+
+	// Output of the device as solved on the server: a consumer runs, a generator or closed switch carries power.
+	// Only replicated when it flips.
+	UPROPERTY(BlueprintReadOnly, ReplicatedUsing = OnRep_IsPowered, Category = "Building Device")
+	bool bIsPowered = false;
+
+	// Called by the "UBuildingDeviceSubsystem" when solving flips "bIsPowered".
+	void SetPowered(bool bNewIsPowered);
+
+	// Node of this device in the network graph of the "UBuildingDeviceSubsystem". Only valid on the server.
+	int32 NodeIndex = INDEX_NONE;
+
+	/*Delegates*/
+	// Broadcast on the server and on clients whenever "bIsPowered" flips.
+	UPROPERTY(BlueprintAssignable, Category = "Building Device")
+	FOnDevicePoweredChanged OnPoweredChanged;
+	/*Delegates end*/
+
+protected:
+
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+
+	UFUNCTION()
+	void OnRep_IsPowered();
+};
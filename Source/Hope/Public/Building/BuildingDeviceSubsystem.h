@@ -0,0 +1,95 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Building/BuildingDeviceComponent.h"
+#include "BuildingDeviceSubsystem.generated.h"
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnDeviceWireChanged, UBuildingDeviceComponent*, UBuildingDeviceComponent*, bool /*bConnected*/);
+
+// One device in the network graph.
+struct FBuildingDeviceNode
+{
+	// Null for free slots.
+	TWeakObjectPtr<UBuildingDeviceComponent> Device;
+
+	// Nodes this one is wired to. Every wire is stored on both of its ends.
+	TArray<int32, TInlineAllocator<4>> Wires;
+
+	// Copied from the device whenever it is marked dirty, so solving never touches the components.
+	float Supply = 0.f;
+	float Demand = 0.f;
+	EBuildingDeviceType Type = EBuildingDeviceType::EBDT_Consumer;
+
+	// False for open switches, which split the network they sit in.
+	bool bConducts = true;
+
+	bool bIsPowered = false;
+
+	// Solve pass this node was last reached in, so every network is only solved once per pass.
+	uint32 SolveMark = 0;
+};
+
+/**
+ * World subsystem that solves the power networks formed by wired "UBuildingDeviceComponent"s on the server.
+ *
+ * The graph lives in one array of nodes with their wires inline. Edits only mark the nodes they touch, and once per
+ * tick only the networks reachable from marked nodes are solved again, so idle devices cost nothing.
+ * A network powers its consumers in placement order until the supply of its generators runs out.
+ */
+UCLASS()
+class HOPE_API UBuildingDeviceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Called by the devices on the server when they begin and end play. Unregistering cuts all wires of the device.
+	void RegisterDevice(UBuildingDeviceComponent* Device);
+	void UnregisterDevice(UBuildingDeviceComponent* Device);
+
+	// Server only. Returns false if either device is not registered, they are already wired,
+	// or they are further apart than Hope.Devices.MaxWireLength.
+	UFUNCTION(BlueprintCallable, Category = "Building Devices")
+	bool ConnectDevices(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB);
+
+	UFUNCTION(BlueprintCallable, Category = "Building Devices")
+	void DisconnectDevices(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB);
+
+	// Called by a device whose output, demand or switch state changed. Its network is solved again on the next tick.
+	void MarkDeviceDirty(UBuildingDeviceComponent* Device);
+
+	// Fills "OutWires" with both ends of every wire, each wire once.
+	void GetWires(TArray<TPair<UBuildingDeviceComponent*, UBuildingDeviceComponent*>>& OutWires) const;
+
+	/*Delegates*/
+	// Broadcast when "ConnectDevices" or "DisconnectDevices" edit a wire. Wires cut by unregistering a device are not reported.
+	FOnDeviceWireChanged OnDeviceWireChanged;
+	/*Delegates end*/
+
+private:
+
+	// Copies the state of the device of "NodeIndex" and marks the node and everything wired to it for solving.
+	void MarkNodeDirty(int32 NodeIndex);
+
+	// Solves the network "StartNode" belongs to and adds the devices whose output flipped to "ChangedDevices".
+	void SolveNetwork(int32 StartNode);
+
+	bool IsValidNode(int32 NodeIndex) const { return Nodes.IsValidIndex(NodeIndex) && Nodes[NodeIndex].Device.IsValid(); }
+
+	TArray<FBuildingDeviceNode> Nodes;
+	TArray<int32> FreeNodes;
+	TArray<int32> DirtyNodes;
+
+	uint32 SolveMark = 0;
+
+	// Scratch of the current solve pass, kept to avoid allocations.
+	TArray<int32> NetworkNodes;
+	TArray<TWeakObjectPtr<UBuildingDeviceComponent>> ChangedDevices;
+};
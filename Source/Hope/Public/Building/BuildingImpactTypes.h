@@ -0,0 +1,63 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "BuildingImpactTypes.generated.h"
+
+class ABuildableBase;
+
+enum class EBuildingImpactFlags : uint8
+{
+	None = 0,
+	Destroyed = 1 << 0,
+	OpenStateChanged = 1 << 1
+};
+ENUM_CLASS_FLAGS(EBuildingImpactFlags);
+
+// Everything that happened to one piece since the last update of its base, quantized for the wire.
+USTRUCT()
+struct HOPE_API FBuildingPieceImpact
+{
+	GENERATED_BODY()
+
+	// Null on clients the piece is not relevant to, or once it has been destroyed.
+	UPROPERTY()
+	TObjectPtr<ABuildableBase> Piece = nullptr;
+
+	// Last impact on the piece, or its location for state changes.
+	UPROPERTY()
+	FVector_NetQuantize ImpactLocation = FVector::ZeroVector;
+
+	// Damage taken since the last update and health left, both in 1/255 of "MaxHealth".
+	UPROPERTY()
+	uint8 DamageTaken = 0;
+
+	UPROPERTY()
+	uint8 Health = 255;
+
+	UPROPERTY()
+	uint8 NumHits = 0;
+
+	// "EBuildingImpactFlags"
+	UPROPERTY()
+	uint8 Flags = 0;
+
+	float GetDamageTakenFraction() const { return DamageTaken / 255.f; }
+	float GetHealthFraction() const { return Health / 255.f; }
+	EBuildingImpactFlags GetFlags() const { return static_cast<EBuildingImpactFlags>(Flags); }
+};
+
+// One update per base and net tick, sent to every player the base is relevant to. A base is a building grid cell.
+USTRUCT()
+struct HOPE_API FBuildingImpactUpdate
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FIntPoint Cell = FIntPoint::ZeroValue;
+
+	UPROPERTY()
+	TArray<FBuildingPieceImpact> Pieces;
+};
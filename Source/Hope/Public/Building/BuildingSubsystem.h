@@ -0,0 +1,195 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Building/BuildingImpactTypes.h"
+#include "BuildingSubsystem.generated.h"
+
+class ABuildableBase;
+class ABuildingCompoundActor;
+class AGameModeBase;
+class APlayerController;
+enum class EBuildingType : uint8;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnBuildableRegistryChanged, ABuildableBase*);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnBuildingImpacts, const FBuildingImpactUpdate&);
+
+// How much of a base a viewer receives, by distance. Tier boundaries are set by the Hope.Building.*Distance console variables.
+enum class EBuildingRelevancyTier : uint8
+{
+	// Every piece, including doors and windows, plus damage and impact updates.
+	Near,
+	// Structural pieces only.
+	Mid,
+	// Foundations only, the footprint of the base.
+	Far,
+	Culled
+};
+
+// Pieces of one grid cell. Cells are the unit of join-time streaming.
+struct FBuildingCell
+{
+	TArray<TWeakObjectPtr<ABuildableBase>> Pieces;
+};
+
+// Compound body of one cell and the pieces that may be folded into it. Exists on the server and on clients.
+struct FBuildingCompoundCell
+{
+	TWeakObjectPtr<ABuildingCompoundActor> Actor;
+	TArray<TWeakObjectPtr<ABuildableBase>> Pieces;
+
+	// Time of the last added piece. The compound is rebuilt once the cell has settled.
+	double LastEditTime = 0.0;
+};
+
+// Join-time streaming state of one client connection.
+struct FBuildingStreamingConnection
+{
+	TWeakObjectPtr<APlayerController> PlayerController;
+
+	// Cells this connection is allowed to replicate.
+	TSet<FIntPoint> ReleasedCells;
+
+	// Cells still waiting to be released, sorted far to near so the nearest one is popped first.
+	TArray<FIntPoint> PendingCells;
+
+	// Bytes that can still be spent this frame. Refilled every Tick by "StreamBytesPerSecond".
+	float ByteAllowance = 0.f;
+
+	double JoinTime = 0.0;
+	double LastSortTime = 0.0;
+	bool bHasQueue = false;
+	bool bIsPlayable = false;
+
+	// Estimated size of the impact updates sent to this connection so far.
+	int64 ImpactBytesSent = 0;
+};
+
+// Impacts on one piece accumulated on the server until the next update of its base.
+struct FBuildingPendingImpact
+{
+	TWeakObjectPtr<ABuildableBase> Piece;
+	FVector ImpactLocation = FVector::ZeroVector;
+
+	// Fractions of the piece "MaxHealth".
+	float DamageTaken = 0.f;
+	float Health = 1.f;
+
+	int32 NumHits = 0;
+	EBuildingImpactFlags Flags = EBuildingImpactFlags::None;
+};
+
+/**
+ * World subsystem that keeps a registry of all placed buildables bucketed by grid cell.
+ * On the server it streams the cells to joining players nearest first, under a per-connection bandwidth budget,
+ * so a new player does not receive the whole world in whatever order the net driver picks.
+ * Damage and state changes of pieces are aggregated per cell and sent as one update per cell and net tick.
+ * Settled pieces of a cell are folded into one compound physics body, see "UBuildingCompoundComponent".
+ */
+UCLASS()
+class HOPE_API UBuildingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Returns the grid cell "Location" belongs to.
+	static FIntPoint GetCellForLocation(const FVector& Location);
+
+	static float GetCellSize();
+
+	// Distance beyond which no piece is replicated, see "EBuildingRelevancyTier".
+	static float GetFarDistance();
+
+	// Called by the buildables on the server when they begin and end play.
+	// Pieces without a "PieceID" get a new one, pieces restored from a save keep theirs.
+	void RegisterBuildable(ABuildableBase* Buildable);
+	void UnregisterBuildable(ABuildableBase* Buildable);
+
+	// Returns true if "Cell" has already been streamed to the connection owned by "Viewer".
+	// Viewers that are not tracked (listen server host, replays) always return true.
+	bool IsCellReleasedFor(const AActor* Viewer, const FIntPoint& Cell) const;
+
+	const TMap<FIntPoint, FBuildingCell>& GetCells() const { return Cells; }
+
+	// Server only. Fills "OutPieces" with "Piece" and every piece reachable from it through pieces whose meshes touch,
+	// which is the base it belongs to. Pieces are assumed to be smaller than a cell.
+	void GetConnectedPieces(ABuildableBase* Piece, TArray<ABuildableBase*>& OutPieces) const;
+
+	static EBuildingRelevancyTier GetRelevancyTier(const FVector& ViewLocation, const FVector& PieceLocation);
+
+	// Returns the furthest tier pieces of "BuildingType" are still replicated at.
+	static EBuildingRelevancyTier GetFurthestTier(EBuildingType BuildingType);
+
+	// Logs the pieces per tier and the estimated building bytes of every streaming connection.
+	void LogNetReport() const;
+
+	// Called by the buildables on the server and on clients. Added pieces are folded once their cell has settled,
+	// removed pieces leave the compound right away.
+	void AddToCompound(ABuildableBase* Buildable);
+	void RemoveFromCompound(ABuildableBase* Buildable);
+
+	// Rebuilds the compound of the cell of "Buildable" on the next tick, for pieces that changed their mesh in place.
+	// Every piece changed within one frame shares the rebuild.
+	void MarkCompoundDirty(ABuildableBase* Buildable);
+
+	// Server only. Adds an impact or state change of "Piece" to the next update of its cell.
+	void AddPieceImpact(ABuildableBase* Piece, float DamageTaken, const FVector& ImpactLocation, EBuildingImpactFlags Flags = EBuildingImpactFlags::None);
+
+	// Called on clients and the listen server host with an update sent by "SendImpactUpdates".
+	void ReceiveImpactUpdate(const FBuildingImpactUpdate& Update);
+
+	/*Delegates*/
+	FOnBuildableRegistryChanged OnBuildableRegistered;
+	FOnBuildableRegistryChanged OnBuildableUnregistered;
+
+	// Broadcast for every received impact update, after the pieces in it were notified. Meant for effects.
+	FOnBuildingImpacts OnBuildingImpacts;
+	/*Delegates end*/
+
+private:
+
+	void OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer);
+	void OnLogout(AGameModeBase* GameMode, AController* Exiting);
+
+	// Refills the byte allowance of every connection and releases its nearest pending cells.
+	void UpdateStreamingConnections(float DeltaTime);
+
+	// Sorts "Connection.PendingCells" far to near relative to "ViewLocation".
+	void SortPendingCells(FBuildingStreamingConnection& Connection, const FVector& ViewLocation) const;
+
+	// Estimated replication cost of the initial bunches of every piece in "Cell".
+	float GetCellStreamingCost(const FIntPoint& Cell) const;
+
+	// Marks "Connection" playable once no pending cell is left within "PlayableRadius" of "ViewLocation".
+	void CheckPlayable(FBuildingStreamingConnection& Connection, const FVector& ViewLocation);
+
+	// Rebuilds the compounds of the cells that have settled since their last edit.
+	void UpdateCompounds();
+	void RebuildCompound(const FIntPoint& Cell, FBuildingCompoundCell& CompoundCell);
+
+	// Sends one update per cell with pending impacts to every player it is relevant to, then clears them.
+	void SendImpactUpdates();
+
+	TMap<FIntPoint, FBuildingCell> Cells;
+
+	// Highest piece ID handed out or restored from a world save.
+	uint32 LastPieceID = 0;
+
+	TMap<const AActor*, FBuildingStreamingConnection> Connections;
+
+	TMap<FIntPoint, TArray<FBuildingPendingImpact>> PendingImpacts;
+
+	TMap<FIntPoint, FBuildingCompoundCell> CompoundCells;
+	TSet<FIntPoint> DirtyCompoundCells;
+
+	FDelegateHandle PostLoginHandle;
+	FDelegateHandle LogoutHandle;
+};
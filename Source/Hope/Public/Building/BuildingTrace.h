@@ -0,0 +1,68 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/**
+ * Profiling of the building pipeline. Every scope is both a cycle stat ("stat HopeBuilding") and a CPU event on the
+ * "HopeBuilding" trace channel of Unreal Insights (-trace=cpu,HopeBuilding). Counters are per frame.
+ *
+ * Everything compiles out when "HOPE_BUILDING_TRACE" is 0, which is the default in Shipping.
+ */
+
+#ifndef HOPE_BUILDING_TRACE
+#define HOPE_BUILDING_TRACE (CPUPROFILERTRACE_ENABLED && !UE_BUILD_SHIPPING)
+#endif
+
+#if HOPE_BUILDING_TRACE
+
+UE_TRACE_CHANNEL_EXTERN(HopeBuildingChannel, HOPE_API);
+
+DECLARE_STATS_GROUP(TEXT("HopeBuilding"), STATGROUP_HopeBuilding, STATCAT_Advanced);
+
+// Ghost pipeline
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ghost Update"), STAT_HopeBuilding_GhostUpdate, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Camera Trace"), STAT_HopeBuilding_CameraTrace, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Detect Build Boxes"), STAT_HopeBuilding_DetectBuildBoxes, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collision"), STAT_HopeBuilding_Collision, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Support"), STAT_HopeBuilding_Support, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Foundation Ground"), STAT_HopeBuilding_FoundationGround, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ghost Material"), STAT_HopeBuilding_GhostMaterial, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ghost Mesh"), STAT_HopeBuilding_GhostMesh, STATGROUP_HopeBuilding, HOPE_API);
+
+// Placement pipeline
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawn"), STAT_HopeBuilding_Spawn, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Register"), STAT_HopeBuilding_Register, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Impact Updates"), STAT_HopeBuilding_ImpactUpdates, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compound Rebuild"), STAT_HopeBuilding_CompoundRebuild, STATGROUP_HopeBuilding, HOPE_API);
+
+// Device networks
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Device Solve"), STAT_HopeBuilding_DeviceSolve, STATGROUP_HopeBuilding, HOPE_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_HopeBuilding_Traces, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlaps Returned"), STAT_HopeBuilding_Overlaps, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Snap Candidates Tested"), STAT_HopeBuilding_SnapCandidates, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Material Swaps"), STAT_HopeBuilding_MaterialSwaps, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Spawns"), STAT_HopeBuilding_Spawns, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact Updates Sent"), STAT_HopeBuilding_ImpactUpdatesSent, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impact Update Bytes (estimated)"), STAT_HopeBuilding_ImpactUpdateBytes, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Device Nodes Solved"), STAT_HopeBuilding_DeviceNodesSolved, STATGROUP_HopeBuilding, HOPE_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Device Outputs Flipped"), STAT_HopeBuilding_DeviceOutputsFlipped, STATGROUP_HopeBuilding, HOPE_API);
+
+// Times the rest of the enclosing scope, e.g. HOPE_BUILDING_SCOPE(CameraTrace) for "STAT_HopeBuilding_CameraTrace".
+#define HOPE_BUILDING_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_HopeBuilding_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("HopeBuilding." #Name, HopeBuildingChannel)
+
+#define HOPE_BUILDING_COUNT(Name, Amount) INC_DWORD_STAT_BY(STAT_HopeBuilding_##Name, Amount)
+
+#else
+
+#define HOPE_BUILDING_SCOPE(Name)
+#define HOPE_BUILDING_COUNT(Name, Amount)
+
+#endif // HOPE_BUILDING_TRACE
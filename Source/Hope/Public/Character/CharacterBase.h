@@ -116,6 +116,10 @@ public:
 
 	/* ALS Interface functions end */
 
+	// Set by "UCharacterSignificanceSubsystem", read by the anim instances on the game thread.
+	ESignificanceTier GetSignificanceTier() const { return SignificanceTier; }
+	void SetSignificanceTier(ESignificanceTier NewTier) { SignificanceTier = NewTier; }
+
 	/*
 	*		***********************	02.ALS ***********************
 	*/
@@ -142,6 +146,7 @@ public:
 protected:
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UPROPERTY()
 	TObjectPtr<UAbilitySystemComponent> AbilitySystemComponent;
@@ -165,6 +170,10 @@ protected:
 	UFUNCTION(NetMulticast, Reliable)
 	void UpdateCurrentGait_Client(EGait Gait);
 
+	// Passes "CurrentGait" to the anim instance of the mesh. Calls "UCharacterAnimInstance" natively unless a Blueprint
+	// overrides "RecieveCurrentGait", see "HopeInterfaceDispatch".
+	void SendCurrentGaitToAnimInstance();
+
 	// Modifies Character Movement variables according to the Settings passed in.
 	void SetGaitSettings(FGaitSettings* InSettings);
 
@@ -213,6 +222,12 @@ private:
 	UFUNCTION()
 	void OnRep_ReplicatedAcceleration();
 
+	// Anim instance the native check was made for. Checked again whenever the mesh gets a new one.
+	TWeakObjectPtr<UAnimInstance> GaitAnimInstance;
+	bool bIsGaitAnimInstanceNative = false;
+
+	ESignificanceTier SignificanceTier = ESignificanceTier::EST_Critical;
+
 	/*
 	*		***********************	02.ALS ***********************
 	*/
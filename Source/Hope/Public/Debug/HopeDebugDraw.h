@@ -0,0 +1,86 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Debug visualization of gameplay queries, switched per subsystem from the console:
+ *
+ *	Hope.Debug.Building, Hope.Debug.Interaction, Hope.Debug.GroundInfo, Hope.Debug.CameraTrace
+ *		1 draws the queries, 2 records their shapes into a history of the last Hope.Debug.QueryHistorySize queries, 3 does both.
+ *	Hope.Debug.DumpQueries [Seconds]
+ *		Logs the recorded history and draws it for a while, e.g. right after a hitch.
+ *
+ * A disabled category costs one load and branch per query. Everything compiles out when "HOPE_DEBUG_DRAW" is 0,
+ * which is the default in Shipping.
+ */
+
+#ifndef HOPE_DEBUG_DRAW
+#define HOPE_DEBUG_DRAW !UE_BUILD_SHIPPING
+#endif
+
+enum class EHopeDebugCategory : uint8
+{
+	Building,
+	Interaction,
+	GroundInfo,
+	CameraTrace,
+
+	Num
+};
+
+#if HOPE_DEBUG_DRAW
+
+class UObject;
+struct FHitResult;
+
+namespace HopeDebugDraw
+{
+	enum EMode : int32
+	{
+		Mode_Draw = 1 << 0,
+		Mode_Record = 1 << 1
+	};
+
+	// Backing values of the per category console variables.
+	extern HOPE_API int32 Modes[(int32)EHopeDebugCategory::Num];
+
+	FORCEINLINE bool IsEnabled(EHopeDebugCategory Category)
+	{
+		return Modes[(int32)Category] != 0;
+	}
+
+	// Draws and/or records a line query. "Hit" is null when nothing was hit.
+	HOPE_API void Line(EHopeDebugCategory Category, const UObject* WorldContext, const FVector& Start, const FVector& End, const FHitResult* Hit);
+
+	// Draws and/or records a box sweep or overlap.
+	HOPE_API void Box(EHopeDebugCategory Category, const UObject* WorldContext, const FVector& Start, const FVector& End,
+		const FVector& Extent, const FQuat& Rotation, const FHitResult* Hit);
+}
+
+// Wrapped in do/while so a call followed by a semicolon stays a single statement, even under an unbraced if/else.
+#define HOPE_DEBUG_LINE(Category, WorldContext, Start, End, Hit) \
+	do \
+	{ \
+		if (HopeDebugDraw::IsEnabled(EHopeDebugCategory::Category)) \
+		{ \
+			HopeDebugDraw::Line(EHopeDebugCategory::Category, WorldContext, Start, End, Hit); \
+		} \
+	} while (0)
+
+#define HOPE_DEBUG_BOX(Category, WorldContext, Start, End, Extent, Rotation, Hit) \
+	do \
+	{ \
+		if (HopeDebugDraw::IsEnabled(EHopeDebugCategory::Category)) \
+		{ \
+			HopeDebugDraw::Box(EHopeDebugCategory::Category, WorldContext, Start, End, Extent, Rotation, Hit); \
+		} \
+	} while (0)
+
+#else
+
+#define HOPE_DEBUG_LINE(Category, WorldContext, Start, End, Hit) do {} while (0)
+#define HOPE_DEBUG_BOX(Category, WorldContext, Start, End, Extent, Rotation, Hit) do {} while (0)
+
+#endif // HOPE_DEBUG_DRAW
@@ -7,11 +7,31 @@
 #include "HopeSaveGame.generated.h"
 
 /**
- * 
+ * Small save game object stored through "UGameplayStatics::SaveGameToSlot".
+ * Built structures are not serialized here, they live in the chunked world file referenced by "WorldFileName".
  */
 UCLASS()
 class HOPE_API UHopeSaveGame : public USaveGame
 {
 	GENERATED_BODY()
-	
+
+public:
+
+	// Version of the chunked world file this slot was written with.
+	UPROPERTY()
+	int32 WorldSaveVersion = 0;
+
+	// Name of the chunked world file, relative to the SaveGames directory.
+	UPROPERTY()
+	FString WorldFileName;
+
+	UPROPERTY()
+	int32 NumPieces = 0;
+
+	UPROPERTY()
+	FDateTime SaveTime;
+
+	// First journal segment that is not part of the world file. Replayed on top of it after a crash.
+	UPROPERTY()
+	int32 JournalSegment = 0;
 };
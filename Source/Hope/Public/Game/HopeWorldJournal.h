@@ -0,0 +1,159 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/CircularQueue.h"
+#include "Game/HopeWorldSaveTypes.h"
+
+class FRunnableThread;
+class IFileHandle;
+
+/**
+ * Append-only journal of world mutations, replayed on top of the last autosave after a crash.
+ *
+ * The journal is split into numbered segment files (<Slot>.<Segment>.hwj). An autosave starts a new segment and,
+ * once written, deletes the segments it covers. Every segment starts with the classes it references, so it can
+ * be read without the ones before it.
+ *
+ *	[FHopeJournalSegmentHeader]
+ *	[FHopeJournalEntry]...		DefineClass entries are followed by PayloadSize bytes of UTF-8 class path
+ *
+ * Entries carry the whole piece record or wire, so replaying an entry twice is harmless.
+ */
+
+namespace HopeWorldJournal
+{
+	static constexpr uint32 Magic = 0x4C4A5748; // "HWJL"
+	static constexpr uint32 CurrentVersion = 1;
+	static const TCHAR* FileExtension = TEXT(".hwj");
+}
+
+enum class EHopeJournalOp : uint8
+{
+	None,
+	DefineClass,
+	Place,
+	Destroy,
+	Damage,
+	DoorState,
+	Upgrade,
+	Connect,
+	Disconnect,
+
+	// Only used between the game thread and the writer, never written to disk.
+	Rotate,
+	Truncate
+};
+
+struct FHopeJournalSegmentHeader
+{
+	uint32 Magic = HopeWorldJournal::Magic;
+	uint32 Version = HopeWorldJournal::CurrentVersion;
+	uint32 Segment = 0;
+	uint32 Reserved = 0;
+};
+static_assert(sizeof(FHopeJournalSegmentHeader) == 16, "FHopeJournalSegmentHeader layout is part of the save format");
+
+struct FHopeJournalEntry
+{
+	uint64 Sequence = 0;
+
+	// CRC32 of the entry (with this field zeroed) and its payload. Entries torn by a crash fail the check and end the replay.
+	uint32 Crc = 0;
+
+	EHopeJournalOp Op = EHopeJournalOp::None;
+	uint8 Reserved = 0;
+	uint16 PayloadSize = 0;
+
+	// DefineClass only uses ClassIndex, Destroy only PieceID. Connect and Disconnect store a FHopeDeviceWireRecord
+	// at the start of it instead, see "GetWire".
+	FHopeBuildablePieceRecord Record;
+
+	FHopeDeviceWireRecord GetWire() const
+	{
+		FHopeDeviceWireRecord Wire;
+		FMemory::Memcpy(&Wire, &Record, sizeof(Wire));
+		return Wire;
+	}
+};
+static_assert(sizeof(FHopeJournalEntry) == 64, "FHopeJournalEntry layout is part of the save format");
+static_assert(sizeof(FHopeDeviceWireRecord) <= sizeof(FHopeBuildablePieceRecord), "Wires are stored in place of the piece record");
+
+// One mutation as pushed by the game thread.
+struct FHopeJournalMutation
+{
+	EHopeJournalOp Op = EHopeJournalOp::None;
+
+	// Segment to open for Rotate, first segment to keep for Truncate.
+	uint32 Segment = 0;
+
+	FHopeBuildablePieceRecord Record;
+
+	// Only set for Connect and Disconnect.
+	FHopeDeviceWireRecord Wire;
+
+	// Only set for DefineClass. Resolved to a string on the writer thread.
+	FTopLevelAssetPath ClassPath;
+};
+
+/**
+ * Owns the ring buffer the game thread pushes mutations into and the background thread that writes them out in batches.
+ */
+class HOPE_API FHopeWorldJournal : public FRunnable
+{
+public:
+
+	// "BaseFilePath" is the path of the segment files without the segment number and extension.
+	FHopeWorldJournal(const FString& InBaseFilePath, uint32 FirstSegment);
+	virtual ~FHopeWorldJournal() override;
+
+	// Game thread only. Costs a ring buffer push, unless the writer fell behind and the ring is full.
+	void Push(const FHopeJournalMutation& Mutation);
+
+	// Game thread only. Moves mutations that did not fit into the ring last time.
+	void FlushOverflow();
+
+	static FString GetSegmentFilePath(const FString& BaseFilePath, uint32 Segment);
+
+	// Returns the highest segment number on disk, 0 if there is none.
+	static uint32 FindLastSegment(const FString& BaseFilePath);
+
+	// Reads every valid entry of the segments starting at "FirstSegment", oldest first.
+	static void ReadSegments(const FString& BaseFilePath, uint32 FirstSegment,
+		TFunctionRef<void(const FHopeJournalEntry& Entry, const FString& ClassPath)> Visitor);
+
+	/*FRunnable*/
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	/*FRunnable end*/
+
+private:
+
+	// Writer thread only, everything below.
+	void Drain();
+	void WriteEntry(FHopeJournalEntry& Entry, const FString& ClassPath);
+	void OpenSegment(uint32 NewSegment);
+	void CloseSegment();
+	void DeleteSegmentsBefore(uint32 KeepSegment);
+
+	FString BaseFilePath;
+
+	TCircularQueue<FHopeJournalMutation> Queue;
+
+	// Game thread only. Keeps the push order while the ring is full.
+	TArray<FHopeJournalMutation> Overflow;
+
+	FEvent* WakeEvent = nullptr;
+	FRunnableThread* Thread = nullptr;
+	TAtomic<bool> bStopping { false };
+
+	IFileHandle* File = nullptr;
+	uint32 Segment = 0;
+	uint64 NextSequence = 1;
+	TArray<uint8> Buffer;
+
+	// Every class defined so far, by class index. Written again at the start of each segment.
+	TArray<FString> ClassPaths;
+};
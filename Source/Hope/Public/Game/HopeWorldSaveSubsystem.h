@@ -0,0 +1,277 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/Future.h"
+#include "Game/HopeWorldSaveTypes.h"
+#include "Game/HopeWorldJournal.h"
+#include "HopeWorldSaveSubsystem.generated.h"
+
+class ABuildableBase;
+class AGameModeBase;
+class APlayerController;
+class UBuildingDeviceComponent;
+
+DECLARE_STATS_GROUP(TEXT("HopeSave"), STATGROUP_HopeSave, STATCAT_Advanced);
+
+// Full copy of the saved world, owned by the autosave worker. Dirty records are merged into it before every write.
+struct FHopeWorldSaveImage
+{
+	TMap<uint32, FHopeBuildablePieceRecord> Pieces;
+	TArray<FString> ClassPaths;
+	TMap<FString, FHopePlayerSaveRecord> Players;
+	TArray<FHopeDeviceWireRecord> Wires;
+};
+
+// Records that changed since the last autosave, captured on the game thread.
+struct FHopeWorldSaveDelta
+{
+	TArray<FHopeBuildablePieceRecord> DirtyPieces;
+	TArray<uint32> RemovedPieces;
+	TArray<FString> NewClassPaths;
+	TArray<FHopePlayerSaveRecord> Players;
+
+	// Replaces the wires of the image when set. Left unset while a load still has wires to restore.
+	TArray<FHopeDeviceWireRecord> Wires;
+	bool bHasWires = false;
+};
+
+struct FHopeAutosaveResult
+{
+	// INDEX_NONE if the write failed.
+	int64 BytesWritten = INDEX_NONE;
+	int32 NumPieces = 0;
+};
+
+/**
+ * Server side subsystem that saves and loads placed buildables using the chunked world format (see "HopeWorldSaveTypes.h").
+ * Loading maps the world file, spawns the cells near players right away and materializes the rest time-sliced.
+ * Autosaving only snapshots dirty records on the game thread, merging, compression and the file write run on a worker.
+ * Mutations between autosaves go to a write-ahead journal (see "HopeWorldJournal.h") that is replayed after a crash.
+ * Wires of the "UBuildingDeviceSubsystem" are saved by piece ID and connected again once every loaded chunk is spawned.
+ */
+UCLASS()
+class HOPE_API UHopeWorldSaveSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Writes every registered buildable to the world file of "SlotName" and stores the "UHopeSaveGame" that references it.
+	UFUNCTION(BlueprintCallable, Category = "World Save")
+	bool SaveWorld(const FString& SlotName);
+
+	// Maps the world file of "SlotName" and starts materializing its chunks, nearest to players first.
+	UFUNCTION(BlueprintCallable, Category = "World Save")
+	bool LoadWorld(const FString& SlotName);
+
+	// Snapshots the dirty records and hands them to the autosave worker. Does nothing while the previous autosave is still writing.
+	UFUNCTION(BlueprintCallable, Category = "World Save")
+	bool Autosave();
+
+	// Loads the last autosave and replays the journal written since on top of it. Called on begin play unless "Hope.Save.RecoverOnStart" is 0.
+	UFUNCTION(BlueprintCallable, Category = "World Save")
+	bool RecoverWorld();
+
+	UFUNCTION(BlueprintPure, Category = "World Save")
+	bool IsLoading() const { return PendingChunks.Num() > 0; }
+
+	// While suspended nothing is journaled, marked dirty or saved, for tools that spawn pieces which must not end up in the save.
+	// Pieces placed, changed or destroyed in the meantime are missed, the tool is expected to remove what it spawned first.
+	void SetSuspended(bool bNewIsSuspended) { bIsSuspended = bNewIsSuspended; }
+	bool IsSuspended() const { return bIsSuspended; }
+
+	// Call this whenever a placed piece changes in a way that has to be saved.
+	void MarkPieceDirty(ABuildableBase* Buildable);
+
+	// Marks the piece dirty and appends its current state to the journal. "Op" is one of the piece mutations (Damage, DoorState).
+	void RecordPieceMutation(ABuildableBase* Buildable, EHopeJournalOp Op);
+
+	// Returns the absolute path of the chunked world file used by "SlotName".
+	static FString GetWorldFilePath(const FString& SlotName);
+
+	// Copies every registered buildable, player and wire into fixed-size records. Must be called on the game thread.
+	void CaptureWorld(TArray<FHopeBuildablePieceRecord>& OutRecords, TArray<FString>& OutClassPaths, TArray<FHopePlayerSaveRecord>& OutPlayers,
+		TArray<FHopeDeviceWireRecord>& OutWires) const;
+
+	static void CaptureRecord(const ABuildableBase* Buildable, uint16 ClassIndex, FHopeBuildablePieceRecord& OutRecord);
+
+	void CaptureWires(TArray<FHopeDeviceWireRecord>& OutWires) const;
+
+	// Returns false if either device does not sit on a placed piece.
+	static bool CaptureWire(const UBuildingDeviceComponent* DeviceA, const UBuildingDeviceComponent* DeviceB, FHopeDeviceWireRecord& OutRecord);
+
+	static bool CapturePlayerRecord(const APlayerController* PlayerController, FHopePlayerSaveRecord& OutRecord);
+
+	static FString GetPlayerSaveID(const APlayerController* PlayerController);
+
+	// Serializes the records into the chunked world format. Only touches the data passed in, so it can run on any thread.
+	static void WriteWorldFile(TArray<uint8>& OutBuffer, TArray<FHopeBuildablePieceRecord>& Records, const TArray<FString>& ClassPaths,
+		const TArray<FHopePlayerSaveRecord>& Players, const TArray<FHopeDeviceWireRecord>& Wires);
+
+	// Wraps a world file in the Oodle compressed autosave container.
+	static bool CompressWorldFile(const TArray<uint8>& WorldFile, TArray<uint8>& OutBuffer);
+
+private:
+
+	/*
+	*		***********************	Load ***********************
+	*/
+
+	// Maps or reads the world file, inflating it if it is compressed, and parses it.
+	bool OpenWorldFile(const FString& FilePath);
+
+	// Validates the header and offsets of a world file and resolves its class table.
+	bool ParseWorldFile(const uint8* Data, int64 Size);
+
+	// Applies the journal segments starting at "FirstSegment" on top of the opened world file.
+	void ReplayJournal(uint32 FirstSegment);
+
+	// Seeds the autosave image, places the players that are already in and spawns what is near them.
+	void StartLoading();
+
+	// Destroys the pieces of the current world so the loaded ones don't spawn on top of them with the same IDs.
+	void ClearBuildables();
+
+	// Spawns chunks until the time budget is spent. Chunks near players are always spawned.
+	void MaterializePendingChunks(double TimeBudgetSeconds);
+
+	void MaterializeChunk(const FHopeWorldSaveChunk& Chunk);
+
+	void SpawnPiece(const FHopeBuildablePieceRecord& Record);
+
+	void SortPendingChunks(const TArray<FVector>& PlayerLocations);
+
+	bool IsChunkNearPlayers(const FHopeWorldSaveChunk& Chunk, const TArray<FVector>& PlayerLocations) const;
+
+	void GetPlayerLocations(TArray<FVector>& OutLocations) const;
+
+	void FinishLoading();
+
+	// Connects "PendingWires" between the devices of the spawned pieces. Wires missing a piece or device are dropped.
+	void RestoreWires();
+
+	void OnPostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer);
+
+	// Places the pawn of a returning player where it was saved.
+	UFUNCTION()
+	void OnPlayerPawnChanged(APawn* OldPawn, APawn* NewPawn);
+
+	// Chunks of the mapped world file that are not spawned yet, sorted far to near.
+	TArray<const FHopeWorldSaveChunk*> PendingChunks;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	// Used when the platform can not map files, or the file is compressed.
+	TArray<uint8> LoadedFileData;
+
+	FHopeWorldSaveHeader LoadedHeader;
+	const FHopeBuildablePieceRecord* LoadedPieces = nullptr;
+
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<ABuildableBase>> LoadedClasses;
+
+	TArray<FString> LoadedClassPaths;
+
+	// Pieces placed or changed by the replayed journal, and pieces it destroyed. Both win over the world file.
+	TMap<uint32, FHopeBuildablePieceRecord> ReplayedPieces;
+	TSet<uint32> ReplayedRemovals;
+
+	// Players of the last loaded save that have not been placed yet.
+	TMap<FString, FTransform> SavedPlayerTransforms;
+
+	// Wires of the loaded world and the replayed journal, restored once the load is done.
+	TArray<FHopeDeviceWireRecord> PendingWires;
+
+	double LoadStartTime = 0.0;
+	double LastSortTime = 0.0;
+	int32 NumMaterializedPieces = 0;
+	bool bIsMaterializing = false;
+	bool bIsSuspended = false;
+
+	FDelegateHandle PostLoginHandle;
+
+	/*
+	*		***********************	Load ***********************
+	*/
+
+
+	/*
+	*		***********************	Autosave ***********************
+	*/
+
+	void OnBuildableRegistered(ABuildableBase* Buildable);
+	void OnBuildableUnregistered(ABuildableBase* Buildable);
+	void OnDeviceWireChanged(UBuildingDeviceComponent* DeviceA, UBuildingDeviceComponent* DeviceB, bool bConnected);
+
+	// Gives the autosave worker a copy of the loaded world so the next autosave does not start from an empty image.
+	void SeedAutosaveImage();
+
+	// Returns the index of "Class" in the class table shared with the autosave image and the journal.
+	uint16 GetClassIndex(const UClass* Class);
+
+	// Waits for the running autosave task and reports its stats.
+	void FinishAutosaveTask();
+
+	TMap<uint32, TWeakObjectPtr<ABuildableBase>> DirtyPieces;
+	TSet<uint32> RemovedPieces;
+
+	TMap<const UClass*, uint16> ClassIndices;
+	int32 NumClassPaths = 0;
+
+	// Classes added to "ClassIndices" since the last autosave.
+	TArray<FString> NewClassPaths;
+
+	// Only ever touched by the one autosave task in flight.
+	TSharedPtr<FHopeWorldSaveImage, ESPMode::ThreadSafe> AutosaveImage;
+
+	TFuture<FHopeAutosaveResult> AutosaveTask;
+	FString AutosaveTaskSlot;
+
+	// First journal segment not covered by the running autosave.
+	uint32 AutosaveTaskSegment = 0;
+
+	float TimeSinceAutosave = 0.f;
+
+	FDelegateHandle RegisteredHandle;
+	FDelegateHandle UnregisteredHandle;
+	FDelegateHandle WireChangedHandle;
+
+	/*
+	*		***********************	Autosave ***********************
+	*/
+
+
+	/*
+	*		***********************	Journal ***********************
+	*/
+
+	void StartJournal();
+
+	void PushJournal(EHopeJournalOp Op, const ABuildableBase* Buildable);
+
+	void PushJournalClass(const UClass* Class, uint16 ClassIndex);
+
+	void PushJournalWire(EHopeJournalOp Op, const FHopeDeviceWireRecord& Wire);
+
+	static FString GetJournalBaseFilePath(const FString& SlotName);
+
+	TUniquePtr<FHopeWorldJournal> Journal;
+
+	// Segment the journal currently writes to.
+	uint32 JournalSegment = 0;
+
+	/*
+	*		***********************	Journal ***********************
+	*/
+};
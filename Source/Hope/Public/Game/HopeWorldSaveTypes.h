@@ -0,0 +1,141 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Binary layout of the chunked world save (.hwsv) written by "UHopeWorldSaveSubsystem".
+ *
+ *	[FHopeWorldSaveHeader]
+ *	[Class table]		NumClasses x (uint16 Length, UTF-8 class path)
+ *	[Chunk table]		NumChunks x FHopeWorldSaveChunk, one per grid cell
+ *	[Piece data]		NumPieces x FHopeBuildablePieceRecord, grouped by chunk
+ *	[Player table]		NumPlayers x FHopePlayerSaveRecord (version 2+)
+ *	[Wire table]		NumWires x FHopeDeviceWireRecord (version 3+), right after the player table
+ *
+ * The tables after the class table are fixed-size records aligned to 16 bytes, so a mapped file can be read
+ * in place without any per-object parsing. All values are little endian.
+ *
+ * Autosaves wrap the whole file in a FHopeWorldSaveCompressedHeader followed by the Oodle compressed bytes.
+ * Those are decompressed in one go on load and then read the same way.
+ */
+
+namespace HopeWorldSave
+{
+	static constexpr uint32 Magic = 0x56535748; // "HWSV"
+	static constexpr uint32 CompressedMagic = 0x5A535748; // "HWSZ"
+
+	// 1: Initial version
+	// 2: Added the player table
+	// 3: Added the wire table
+	static constexpr uint32 CurrentVersion = 3;
+	static constexpr uint64 HeaderSizeV1 = 48;
+
+	static constexpr uint64 RecordAlignment = 16;
+
+	// FHopeBuildablePieceRecord::Flags
+	static constexpr uint8 PieceFlag_Open = 1 << 0;
+	static constexpr uint8 PieceFlag_HasTier = 1 << 1;
+	static const TCHAR* FileExtension = TEXT(".hwsv");
+}
+
+struct FHopeWorldSaveHeader
+{
+	uint32 Magic = HopeWorldSave::Magic;
+	uint32 Version = HopeWorldSave::CurrentVersion;
+	uint32 NumClasses = 0;
+	uint32 NumChunks = 0;
+	uint32 NumPieces = 0;
+
+	// Cell size the chunks were built with. Used to prioritize chunks on load even if the grid changed since.
+	float CellSize = 0.f;
+
+	uint64 ClassTableOffset = 0;
+	uint64 ChunkTableOffset = 0;
+	uint64 PieceDataOffset = 0;
+
+	// Version 2
+	uint64 PlayerTableOffset = 0;
+	uint32 NumPlayers = 0;
+
+	// Version 3, was reserved before. The wire table starts at the aligned end of the player table.
+	uint32 NumWires = 0;
+};
+static_assert(sizeof(FHopeWorldSaveHeader) == 64, "FHopeWorldSaveHeader layout is part of the save format");
+
+struct FHopeWorldSaveCompressedHeader
+{
+	uint32 Magic = HopeWorldSave::CompressedMagic;
+	uint32 Reserved = 0;
+	uint64 UncompressedSize = 0;
+};
+static_assert(sizeof(FHopeWorldSaveCompressedHeader) == 16, "FHopeWorldSaveCompressedHeader layout is part of the save format");
+
+struct FHopeWorldSaveChunk
+{
+	int32 CellX = 0;
+	int32 CellY = 0;
+
+	// Range of this chunk in the piece data.
+	uint32 FirstPiece = 0;
+	uint32 NumPieces = 0;
+};
+static_assert(sizeof(FHopeWorldSaveChunk) == 16, "FHopeWorldSaveChunk layout is part of the save format");
+
+struct FHopeBuildablePieceRecord
+{
+	float Location[3] = { 0.f, 0.f, 0.f };
+	float Rotation[4] = { 0.f, 0.f, 0.f, 1.f }; // Quaternion X, Y, Z, W
+
+	uint32 PieceID = 0;
+
+	// Index into the class table.
+	uint16 ClassIndex = 0;
+
+	uint8 BuildingType = 0;
+	uint8 Flags = 0;
+
+	// Damage taken so far. Was reserved before, so older saves read as undamaged.
+	float Damage = 0.f;
+
+	// Stilts under a foundation placed on uneven ground. Was reserved before as well.
+	float StiltHeight = 0.f;
+
+	// Material tier of the piece. Taken from a reserved byte, so it is only read with "PieceFlag_HasTier" set
+	// and older saves keep the tier of the class.
+	uint8 Tier = 0;
+
+	uint8 Reserved[3] = {};
+};
+static_assert(sizeof(FHopeBuildablePieceRecord) == 48, "FHopeBuildablePieceRecord layout is part of the save format");
+static_assert(TIsTriviallyDestructible<FHopeBuildablePieceRecord>::Value, "Piece records are read in place from mapped memory");
+
+struct FHopePlayerSaveRecord
+{
+	// UTF-8, null terminated. Unique net ID of the player, or its name when there is none.
+	ANSICHAR PlayerID[64] = {};
+
+	float Location[3] = { 0.f, 0.f, 0.f };
+	float Rotation[4] = { 0.f, 0.f, 0.f, 1.f }; // Quaternion X, Y, Z, W
+
+	uint8 Reserved[4] = {};
+};
+static_assert(sizeof(FHopePlayerSaveRecord) == 96, "FHopePlayerSaveRecord layout is part of the save format");
+
+// Wire between two "UBuildingDeviceComponent"s, stored with the lower end first so every wire has one record.
+struct FHopeDeviceWireRecord
+{
+	uint32 PieceA = 0;
+	uint32 PieceB = 0;
+
+	// CRC32 of the name of the device component on its piece. Names survive Blueprints adding or reordering devices.
+	uint32 DeviceA = 0;
+	uint32 DeviceB = 0;
+
+	bool operator==(const FHopeDeviceWireRecord& Other) const
+	{
+		return PieceA == Other.PieceA && PieceB == Other.PieceB && DeviceA == Other.DeviceA && DeviceB == Other.DeviceB;
+	}
+};
+static_assert(sizeof(FHopeDeviceWireRecord) == 16, "FHopeDeviceWireRecord layout is part of the save format");
@@ -0,0 +1,19 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Native fast path for interface calls made every frame or on every input event.
+ *
+ * "Execute_" looks the function up by name and marshals its parameters through ProcessEvent on every call.
+ * Hot callers check once per implementing object whether the implementation is native, then cache what it returns
+ * or call the "_Implementation" directly, and only keep going through "Execute_" for Blueprint implementations.
+ * Compare the cost with the Hope.Debug.InterfaceDispatchBenchmark command.
+ */
+namespace HopeInterfaceDispatch
+{
+	// Returns true if "Object" implements "FunctionName" in C++ and no Blueprint overrides it.
+	HOPE_API bool IsNative(const UObject* Object, FName FunctionName);
+}
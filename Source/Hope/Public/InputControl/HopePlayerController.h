@@ -7,6 +7,7 @@
 #include "GameplayTagContainer.h"
 #include "InputActionValue.h"
 #include "HopeInterfaces/PlayerInterface.h"
+#include "Building/BuildingImpactTypes.h"
 
 #include "HopePlayerController.generated.h"
 
@@ -18,6 +19,7 @@ class UHopeAbilitySystemComponent;
 class UInv_Widget;
 class UInv_InventoryComponent;
 class AInv_ProxyMesh;
+class UBuildingComponent;
 
 DECLARE_MULTICAST_DELEGATE_OneParam(FOnProxyMeshReady, AInv_ProxyMesh*);
 
@@ -42,6 +44,10 @@ public:
 	
 	virtual void Tick(float DeltaSeconds) override;
 
+	// Aggregated damage and state changes of one base. Unreliable, they only drive effects.
+	UFUNCTION(Client, Unreliable)
+	void ClientReceiveBuildingImpacts(const FBuildingImpactUpdate& Update);
+
 protected:
 	
 	// Grant DefaultMappingContext at the start
@@ -143,6 +149,14 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Building")
 	float BuildingRotationSpeed = 1.f;
 
+	// Returns the building component of the possessed pawn. Resolved once per pawn, unless a Blueprint implements
+	// "GetPlayerBuildingComponent", see "HopeInterfaceDispatch".
+	UBuildingComponent* GetBuildingComponent();
+
+	TWeakObjectPtr<APawn> BuildingComponentPawn;
+	TWeakObjectPtr<UBuildingComponent> CachedBuildingComponent;
+	bool bIsBuildingComponentNative = false;
+
 	/*
 	* Building
 	*/
@@ -162,6 +176,9 @@ private:
 	TWeakObjectPtr<AActor> ThisActor;
 	TWeakObjectPtr<AActor> LastActor;
 
+	// Actor the shared view ray hit last tick, item or not. The inventory trace is skipped while it stays the same.
+	TWeakObjectPtr<AActor> LastViewHitActor;
+
 	// Reference to the main Inventory Widget that contains all other Inventory Widgets.
 	UPROPERTY()
 	TObjectPtr<UInv_Widget> Inv_Widget;
@@ -0,0 +1,50 @@
+// Copyright Sertim all rights reserved
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/LocalPlayerSubsystem.h"
+#include "HopeViewQuerySubsystem.generated.h"
+
+class UCameraComponent;
+
+/**
+ * Shared view ray of one local player. The first request of a frame, or after the camera moved, runs a single multi trace
+ * against every object type along the camera's forward vector. Building, interaction and inventory answer their
+ * channel traces from those hits instead of tracing the same ray again.
+ */
+UCLASS()
+class HOPE_API UHopeViewQuerySubsystem : public ULocalPlayerSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Returns the subsystem of the local player controlling "Actor", a pawn or a player controller. Null on remote players.
+	static UHopeViewQuerySubsystem* Get(const AActor* Actor);
+
+	/**
+	 * Equivalent of a single line trace on "Channel" from "MinDistance" to "MaxDistance" along the view ray, ignoring the pawn.
+	 * "OutHit" is filled like such a trace would fill it, including "TraceStart" and "TraceEnd" when nothing was hit.
+	 * Returns false without a ray while the player has no pawn with a camera.
+	 */
+	bool GetViewHit(ECollisionChannel Channel, float MinDistance, float MaxDistance, FHitResult& OutHit);
+
+private:
+
+	// Runs the shared trace again if the frame, the camera or the required length changed.
+	void UpdateCache(float RequiredDistance);
+
+	UCameraComponent* FindViewCamera();
+
+	TWeakObjectPtr<UCameraComponent> ViewCamera;
+
+	// Every hit along the ray, nearest first.
+	TArray<FHitResult> CachedHits;
+
+	FVector CachedLocation = FVector::ZeroVector;
+	FVector CachedDirection = FVector::ZeroVector;
+	float CachedDistance = 0.f;
+	uint64 CachedFrame = 0;
+	bool bHasCache = false;
+};